@@ -0,0 +1,287 @@
+#include "batchparser.h"
+#include "imageinfo.h"
+#include "utilities.h"
+#include "common/filesystem.h"
+#include "common/threadpool.h"
+#include "common/utility.h"
+
+#include "nlohmann/json.hpp"
+using ordered_json = nlohmann::ordered_json;
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+// Matches file name against pattern with '*' and '?' wildcards
+static bool wildcardMatch(const char* pattern, const char* name)
+{
+    const char* starPattern = NULL;
+    const char* starName = NULL;
+    while (*name)
+    {
+        if (*pattern == '?' || *pattern == *name)
+        {
+            pattern++;
+            name++;
+        }
+        else if (*pattern == '*')
+        {
+            starPattern = pattern++;
+            starName = name;
+        }
+        else if (starPattern)
+        {
+            pattern = starPattern + 1;
+            name = ++starName;
+        }
+        else
+            return false;
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+static size_t lastSeparator(const std::string& path)
+{
+    return path.find_last_of("/\\");
+}
+
+static std::string baseName(const std::string& path)
+{
+    size_t pos = lastSeparator(path);
+    return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
+
+BatchParser::BatchParser(ReportStore& store, UINT32 numThreads) : reportStore(store), threads(numThreads), wallTimeMs(0)
+{
+};
+
+USTATUS BatchParser::collectInputs(const std::string& source)
+{
+    return collectImagePaths(source, inputs);
+}
+
+USTATUS collectImagePaths(const std::string& source, std::vector<std::string>& inputs)
+{
+    std::vector<UString> names;
+
+    // Glob pattern, wildcards are allowed in file name only
+    if (source.find_first_of("*?") != std::string::npos)
+    {
+        size_t pos = lastSeparator(source);
+        std::string dir = (pos == std::string::npos) ? std::string(".") : source.substr(0, pos);
+        std::string pattern = (pos == std::string::npos) ? source : source.substr(pos + 1);
+        if (!listDirectory(UString(dir.c_str()), names))
+            return U_FILE_OPEN;
+        std::vector<std::string> found;
+        for (const UString& name : names)
+        {
+            if (wildcardMatch(pattern.c_str(), name.toLocal8Bit()))
+                found.push_back(dir + "/" + std::string(name.toLocal8Bit()));
+        }
+        std::sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
+        return U_SUCCESS;
+    }
+
+    // Directory, all regular files in it
+    if (listDirectory(UString(source.c_str()), names))
+    {
+        std::vector<std::string> found;
+        for (const UString& name : names)
+            found.push_back(source + "/" + std::string(name.toLocal8Bit()));
+        std::sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
+        return U_SUCCESS;
+    }
+
+    // Manifest, relative paths are resolved against manifest location
+    std::ifstream manifest(source, std::ios::in);
+    if (!manifest)
+        return U_FILE_OPEN;
+    size_t pos = lastSeparator(source);
+    std::string manifestDir = (pos == std::string::npos) ? std::string() : source.substr(0, pos + 1);
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        size_t begin = line.find_first_not_of(" \t\r");
+        size_t end = line.find_last_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+        line = line.substr(begin, end - begin + 1);
+        bool isAbsolute = line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':');
+        inputs.push_back(isAbsolute ? line : manifestDir + line);
+    }
+    return U_SUCCESS;
+}
+
+void BatchParser::parseImage(size_t index, const std::string& outputDir, UINT16 mode, const GuidNameDatabase& guidDatabase)
+{
+    auto start = std::chrono::steady_clock::now();
+    BATCH_IMAGE_RESULT& result = results[index];
+    result.path = inputs[index];
+    result.status = U_SUCCESS;
+    result.cached = false;
+    result.crc = 0;
+    result.sizeFullFile = 0;
+    result.sizeFullImage = 0;
+    result.isCapsule = false;
+    result.isIntelImage = false;
+    result.isBootGuard = false;
+    result.filesCount = 0;
+
+    UByteArray buffer;
+    result.status = readFileIntoBuffer(UString(result.path.c_str()), buffer);
+    if (result.status == U_SUCCESS)
+    {
+        // Workers are silent, only batch summary goes to console
+        std::ostream nullStream(NULL);
+        ImageInfo imageInfo(buffer, guidDatabase);
+        imageInfo.setLogStream(nullStream);
+
+        result.cached = imageInfo.readFromFile(reportStore);
+        if (!result.cached)
+        {
+            // Failed parse is not stored, otherwise next runs would take it as cached success
+            result.status = imageInfo.explore();
+            if (result.status == U_SUCCESS)
+                imageInfo.writeToFile(reportStore);
+        }
+
+        std::stringstream resultName;
+        resultName << std::setw(4) << std::setfill('0') << index + 1 << "_" << baseName(result.path) << ".txt";
+        result.resultFile = outputDir + "/" + resultName.str();
+        std::ofstream outputFile(result.resultFile, std::ios::out | std::ios::trunc);
+        outputFile << "Input image file: " << result.path << std::endl;
+        imageInfo.infoOutput(outputFile, mode);
+
+        result.crc = imageInfo.getCrc();
+        result.sizeFullFile = imageInfo.getSizeFullFile();
+        result.sizeFullImage = imageInfo.getSizeFullImage();
+        result.isCapsule = imageInfo.hasCapsule();
+        result.isIntelImage = imageInfo.hasIntelImage();
+        result.isBootGuard = imageInfo.hasBootGuard();
+        result.filesCount = imageInfo.getFilesCount();
+    }
+
+    result.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+USTATUS BatchParser::run(const std::string& outputDir, UINT16 mode)
+{
+    UString dirPath(outputDir.c_str());
+    if (!isExistOnFs(dirPath) && !makeDirectory(dirPath))
+        return U_DIR_CREATE;
+
+    results.clear();
+    results.resize(inputs.size());
+
+    // All images of the batch get the same names even if the database is replaced meanwhile
+    std::shared_ptr<const GuidNameDatabase> guidDatabase = currentGuidDatabase();
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        threads = pool.size();
+        for (size_t i = 0; i < inputs.size(); i++)
+            pool.submit([this, i, &outputDir, mode, &guidDatabase] { parseImage(i, outputDir, mode, *guidDatabase); });
+        pool.wait();
+    }
+    wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    reportStore.flush();
+    if (!writeSummary(outputDir + "/" + BATCH_SUMMARY_FILE))
+        return U_FILE_WRITE;
+    return U_SUCCESS;
+}
+
+bool BatchParser::writeSummary(const std::string& path) const
+{
+    std::ofstream outputFile(path, std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return false;
+
+    ordered_json summaryObj;
+    ordered_json imagesArr = ordered_json::array();
+    UINT32 failed = 0;
+    UINT64 totalBytes = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BATCH_IMAGE_RESULT& result = results[i];
+        ordered_json imageObj;
+        imageObj["index"] = i + 1;
+        imageObj["path"] = result.path;
+        imageObj["status"] = std::string(errorCodeToUString(result.status).toLocal8Bit());
+        if (result.status == U_SUCCESS || !result.resultFile.empty())
+        {
+            imageObj["crc"] = result.crc;
+            imageObj["sizeFullFile"] = result.sizeFullFile;
+            imageObj["sizeFullImage"] = result.sizeFullImage;
+            imageObj["capsule"] = result.isCapsule;
+            imageObj["intelImage"] = result.isIntelImage;
+            imageObj["bootGuard"] = result.isBootGuard;
+            imageObj["files"] = result.filesCount;
+            imageObj["cached"] = result.cached;
+            imageObj["resultFile"] = result.resultFile;
+        }
+        imageObj["timeMs"] = result.timeMs;
+        imagesArr.push_back(imageObj);
+        if (result.status != U_SUCCESS)
+            failed++;
+        totalBytes += result.sizeFullFile;
+    }
+
+    ordered_json totalsObj;
+    totalsObj["images"] = results.size();
+    totalsObj["failed"] = failed;
+    totalsObj["threads"] = threads;
+    totalsObj["bytes"] = totalBytes;
+    totalsObj["wallTimeMs"] = wallTimeMs;
+    totalsObj["imagesPerSecond"] = wallTimeMs > 0 ? results.size() * 1000.0 / wallTimeMs : 0.0;
+    totalsObj["megabytesPerSecond"] = wallTimeMs > 0 ? totalBytes / (1024.0 * 1024.0) * 1000.0 / wallTimeMs : 0.0;
+
+    summaryObj["totals"] = totalsObj;
+    summaryObj["images"] = imagesArr;
+    outputFile << std::setw(4) << summaryObj;
+    return true;
+}
+
+void BatchParser::summaryOutput(std::ostream& outputStream) const
+{
+    VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+        tableBatch({ "#", "Image", "Status", "CRC32", "Size", "Modules", "Report" });
+
+    UINT64 totalBytes = 0;
+    UINT32 failed = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BATCH_IMAGE_RESULT& result = results[i];
+        std::stringstream crc, size;
+        crc << std::uppercase << HexView(result.crc);
+        size << std::uppercase << HexView(result.sizeFullFile);
+        tableBatch.addRow(
+            std::to_string(i + 1),
+            baseName(result.path),
+            std::string(errorCodeToUString(result.status).toLocal8Bit()),
+            crc.str(),
+            size.str(),
+            std::to_string(result.filesCount),
+            result.resultFile.empty() ? "-" : (result.cached ? "cached" : "parsed")
+        );
+        totalBytes += result.sizeFullFile;
+        if (result.status != U_SUCCESS)
+            failed++;
+    }
+    tableBatch.print(outputStream, "Batch summary");
+
+    std::ios_base::fmtflags basic_flags(outputStream.flags());
+    outputStream << "Images: " << results.size() << ", failed: " << failed << ", threads: " << threads << std::endl;
+    outputStream << std::fixed << std::setprecision(1)
+        << "Wall time: " << wallTimeMs << " ms, "
+        << (wallTimeMs > 0 ? results.size() * 1000.0 / wallTimeMs : 0.0) << " images/s, "
+        << (wallTimeMs > 0 ? totalBytes / (1024.0 * 1024.0) * 1000.0 / wallTimeMs : 0.0) << " MB/s" << std::endl;
+    outputStream.flags(basic_flags);
+}
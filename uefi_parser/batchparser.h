@@ -0,0 +1,62 @@
+#ifndef BATCHPARSER_H
+#define BATCHPARSER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "common/basetypes.h"
+#include "common/guiddatabase.h"
+#include "reportstore.h"
+
+#define BATCH_DEFAULT_OUTPUT_DIR "batch_output"
+#define BATCH_SUMMARY_FILE "summary.json"
+
+struct BATCH_IMAGE_RESULT
+{
+    std::string path;
+    std::string resultFile;
+    USTATUS status;
+    bool cached;
+    UINT32 crc;
+    UINT32 sizeFullFile;
+    UINT32 sizeFullImage;
+    bool isCapsule;
+    bool isIntelImage;
+    bool isBootGuard;
+    size_t filesCount;
+    double timeMs;
+};
+
+// Append image paths from source: a directory, a glob pattern for file names ("dir/*.bin")
+// or a manifest file with one image path per line ('#' starts a comment)
+USTATUS collectImagePaths(const std::string& source, std::vector<std::string>& inputs);
+
+// Parses many images in one process on a worker pool, sharing GUID database and report store.
+// Results are kept in input order, so output does not depend on scheduling.
+class BatchParser
+{
+public:
+    BatchParser(ReportStore& store, UINT32 numThreads);
+
+    // Source is as in collectImagePaths
+    USTATUS collectInputs(const std::string& source);
+    const std::vector<std::string>& getInputs() const { return inputs; }
+
+    // Parse all inputs, write per-image results and summary to outputDir
+    USTATUS run(const std::string& outputDir, UINT16 mode);
+
+    void summaryOutput(std::ostream& outputStream) const;
+
+private:
+    ReportStore& reportStore;
+    UINT32 threads;
+    std::vector<std::string> inputs;
+    std::vector<BATCH_IMAGE_RESULT> results;
+    double wallTimeMs;
+
+    void parseImage(size_t index, const std::string& outputDir, UINT16 mode, const GuidNameDatabase& guidDatabase);
+    bool writeSummary(const std::string& path) const;
+};
+
+#endif // !BATCHPARSER_H
@@ -18,7 +18,7 @@ center_helper<charT, traits> centered(std::basic_string<charT, traits> str) {
 }
 
 // redeclare for std::string directly so we can support anything that implicitly converts to std::string
-center_helper<std::string::value_type, std::string::traits_type> centered(const std::string& str) {
+inline center_helper<std::string::value_type, std::string::traits_type> centered(const std::string& str) {
     return center_helper<std::string::value_type, std::string::traits_type>(str);
 }
 
@@ -14,6 +14,7 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "LzmaDecompress.h"
 #include "SDK/C/Types.h"
 #include "SDK/C/7zVersion.h"
+#include "../allocstats.h"
 
 #include <stdlib.h>
 
@@ -27,8 +28,8 @@ LShiftU64 (
     return Operand << Count;
 }
 
-static void * AllocForLzma(void *p, size_t size) { (void)p; return malloc(size); }
-static void FreeForLzma(void *p, void *address) { (void)p; free(address); }
+static void * AllocForLzma(void *p, size_t size) { (void)p; return STATS_MALLOC(size); }
+static void FreeForLzma(void *p, void *address) { (void)p; STATS_FREE(address); }
 static ISzAlloc SzAllocForLzma = { &AllocForLzma, &FreeForLzma };
 
 /*
@@ -0,0 +1,41 @@
+/* allocstats.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+// Included from C sources too, keep this header plain C
+
+#include <stdlib.h>
+
+// Uncomment to count allocations per parse phase.
+// Replaces global operator new/delete of the whole program, so it is off by default.
+//#define U_ENABLE_ALLOC_STATS_SUPPORT
+
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void* statsMalloc(size_t size);
+void statsFree(void* pointer);
+#ifdef __cplusplus
+}
+#endif
+
+#define STATS_MALLOC(size) statsMalloc(size)
+#define STATS_FREE(pointer) statsFree(pointer)
+#else
+#define STATS_MALLOC(size) malloc(size)
+#define STATS_FREE(pointer) free(pointer)
+#endif
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,251 @@
+/* chunkdiff.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "chunkdiff.h"
+#include "threadpool.h"
+#include "utility.h"
+
+// 12 bits spread over the upper half, checked every second byte, boundary probability is 1/8192 per byte
+#define CHUNK_DIFF_MASK 0x0000d91003530000ULL
+
+// Parts of data chunked independently on the shared thread pool
+#define CHUNK_DIFF_SEGMENT_SIZE 0x1000000
+
+struct CHUNK {
+    UINT64 offset;
+    UINT64 size;
+    UINT64 hash;
+};
+
+// Random values for every byte, fixed so chunk boundaries never change between runs.
+// Two bytes are rolled per step, the first one with values shifted by one bit.
+struct GEAR_TABLE {
+    UINT64 values[256];
+    UINT64 shifted[256];
+    GEAR_TABLE() {
+        UINT64 state = 0x6368756e6b646966ULL;
+        for (int i = 0; i < 256; i++) {
+            // splitmix64
+            UINT64 z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            values[i] = z ^ (z >> 31);
+            shifted[i] = values[i] << 1;
+        }
+    }
+};
+
+static const GEAR_TABLE & gearTable()
+{
+    static const GEAR_TABLE table;
+    return table;
+}
+
+// Chunks of data[begin, end), first one starts at begin whatever the content is
+static void cutChunks(const UINT8* data, const UINT64 begin, const UINT64 end, std::vector<CHUNK> & chunks)
+{
+    const GEAR_TABLE & gear = gearTable();
+    UINT64 start = begin;
+    while (start < end) {
+        UINT64 limit = std::min(end, start + CHUNK_DIFF_MAX_SIZE);
+        UINT64 cut = limit;
+        if (limit - start > CHUNK_DIFF_MIN_SIZE + 1) {
+            // Hash depends only on the last 64 bytes, so bytes before them are skipped
+            UINT64 hash = 0;
+            UINT64 i = start + CHUNK_DIFF_MIN_SIZE - 64;
+            for (; i < start + CHUNK_DIFF_MIN_SIZE; i += 2)
+                hash = (hash << 2) + gear.shifted[data[i]] + gear.values[data[i + 1]];
+            for (; i + 1 < limit; i += 2) {
+                hash = (hash << 2) + gear.shifted[data[i]] + gear.values[data[i + 1]];
+                if (!(hash & CHUNK_DIFF_MASK)) {
+                    cut = i + 2;
+                    break;
+                }
+            }
+        }
+        CHUNK chunk = { start, cut - start, dataFingerprint(data + start, cut - start) };
+        chunks.push_back(chunk);
+        start = cut;
+    }
+}
+
+// Segments are chunked in parallel, chunks that differ only because of a segment edge
+// are equal by bytes and are taken back by extension of their neighbours
+static void cutChunks(const UINT8* data, const UINT64 size, std::vector<CHUNK> & chunks)
+{
+    size_t segments = (size_t)((size + CHUNK_DIFF_SEGMENT_SIZE - 1) / CHUNK_DIFF_SEGMENT_SIZE);
+    std::vector<std::vector<CHUNK> > segmentChunks(segments);
+    sharedThreadPool().parallelFor(segments, [data, size, &segmentChunks](size_t i) {
+        UINT64 begin = i * (UINT64)CHUNK_DIFF_SEGMENT_SIZE;
+        cutChunks(data, begin, std::min(size, begin + CHUNK_DIFF_SEGMENT_SIZE), segmentChunks[i]);
+    });
+    for (size_t i = 0; i < segments; i++)
+        chunks.insert(chunks.end(), segmentChunks[i].begin(), segmentChunks[i].end());
+}
+
+static bool chunkLess(const CHUNK & lhs, const CHUNK & rhs)
+{
+    return lhs.hash < rhs.hash || (lhs.hash == rhs.hash && lhs.offset < rhs.offset);
+}
+
+static void appendRange(std::vector<CHUNK_DIFF_RANGE> & ranges, const UINT8 kind, const UINT64 oldOffset, const UINT64 newOffset, const UINT64 size)
+{
+    if (!ranges.empty()) {
+        CHUNK_DIFF_RANGE & last = ranges.back();
+        if (kind == ChunkDiffRanges::Changed && last.kind == ChunkDiffRanges::Changed) {
+            last.newSize += size;
+            return;
+        }
+        if (kind == ChunkDiffRanges::Equal && last.kind == ChunkDiffRanges::Equal && last.oldOffset + last.oldSize == oldOffset) {
+            last.oldSize += size;
+            last.newSize += size;
+            return;
+        }
+    }
+    CHUNK_DIFF_RANGE range = { kind, oldOffset, kind == ChunkDiffRanges::Equal ? size : 0, newOffset, size };
+    ranges.push_back(range);
+}
+
+USTATUS chunkDiff(const UINT8* oldData, const UINT64 oldSize, const UINT8* newData, const UINT64 newSize, std::vector<CHUNK_DIFF_RANGE> & ranges)
+{
+    ranges.clear();
+    if ((!oldData && oldSize) || (!newData && newSize))
+        return U_INVALID_PARAMETER;
+
+    std::vector<CHUNK> oldChunks, newChunks;
+    cutChunks(oldData, oldSize, oldChunks);
+    cutChunks(newData, newSize, newChunks);
+    std::sort(oldChunks.begin(), oldChunks.end(), chunkLess);
+
+    // Continuation of the previous equal range is preferred over other copies of the same data
+    UINT64 expectedOldOffset = 0;
+    for (size_t i = 0; i < newChunks.size(); i++) {
+        const CHUNK & chunk = newChunks[i];
+        CHUNK key = { 0, 0, chunk.hash };
+        std::vector<CHUNK>::const_iterator candidate = std::lower_bound(oldChunks.begin(), oldChunks.end(), key, chunkLess);
+        std::vector<CHUNK>::const_iterator match = oldChunks.end();
+        for (; candidate != oldChunks.end() && candidate->hash == chunk.hash; ++candidate) {
+            if (candidate->size != chunk.size || memcmp(oldData + candidate->offset, newData + chunk.offset, (size_t)chunk.size))
+                continue;
+            if (match == oldChunks.end() || candidate->offset == expectedOldOffset)
+                match = candidate;
+            if (candidate->offset == expectedOldOffset)
+                break;
+        }
+
+        if (match == oldChunks.end()) {
+            appendRange(ranges, ChunkDiffRanges::Changed, 0, chunk.offset, chunk.size);
+        }
+        else {
+            appendRange(ranges, ChunkDiffRanges::Equal, match->offset, chunk.offset, chunk.size);
+            expectedOldOffset = match->offset + match->size;
+        }
+    }
+
+    // Equal ranges take matching bytes of neighbouring changed ones
+    for (size_t i = 0; i < ranges.size(); i++) {
+        if (ranges[i].kind != ChunkDiffRanges::Changed)
+            continue;
+        CHUNK_DIFF_RANGE & changed = ranges[i];
+        if (i > 0) {
+            CHUNK_DIFF_RANGE & previous = ranges[i - 1];
+            UINT64 oldEnd = previous.oldOffset + previous.oldSize;
+            // Old bytes already taken by the following equal range are not taken again
+            UINT64 oldLimit = oldSize;
+            if (i + 1 < ranges.size() && ranges[i + 1].kind == ChunkDiffRanges::Equal && ranges[i + 1].oldOffset >= oldEnd)
+                oldLimit = ranges[i + 1].oldOffset;
+            UINT64 length = 0;
+            while (length < changed.newSize && oldEnd + length < oldLimit && oldData[oldEnd + length] == newData[changed.newOffset + length])
+                length++;
+            previous.oldSize += length;
+            previous.newSize += length;
+            changed.newOffset += length;
+            changed.newSize -= length;
+        }
+        if (i + 1 < ranges.size()) {
+            CHUNK_DIFF_RANGE & next = ranges[i + 1];
+            // Same for the preceding one, extended above
+            UINT64 oldLimit = 0;
+            if (i > 0 && ranges[i - 1].kind == ChunkDiffRanges::Equal && ranges[i - 1].oldOffset + ranges[i - 1].oldSize <= next.oldOffset)
+                oldLimit = ranges[i - 1].oldOffset + ranges[i - 1].oldSize;
+            UINT64 length = 0;
+            while (length < changed.newSize && length < next.oldOffset - oldLimit
+                && oldData[next.oldOffset - length - 1] == newData[changed.newOffset + changed.newSize - length - 1])
+                length++;
+            next.oldOffset -= length;
+            next.oldSize += length;
+            next.newOffset -= length;
+            next.newSize += length;
+            changed.newSize -= length;
+        }
+    }
+
+    // Changed ranges swallowed by their neighbours are dropped, old data between equal ranges
+    // is given to changed range in between, or to a new one for removed data
+    std::vector<CHUNK_DIFF_RANGE> result;
+    UINT64 oldPosition = 0;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        CHUNK_DIFF_RANGE range = ranges[i];
+        if (range.kind == ChunkDiffRanges::Changed) {
+            UINT64 oldEnd = oldSize;
+            if (i + 1 < ranges.size())
+                oldEnd = ranges[i + 1].oldOffset;
+            range.oldOffset = oldPosition;
+            range.oldSize = oldEnd > oldPosition ? oldEnd - oldPosition : 0;
+            if (range.newSize || range.oldSize)
+                result.push_back(range);
+            continue;
+        }
+        if (range.oldOffset > oldPosition && (result.empty() || result.back().kind == ChunkDiffRanges::Equal)) {
+            CHUNK_DIFF_RANGE removed = { ChunkDiffRanges::Changed, oldPosition, range.oldOffset - oldPosition, range.newOffset, 0 };
+            result.push_back(removed);
+        }
+        if (!result.empty() && result.back().kind == ChunkDiffRanges::Equal
+            && result.back().oldOffset + result.back().oldSize == range.oldOffset) {
+            result.back().oldSize += range.oldSize;
+            result.back().newSize += range.newSize;
+        }
+        else {
+            result.push_back(range);
+        }
+        oldPosition = range.oldOffset + range.oldSize;
+    }
+    if (oldPosition < oldSize && (result.empty() || result.back().kind == ChunkDiffRanges::Equal)) {
+        CHUNK_DIFF_RANGE removed = { ChunkDiffRanges::Changed, oldPosition, oldSize - oldPosition, newSize, 0 };
+        result.push_back(removed);
+    }
+    ranges.swap(result);
+    return U_SUCCESS;
+}
+
+UString itemPathByRange(const TreeModel* model, const UINT32 offset, const UINT32 size)
+{
+    // Start offset gives the deepest item, parents are taken until one holds the range end as well
+    UINT64 end = (UINT64)offset + (size ? size : 1);
+    UModelIndex index = model->findByBase(offset);
+    while (index.isValid()) {
+        UINT64 fullSize = model->constHeader(index).size() + model->constBody(index).size() + model->constTail(index).size();
+        if ((UINT64)model->base(index) + fullSize >= end)
+            break;
+        index = model->parent(index);
+    }
+
+    UString path;
+    while (index.isValid()) {
+        path = path.isEmpty() ? model->name(index) : model->name(index) + UString("/") + path;
+        index = model->parent(index);
+    }
+    return path;
+}
@@ -0,0 +1,52 @@
+/* chunkdiff.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef CHUNKDIFF_H
+#define CHUNKDIFF_H
+
+#include <vector>
+
+#include "basetypes.h"
+#include "ustring.h"
+#include "treemodel.h"
+
+// Content defined chunking parameters, average chunk is about 8K
+#define CHUNK_DIFF_MIN_SIZE     0x800
+#define CHUNK_DIFF_MAX_SIZE     0x10000
+
+namespace ChunkDiffRanges {
+    enum ChunkDiffRangeTypes {
+        Equal = 0,
+        Changed
+    };
+}
+
+struct CHUNK_DIFF_RANGE {
+    UINT8  kind;
+    UINT64 oldOffset;
+    UINT64 oldSize;     // For changed ranges, bytes of old data between surrounding equal ranges
+    UINT64 newOffset;
+    UINT64 newSize;     // Zero for data removed from old image
+};
+
+// Block comparison of two buffers that stays useful when content is shifted by insertions.
+// Both buffers are cut into chunks at positions chosen by Gear rolling hash of the last 64 bytes,
+// so equal content gets equal chunks wherever it is. Chunks of new data are looked up among chunks
+// of old data, edges of equal ranges are then extended byte by byte.
+// Ranges cover the new data in order, equal ranges may refer to any part of the old data.
+USTATUS chunkDiff(const UINT8* oldData, const UINT64 oldSize, const UINT8* newData, const UINT64 newSize, std::vector<CHUNK_DIFF_RANGE> & ranges);
+
+// Names of the deepest uncompressed item containing the whole range and of its parents, "/" separated.
+// Empty if no item contains it
+UString itemPathByRange(const TreeModel* model, const UINT32 offset, const UINT32 size);
+
+#endif // CHUNKDIFF_H
@@ -51,26 +51,56 @@ UINT32 uint24ToUint32(const UINT8* ffsSize)
     + ((UINT32) ffsSize[2] << 16U);
 }
 
+static inline void byteToChars(const UINT8 value, char* buffer)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    buffer[0] = digits[value >> 4];
+    buffer[1] = digits[value & 0x0F];
+}
+
+// Writes GUID_STRING_LENGTH characters, fixed positions and no format parsing
+void guidToChars(const EFI_GUID & guid, char* buffer)
+{
+    byteToChars((UINT8)(guid.Data1 >> 24), buffer);
+    byteToChars((UINT8)(guid.Data1 >> 16), buffer + 2);
+    byteToChars((UINT8)(guid.Data1 >> 8), buffer + 4);
+    byteToChars((UINT8)guid.Data1, buffer + 6);
+    buffer[8] = '-';
+    byteToChars((UINT8)(guid.Data2 >> 8), buffer + 9);
+    byteToChars((UINT8)guid.Data2, buffer + 11);
+    buffer[13] = '-';
+    byteToChars((UINT8)(guid.Data3 >> 8), buffer + 14);
+    byteToChars((UINT8)guid.Data3, buffer + 16);
+    buffer[18] = '-';
+    byteToChars(guid.Data4[0], buffer + 19);
+    byteToChars(guid.Data4[1], buffer + 21);
+    buffer[23] = '-';
+    for (int i = 2; i < 8; i++)
+        byteToChars(guid.Data4[i], buffer + 20 + 2 * i);
+}
+
+static UString guidText(const EFI_GUID & guid)
+{
+    char buffer[GUID_STRING_LENGTH];
+    guidToChars(guid, buffer);
+    return UString(buffer, GUID_STRING_LENGTH);
+}
+
 UString guidToUString(const EFI_GUID & guid, bool convertToString)
 {
-    if (convertToString) {
-        UString readableName = guidDatabaseLookup(guid);
-        if (!readableName.isEmpty())
-            return readableName;
-    }
+    if (convertToString)
+        return guidToUString(guid, *currentGuidDatabase());
 
-    return usprintf("%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
-        guid.Data1,
-        guid.Data2,
-        guid.Data3,
-        guid.Data4[0],
-        guid.Data4[1],
-        guid.Data4[2],
-        guid.Data4[3],
-        guid.Data4[4],
-        guid.Data4[5],
-        guid.Data4[6],
-        guid.Data4[7]);
+    return guidText(guid);
+}
+
+UString guidToUString(const EFI_GUID & guid, const GuidNameDatabase & names)
+{
+    const char* readableName = names.lookup(guid);
+    if (readableName && *readableName)
+        return UString(readableName);
+
+    return guidText(guid);
 }
 
 
@@ -99,53 +129,78 @@ bool ustringToGuid(const UString & str, EFI_GUID & guid)
     return true;
 }
 
-UString fileTypeToUString(const UINT8 type)
+// "Unknown N" names for all byte values, built once and shared by all callers
+struct UNKNOWN_TYPE_NAMES {
+    char names[256][12];
+    UNKNOWN_TYPE_NAMES() {
+        for (int i = 0; i < 256; i++)
+            snprintf(names[i], sizeof(names[i]), "Unknown %u", i);
+    }
+};
+
+static const char* unknownTypeName(const UINT8 type)
+{
+    static const UNKNOWN_TYPE_NAMES table;
+    return table.names[type];
+}
+
+const char* fileTypeToString(const UINT8 type)
 {
     switch (type) {
-        case EFI_FV_FILETYPE_RAW:                   return UString("Raw");
-        case EFI_FV_FILETYPE_FREEFORM:              return UString("Freeform");
-        case EFI_FV_FILETYPE_SECURITY_CORE:         return UString("SEC core");
-        case EFI_FV_FILETYPE_PEI_CORE:              return UString("PEI core");
-        case EFI_FV_FILETYPE_DXE_CORE:              return UString("DXE core");
-        case EFI_FV_FILETYPE_PEIM:                  return UString("PEI module");
-        case EFI_FV_FILETYPE_DRIVER:                return UString("DXE driver");
-        case EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER:  return UString("Combined PEI/DXE");
-        case EFI_FV_FILETYPE_APPLICATION:           return UString("Application");
-        case EFI_FV_FILETYPE_MM:                    return UString("SMM module");
-        case EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE: return UString("Volume image");
-        case EFI_FV_FILETYPE_COMBINED_MM_DXE:       return UString("Combined SMM/DXE");
-        case EFI_FV_FILETYPE_MM_CORE:               return UString("SMM core");
-        case EFI_FV_FILETYPE_MM_STANDALONE:         return UString("MM standalone module");
-        case EFI_FV_FILETYPE_MM_CORE_STANDALONE:    return UString("MM standalone core");
-        case EFI_FV_FILETYPE_PAD:                   return UString("Pad");
-        default:                                    return usprintf("Unknown %u", type);
+        case EFI_FV_FILETYPE_RAW:                   return "Raw";
+        case EFI_FV_FILETYPE_FREEFORM:              return "Freeform";
+        case EFI_FV_FILETYPE_SECURITY_CORE:         return "SEC core";
+        case EFI_FV_FILETYPE_PEI_CORE:              return "PEI core";
+        case EFI_FV_FILETYPE_DXE_CORE:              return "DXE core";
+        case EFI_FV_FILETYPE_PEIM:                  return "PEI module";
+        case EFI_FV_FILETYPE_DRIVER:                return "DXE driver";
+        case EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER:  return "Combined PEI/DXE";
+        case EFI_FV_FILETYPE_APPLICATION:           return "Application";
+        case EFI_FV_FILETYPE_MM:                    return "SMM module";
+        case EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE: return "Volume image";
+        case EFI_FV_FILETYPE_COMBINED_MM_DXE:       return "Combined SMM/DXE";
+        case EFI_FV_FILETYPE_MM_CORE:               return "SMM core";
+        case EFI_FV_FILETYPE_MM_STANDALONE:         return "MM standalone module";
+        case EFI_FV_FILETYPE_MM_CORE_STANDALONE:    return "MM standalone core";
+        case EFI_FV_FILETYPE_PAD:                   return "Pad";
+        default:                                    return unknownTypeName(type);
     };
 }
 
-UString sectionTypeToUString(const UINT8 type)
+UString fileTypeToUString(const UINT8 type)
+{
+    return UString(fileTypeToString(type));
+}
+
+const char* sectionTypeToString(const UINT8 type)
 {
     switch (type) {
-        case EFI_SECTION_COMPRESSION:               return UString("Compressed");
-        case EFI_SECTION_GUID_DEFINED:              return UString("GUID defined");
-        case EFI_SECTION_DISPOSABLE:                return UString("Disposable");
-        case EFI_SECTION_PE32:                      return UString("PE32 image");
-        case EFI_SECTION_PIC:                       return UString("PIC image");
-        case EFI_SECTION_TE:                        return UString("TE image");
-        case EFI_SECTION_DXE_DEPEX:                 return UString("DXE dependency");
-        case EFI_SECTION_VERSION:                   return UString("Version");
-        case EFI_SECTION_USER_INTERFACE:            return UString("UI");
-        case EFI_SECTION_COMPATIBILITY16:           return UString("16-bit image");
-        case EFI_SECTION_FIRMWARE_VOLUME_IMAGE:     return UString("Volume image");
-        case EFI_SECTION_FREEFORM_SUBTYPE_GUID:     return UString("Freeform subtype GUID");
-        case EFI_SECTION_RAW:                       return UString("Raw");
-        case EFI_SECTION_PEI_DEPEX:                 return UString("PEI dependency");
-        case EFI_SECTION_MM_DEPEX:                  return UString("MM dependency");
-        case INSYDE_SECTION_POSTCODE:               return UString("Insyde postcode");
-        case PHOENIX_SECTION_POSTCODE:              return UString("Phoenix postcode");
-        default:                                    return usprintf("Unknown %u", type);
+        case EFI_SECTION_COMPRESSION:               return "Compressed";
+        case EFI_SECTION_GUID_DEFINED:              return "GUID defined";
+        case EFI_SECTION_DISPOSABLE:                return "Disposable";
+        case EFI_SECTION_PE32:                      return "PE32 image";
+        case EFI_SECTION_PIC:                       return "PIC image";
+        case EFI_SECTION_TE:                        return "TE image";
+        case EFI_SECTION_DXE_DEPEX:                 return "DXE dependency";
+        case EFI_SECTION_VERSION:                   return "Version";
+        case EFI_SECTION_USER_INTERFACE:            return "UI";
+        case EFI_SECTION_COMPATIBILITY16:           return "16-bit image";
+        case EFI_SECTION_FIRMWARE_VOLUME_IMAGE:     return "Volume image";
+        case EFI_SECTION_FREEFORM_SUBTYPE_GUID:     return "Freeform subtype GUID";
+        case EFI_SECTION_RAW:                       return "Raw";
+        case EFI_SECTION_PEI_DEPEX:                 return "PEI dependency";
+        case EFI_SECTION_MM_DEPEX:                  return "MM dependency";
+        case INSYDE_SECTION_POSTCODE:               return "Insyde postcode";
+        case PHOENIX_SECTION_POSTCODE:              return "Phoenix postcode";
+        default:                                    return unknownTypeName(type);
     }
 }
 
+UString sectionTypeToUString(const UINT8 type)
+{
+    return UString(sectionTypeToString(type));
+}
+
 UString bpdtEntryTypeToUString(const UINT16 type)
 {
     switch (type) {
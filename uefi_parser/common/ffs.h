@@ -19,13 +19,22 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "ubytearray.h"
 #include "ustring.h"
 
+class GuidNameDatabase;
+
+// Length of GUID text without terminating zero
+#define GUID_STRING_LENGTH 36
+
 // Make sure we use right packing rules
 #pragma pack(push,1)
 
 extern UString guidToUString(const EFI_GUID& guid, bool convertToString = true);
+extern UString guidToUString(const EFI_GUID& guid, const GuidNameDatabase& names);
+extern void guidToChars(const EFI_GUID& guid, char* buffer);
 extern bool ustringToGuid(const UString& str, EFI_GUID& guid);
 extern UString fileTypeToUString(const UINT8 type);
 extern UString sectionTypeToUString(const UINT8 type);
+extern const char* fileTypeToString(const UINT8 type);
+extern const char* sectionTypeToString(const UINT8 type);
 extern UString bpdtEntryTypeToUString(const UINT16 type);
 extern UString cpdExtensionTypeToUstring(const UINT32 type);
 //*****************************************************************************
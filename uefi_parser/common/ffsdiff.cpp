@@ -0,0 +1,249 @@
+/* ffsdiff.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "ffsdiff.h"
+#include "ffs.h"
+#include "sha256.h"
+#include "types.h"
+
+// Merkle hashes are taken when both models have them, no item data is read then
+static std::string itemHash(const TreeModel* model, const UModelIndex & index, const bool treeHashes)
+{
+    if (treeHashes) {
+        UByteArray hash = model->hash(index);
+        return std::string(hash.constData(), hash.size());
+    }
+    UByteArray data = model->header(index) + model->body(index) + model->tail(index);
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    sha256(data.constData(), (unsigned long)data.size(), digest);
+    return std::string((const char*)digest, sizeof(digest));
+}
+
+static UINT32 itemSize(const TreeModel* model, const UModelIndex & index)
+{
+    return (UINT32)(model->header(index).size() + model->body(index).size() + model->tail(index).size());
+}
+
+static std::string itemKey(const TreeModel* model, const UModelIndex & index)
+{
+    std::string key;
+    key += (char)model->type(index);
+    key += (char)model->subtype(index);
+    key += model->name(index).toLocal8Bit();
+    return key;
+}
+
+static UString childPath(const UString & parentPath, const UString & name, const UINT32 occurrence)
+{
+    UString path = parentPath.isEmpty() ? name : parentPath + UString("/") + name;
+    if (occurrence)
+        path += usprintf("[%u]", occurrence);
+    return path;
+}
+
+static bool isInSubtree(const UString & path, const UString & subtreePath)
+{
+    return path.length() > subtreePath.length()
+        && path.left(subtreePath.length() + 1) == subtreePath + UString("/");
+}
+
+USTATUS FfsDiff::compare()
+{
+    items.clear();
+    itemHashes.clear();
+    stats = FFS_DIFF_STATS();
+
+    if (!oldModel || !newModel)
+        return U_INVALID_PARAMETER;
+
+    treeHashes = !oldModel->hasEmptyHash(oldModel->index(0, 0)) && !newModel->hasEmptyHash(newModel->index(0, 0));
+
+    // Top level items are children of the invisible root item
+    compareChildren(UModelIndex(), UModelIndex(), UString());
+    resolveMoves();
+
+    for (size_t i = 0; i < items.size(); i++) {
+        switch (items[i].change) {
+        case DiffChanges::Added:    stats.added++;    break;
+        case DiffChanges::Removed:  stats.removed++;  break;
+        case DiffChanges::Modified: stats.modified++; break;
+        case DiffChanges::Moved:    stats.moved++;    break;
+        }
+    }
+    return U_SUCCESS;
+}
+
+bool FfsDiff::isReported(const TreeModel* model, const UModelIndex & index) const
+{
+    switch (model->type(index)) {
+    case Types::Capsule:
+    case Types::Image:
+    case Types::Region:
+    case Types::Volume:
+    case Types::Microcode:
+        return true;
+    case Types::File:
+        // Pad files only follow size changes of their neighbours
+        return model->subtype(index) != EFI_FV_FILETYPE_PAD;
+    }
+    return false;
+}
+
+void FfsDiff::compareChildren(const UModelIndex & oldParent, const UModelIndex & newParent, const UString & parentPath)
+{
+    // Rows of new children by key, taken in order of appearance
+    std::map<std::string, std::vector<int> > newRows;
+    int newCount = newModel->rowCount(newParent);
+    for (int i = 0; i < newCount; i++)
+        newRows[itemKey(newModel, newModel->index(i, 0, newParent))].push_back(i);
+
+    std::vector<bool> newMatched(newCount, false);
+    std::map<std::string, UINT32> oldOccurrences;
+    int oldCount = oldModel->rowCount(oldParent);
+    for (int i = 0; i < oldCount; i++) {
+        UModelIndex oldIndex = oldModel->index(i, 0, oldParent);
+        std::string key = itemKey(oldModel, oldIndex);
+        UINT32 occurrence = oldOccurrences[key]++;
+        UString path = childPath(parentPath, oldModel->name(oldIndex), occurrence);
+
+        std::map<std::string, std::vector<int> >::const_iterator rows = newRows.find(key);
+        if (rows == newRows.end() || occurrence >= rows->second.size()) {
+            addSubtree(DiffChanges::Removed, oldModel, oldIndex, path);
+            continue;
+        }
+        int newRow = rows->second[occurrence];
+        newMatched[newRow] = true;
+        compareItems(oldIndex, newModel->index(newRow, 0, newParent), path);
+    }
+
+    std::map<std::string, UINT32> newOccurrences;
+    for (int i = 0; i < newCount; i++) {
+        UModelIndex newIndex = newModel->index(i, 0, newParent);
+        UINT32 occurrence = newOccurrences[itemKey(newModel, newIndex)]++;
+        if (!newMatched[i])
+            addSubtree(DiffChanges::Added, newModel, newIndex, childPath(parentPath, newModel->name(newIndex), occurrence));
+    }
+}
+
+void FfsDiff::compareItems(const UModelIndex & oldIndex, const UModelIndex & newIndex, const UString & path)
+{
+    stats.comparedItems++;
+    UINT32 oldSize = itemSize(oldModel, oldIndex);
+    UINT32 newSize = itemSize(newModel, newIndex);
+    bool reported = isReported(newModel, newIndex);
+
+    FFS_DIFF_ITEM item;
+    item.type = newModel->type(newIndex);
+    item.subtype = newModel->subtype(newIndex);
+    item.name = newModel->name(newIndex);
+    item.text = newModel->text(newIndex);
+    item.path = path;
+    item.oldPath = path;
+    item.oldBase = oldModel->base(oldIndex);
+    item.oldSize = oldSize;
+    item.newBase = newModel->base(newIndex);
+    item.newSize = newSize;
+
+    // Sizes are checked first, different sizes need no hashing
+    if (oldSize == newSize && itemHash(oldModel, oldIndex, treeHashes) == itemHash(newModel, newIndex, treeHashes)) {
+        stats.identicalSubtrees++;
+        if (reported && item.oldBase != item.newBase) {
+            item.change = DiffChanges::Moved;
+            items.push_back(item);
+            itemHashes.push_back(std::string());
+        }
+        return;
+    }
+
+    if (reported) {
+        item.change = DiffChanges::Modified;
+        items.push_back(item);
+        itemHashes.push_back(std::string());
+    }
+    compareChildren(oldIndex, newIndex, path);
+}
+
+void FfsDiff::addSubtree(const UINT8 change, const TreeModel* model, const UModelIndex & index, const UString & path)
+{
+    if (isReported(model, index)) {
+        FFS_DIFF_ITEM item;
+        item.change = change;
+        item.type = model->type(index);
+        item.subtype = model->subtype(index);
+        item.name = model->name(index);
+        item.text = model->text(index);
+        item.path = path;
+        item.oldPath = path;
+        UINT32 base = model->base(index);
+        UINT32 size = itemSize(model, index);
+        item.oldBase = change == DiffChanges::Removed ? base : 0;
+        item.oldSize = change == DiffChanges::Removed ? size : 0;
+        item.newBase = change == DiffChanges::Added ? base : 0;
+        item.newSize = change == DiffChanges::Added ? size : 0;
+        items.push_back(item);
+        itemHashes.push_back(itemHash(model, index, treeHashes));
+    }
+
+    // Items inside are listed too, so added and removed modules of a volume can be counted
+    std::map<std::string, UINT32> occurrences;
+    for (int i = 0; i < model->rowCount(index); i++) {
+        UModelIndex child = model->index(i, 0, index);
+        UINT32 occurrence = occurrences[itemKey(model, child)]++;
+        addSubtree(change, model, child, childPath(path, model->name(child), occurrence));
+    }
+}
+
+void FfsDiff::resolveMoves()
+{
+    std::multimap<std::string, size_t> added;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (items[i].change == DiffChanges::Added)
+            added.insert(std::make_pair(itemHashes[i], i));
+    }
+    if (added.empty())
+        return;
+
+    std::vector<bool> dropped(items.size(), false);
+    for (size_t i = 0; i < items.size(); i++) {
+        if (dropped[i] || items[i].change != DiffChanges::Removed)
+            continue;
+
+        std::pair<std::multimap<std::string, size_t>::iterator, std::multimap<std::string, size_t>::iterator> range = added.equal_range(itemHashes[i]);
+        std::multimap<std::string, size_t>::iterator match = range.first;
+        while (match != range.second && (dropped[match->second] || items[match->second].type != items[i].type))
+            ++match;
+        if (match == range.second)
+            continue;
+
+        size_t j = match->second;
+        added.erase(match);
+        items[j].change = DiffChanges::Moved;
+        items[j].oldPath = items[i].path;
+        items[j].oldBase = items[i].oldBase;
+        items[j].oldSize = items[i].oldSize;
+        dropped[i] = true;
+
+        // Contents of equal items are equal too, subtrees are listed right after their roots
+        for (size_t k = i + 1; k < items.size() && items[k].change == DiffChanges::Removed && isInSubtree(items[k].path, items[i].path); k++)
+            dropped[k] = true;
+        for (size_t k = j + 1; k < items.size() && items[k].change == DiffChanges::Added && isInSubtree(items[k].path, items[j].path); k++)
+            dropped[k] = true;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (!dropped[i])
+            items[kept++] = items[i];
+    }
+    items.resize(kept);
+    itemHashes.clear();
+}
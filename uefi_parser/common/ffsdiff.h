@@ -0,0 +1,90 @@
+/* ffsdiff.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef FFSDIFF_H
+#define FFSDIFF_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "basetypes.h"
+#include "ubytearray.h"
+#include "ustring.h"
+#include "treemodel.h"
+
+namespace DiffChanges {
+    enum DiffChangeTypes {
+        Added = 0,
+        Removed,
+        Modified,
+        Moved
+    };
+}
+
+struct FFS_DIFF_ITEM {
+    UINT8   change;
+    UINT8   type;
+    UINT8   subtype;
+    UString name;
+    UString text;
+    UString path;       // Path in new image, in old one for removed items
+    UString oldPath;    // Differs from path only for items moved to another parent
+    UINT32  oldBase;
+    UINT32  oldSize;
+    UINT32  newBase;
+    UINT32  newSize;
+};
+
+struct FFS_DIFF_STATS {
+    UINT32 comparedItems;       // Matched pairs that were hashed or had different sizes
+    UINT32 identicalSubtrees;   // Matched pairs with equal hashes, their children are not visited
+    UINT32 added;
+    UINT32 removed;
+    UINT32 modified;
+    UINT32 moved;
+};
+
+// Structural comparison of two parsed images.
+// Children of matched items are matched by type, subtype and name (GUID for volumes and files),
+// repeated names are matched in order of appearance. Matched pairs are compared by SHA256
+// of their data, or by Merkle hashes of FfsHash::hashTree when both models have them,
+// subtrees of equal pairs are skipped. Added and removed items with equal data
+// are reported as moved. Regions, volumes, files, capsules, images and microcode are reported,
+// other items are only walked through.
+class FfsDiff
+{
+public:
+    FfsDiff(const TreeModel* oldTreeModel, const TreeModel* newTreeModel) : oldModel(oldTreeModel), newModel(newTreeModel), treeHashes(false) {}
+    ~FfsDiff() {};
+
+    USTATUS compare();
+
+    const std::vector<FFS_DIFF_ITEM>& getItems() const { return items; }
+    const FFS_DIFF_STATS& getStats() const { return stats; }
+
+private:
+    const TreeModel* oldModel;
+    const TreeModel* newModel;
+    std::vector<FFS_DIFF_ITEM> items;
+    FFS_DIFF_STATS stats;
+    bool treeHashes;
+    std::vector<std::string> itemHashes;    // Of added and removed items, to find moved ones
+
+    void compareChildren(const UModelIndex & oldParent, const UModelIndex & newParent, const UString & parentPath);
+    void compareItems(const UModelIndex & oldIndex, const UModelIndex & newIndex, const UString & path);
+    void addSubtree(const UINT8 change, const TreeModel* model, const UModelIndex & index, const UString & path);
+    void resolveMoves();
+    bool isReported(const TreeModel* model, const UModelIndex & index) const;
+};
+
+#endif // FFSDIFF_H
@@ -0,0 +1,917 @@
+/* ffsgenerator.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+#include "ffsgenerator.h"
+
+#include "descriptor.h"
+#include "ffs.h"
+#include "fit.h"
+#include "gbe.h"
+#include "me.h"
+#include "nvram.h"
+#include "peimage.h"
+#include "sha256.h"
+#include "utility.h"
+#include "LZMA/LzmaCompress.h"
+#include "Tiano/EfiTianoCompress.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define GENERATOR_BLOCK_SIZE                0x1000
+#define GENERATOR_IMAGE_SIZE_ALIGNMENT      0x100000
+#define GENERATOR_MAX_DESCRIPTOR_IMAGE_SIZE 0x8000000 // FLREG base and limit are 15 bits of 4K blocks
+#define GENERATOR_MAX_MODULE_SIZE           0x800000  // Keeps every section below the 16M limit of a 3-byte size
+#define GENERATOR_MIN_MODULE_SIZE           0x200
+#define GENERATOR_MAX_VOLUME_SIZE           0xFFFFF000ULL
+#define GENERATOR_GBE_REGION_SIZE           0x2000
+#define GENERATOR_ME_VERSION_OFFSET         0x20
+#define GENERATOR_MAX_ME_PARTITIONS         1000      // Partition names are P000 to P999
+#define GENERATOR_MAX_ME_MODULES            100       // Module names are mod00 to mod99
+#define GENERATOR_NVRAM_FREE_SPACE          0x1000
+#define GENERATOR_NVRAM_STORE_FREE_SPACE    0x100
+#define GENERATOR_MAX_NVRAM_VARIABLES       0x100000
+#define GENERATOR_MAX_MICROCODE_UPDATES     1000
+#define GENERATOR_WRITE_CHUNK_SIZE          0x100000
+
+// xorshift64 with the state mixed from the seed by splitmix64, so neighbouring seeds give unrelated images
+class GeneratorRandom
+{
+public:
+    explicit GeneratorRandom(const UINT64 seed) {
+        UINT64 z = seed + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        state = (z ^ (z >> 31)) | 1; // Zero state would stay zero
+    }
+
+    UINT64 next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    EFI_GUID guid() {
+        EFI_GUID guid;
+        UINT64 low = next();
+        UINT64 high = next();
+        memcpy(&guid, &low, sizeof(low));
+        memcpy((UINT8*)&guid + sizeof(low), &high, sizeof(high));
+        return guid;
+    }
+
+private:
+    UINT64 state;
+};
+
+// Planned FFS file, only metadata is kept until the file is written
+struct GENERATOR_FILE {
+    EFI_GUID name;
+    UINT32 module;
+    UINT32 number;
+};
+
+struct GENERATOR_VOLUME {
+    UINT32 size;
+    bool hasNvarStore;
+    bool hasVtf;
+    std::vector<GENERATOR_FILE> files;
+};
+
+// Sections are aligned to 4 bytes from the start of the file data, and so from the start of the string
+static void appendSection(std::string & sections, const UINT8 type, const std::string & body)
+{
+    while (sections.size() % 4)
+        sections += '\x00';
+
+    UINT32 size = (UINT32)(sizeof(EFI_COMMON_SECTION_HEADER) + body.size());
+    EFI_COMMON_SECTION_HEADER header;
+    uint32ToUint24(size, header.Size);
+    header.Type = type;
+    sections.append((const char*)&header, sizeof(header));
+    sections += body;
+}
+
+static std::string uiSection(const UINT32 number)
+{
+    std::string name = "Module" + std::to_string(number);
+    std::string body;
+    for (size_t i = 0; i <= name.size(); i++) {
+        body += i < name.size() ? name[i] : '\x00';
+        body += '\x00';
+    }
+
+    std::string section;
+    appendSection(section, EFI_SECTION_USER_INTERFACE, body);
+    return section;
+}
+
+// X64 boot service driver headers followed by code-like bytes, compresses a few times like real modules
+static std::string peImage(const UINT32 size, GeneratorRandom & random)
+{
+    static const char* tokens[] = { "\x48\x89\x5C\x24\x08", "\x57\x48\x83\xEC\x20", "\xE8\x10\x20", "\x48\x8B\xC8", "\xC3", "\x33\xC0", "\xFF\x15" };
+
+    std::string image(size, '\x00');
+    EFI_IMAGE_DOS_HEADER* dosHeader = (EFI_IMAGE_DOS_HEADER*)&image[0];
+    dosHeader->e_magic = EFI_IMAGE_DOS_SIGNATURE;
+    dosHeader->e_lfanew = sizeof(EFI_IMAGE_DOS_HEADER);
+    EFI_IMAGE_PE_HEADER* peHeader = (EFI_IMAGE_PE_HEADER*)(dosHeader + 1);
+    peHeader->Signature = EFI_IMAGE_PE_SIGNATURE;
+    EFI_IMAGE_FILE_HEADER* fileHeader = (EFI_IMAGE_FILE_HEADER*)(peHeader + 1);
+    fileHeader->Machine = EFI_IMAGE_FILE_MACHINE_AMD64;
+    fileHeader->SizeOfOptionalHeader = sizeof(EFI_IMAGE_OPTIONAL_HEADER64);
+    fileHeader->Characteristics = EFI_IMAGE_FILE_EXECUTABLE_IMAGE;
+    EFI_IMAGE_OPTIONAL_HEADER64* optionalHeader = (EFI_IMAGE_OPTIONAL_HEADER64*)(fileHeader + 1);
+    UINT32 headersSize = (UINT32)((UINT8*)(optionalHeader + 1) - (UINT8*)dosHeader);
+    optionalHeader->Magic = EFI_IMAGE_PE_OPTIONAL_HDR64_MAGIC;
+    optionalHeader->AddressOfEntryPoint = headersSize;
+    optionalHeader->BaseOfCode = headersSize;
+    optionalHeader->SectionAlignment = 0x20;
+    optionalHeader->FileAlignment = 0x20;
+    optionalHeader->SizeOfImage = size;
+    optionalHeader->SizeOfHeaders = headersSize;
+    optionalHeader->Subsystem = EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER;
+
+    UINT32 offset = headersSize;
+    while (offset < size) {
+        UINT64 value = random.next();
+        if (value % 4 == 0) {
+            image[offset++] = (char)(value >> 8);
+            continue;
+        }
+        const char* token = tokens[(value >> 8) % (sizeof(tokens) / sizeof(tokens[0]))];
+        UINT32 length = (UINT32)strlen(token);
+        for (UINT32 i = 0; i < length && offset < size; i++)
+            image[offset++] = token[i];
+    }
+    return image;
+}
+
+// Wraps sections into a compressed section, or a GUID defined section for LZMA
+static USTATUS compressedSection(const std::string & sections, const UINT8 algorithm, std::string & section)
+{
+    UINT32 compressedSize = (UINT32)sections.size() * 2 + 0x1000;
+    std::string compressed(compressedSize, '\x00');
+    USTATUS result = U_SUCCESS;
+    switch (algorithm) {
+    case COMPRESSION_ALGORITHM_NONE:
+        compressed = sections;
+        compressedSize = (UINT32)sections.size();
+        break;
+    case COMPRESSION_ALGORITHM_EFI11:
+        result = EfiCompress(sections.data(), (UINT32)sections.size(), &compressed[0], &compressedSize);
+        break;
+    case COMPRESSION_ALGORITHM_TIANO:
+        result = TianoCompress(sections.data(), (UINT32)sections.size(), &compressed[0], &compressedSize);
+        break;
+    case COMPRESSION_ALGORITHM_LZMA:
+        result = LzmaCompress((const UINT8*)sections.data(), (UINT32)sections.size(), (UINT8*)&compressed[0], &compressedSize, DEFAULT_LZMA_DICTIONARY_SIZE);
+        break;
+    default:
+        return U_INVALID_PARAMETER;
+    }
+    if (result)
+        return result;
+    compressed.resize(compressedSize);
+
+    std::string body;
+    if (algorithm == COMPRESSION_ALGORITHM_LZMA) {
+        EFI_GUID_DEFINED_SECTION guidDefined;
+        memcpy(&guidDefined.SectionDefinitionGuid, EFI_GUIDED_SECTION_LZMA.constData(), sizeof(EFI_GUID));
+        guidDefined.DataOffset = sizeof(EFI_COMMON_SECTION_HEADER) + sizeof(EFI_GUID_DEFINED_SECTION);
+        guidDefined.Attributes = EFI_GUIDED_SECTION_PROCESSING_REQUIRED;
+        body.assign((const char*)&guidDefined, sizeof(guidDefined));
+    }
+    else {
+        EFI_COMPRESSION_SECTION compression;
+        compression.UncompressedLength = (UINT32)sections.size();
+        compression.CompressionType = algorithm == COMPRESSION_ALGORITHM_NONE ? EFI_NOT_COMPRESSED : EFI_STANDARD_COMPRESSION;
+        body.assign((const char*)&compression, sizeof(compression));
+    }
+    body += compressed;
+    if (sizeof(EFI_COMMON_SECTION_HEADER) + body.size() > 0xFFFFFF)
+        return U_INVALID_PARAMETER;
+
+    section.clear();
+    appendSection(section, algorithm == COMPRESSION_ALGORITHM_LZMA ? EFI_SECTION_GUID_DEFINED : EFI_SECTION_COMPRESSION, body);
+    return U_SUCCESS;
+}
+
+static std::string fileHeader(const EFI_GUID & name, const UINT8 type, const UINT32 size)
+{
+    EFI_FFS_FILE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.Name = name;
+    header.Type = type;
+    uint32ToUint24(size, header.Size);
+    // Header checksum is calculated with zero State and File checksum
+    header.IntegrityCheck.Checksum.Header = calculateChecksum8((const UINT8*)&header, sizeof(header));
+    header.IntegrityCheck.Checksum.File = FFS_FIXED_CHECKSUM2;
+    header.State = (UINT8)~(EFI_FILE_HEADER_CONSTRUCTION | EFI_FILE_HEADER_VALID | EFI_FILE_DATA_VALID);
+    return std::string((const char*)&header, sizeof(header));
+}
+
+static UINT32 volumeHeaderSize()
+{
+    return ALIGN8(sizeof(EFI_FIRMWARE_VOLUME_HEADER) + 2 * sizeof(EFI_FV_BLOCK_MAP_ENTRY));
+}
+
+static std::string volumeHeader(const UByteArray & fileSystemGuid, const UINT32 size)
+{
+    UINT32 headerSize = volumeHeaderSize();
+    std::string header(headerSize, '\x00');
+    EFI_FIRMWARE_VOLUME_HEADER* volume = (EFI_FIRMWARE_VOLUME_HEADER*)&header[0];
+    memcpy(&volume->FileSystemGuid, fileSystemGuid.constData(), sizeof(EFI_GUID));
+    volume->FvLength = size;
+    volume->Signature = EFI_FV_SIGNATURE;
+    volume->Attributes = 0x0004FEFF; // Erase polarity 1, 16 byte alignment
+    volume->HeaderLength = (UINT16)headerSize;
+    volume->Revision = 2;
+    EFI_FV_BLOCK_MAP_ENTRY* blockMap = (EFI_FV_BLOCK_MAP_ENTRY*)(volume + 1);
+    blockMap->NumBlocks = size / GENERATOR_BLOCK_SIZE;
+    blockMap->Length = GENERATOR_BLOCK_SIZE;
+    volume->Checksum = calculateChecksum16((const UINT16*)header.data(), headerSize);
+    return header;
+}
+
+// Variables of one VSS store
+static std::string vssVariables(const UINT32 variables, GeneratorRandom & random)
+{
+    std::string store;
+    for (UINT32 i = 0; i < variables; i++) {
+        std::string name = "Var" + std::to_string(i);
+        std::string data(4 + (UINT32)(random.next() % 60), '\x00');
+        for (size_t j = 0; j < data.size(); j++)
+            data[j] = (char)random.next();
+
+        VSS_VARIABLE_HEADER header;
+        memset(&header, 0, sizeof(header));
+        header.StartId = NVRAM_VSS_VARIABLE_START_ID;
+        header.State = NVRAM_VSS_VARIABLE_ADDED;
+        header.Attributes = NVRAM_VSS_VARIABLE_NON_VOLATILE | NVRAM_VSS_VARIABLE_BOOTSERVICE_ACCESS | NVRAM_VSS_VARIABLE_RUNTIME_ACCESS;
+        header.NameSize = (UINT32)(name.size() + 1) * sizeof(CHAR16);
+        header.DataSize = (UINT32)data.size();
+        header.VendorGuid = random.guid();
+        store.append((const char*)&header, sizeof(header));
+        for (size_t j = 0; j <= name.size(); j++) {
+            store += j < name.size() ? name[j] : '\x00';
+            store += '\x00';
+        }
+        store += data;
+    }
+    return store;
+}
+
+static void appendVssStore(std::string & volume, const std::string & variables, const UINT32 size)
+{
+    VSS_VARIABLE_STORE_HEADER storeHeader;
+    memset(&storeHeader, 0, sizeof(storeHeader));
+    storeHeader.Signature = NVRAM_VSS_STORE_SIGNATURE;
+    storeHeader.Size = size;
+    storeHeader.Format = NVRAM_VSS_VARIABLE_STORE_FORMATTED;
+    storeHeader.State = NVRAM_VSS_VARIABLE_STORE_HEALTHY;
+    volume.append((const char*)&storeHeader, sizeof(storeHeader));
+    volume += variables;
+    volume.append(size - sizeof(storeHeader) - variables.size(), '\xFF');
+}
+
+// VSS stores in an NVRAM volume, placed at the start of BIOS region like in most boards.
+// All stores but the last one have little free space, the last one takes the rest of the volume.
+static std::string nvramVolume(const UINT32 variables, const UINT32 stores, GeneratorRandom & random)
+{
+    std::vector<std::string> storeVariables;
+    UINT32 fullStoresSize = 0;
+    for (UINT32 i = 0; i < stores; i++) {
+        storeVariables.push_back(vssVariables(variables, random));
+        if (i + 1 < stores)
+            fullStoresSize += (UINT32)ALIGN8(sizeof(VSS_VARIABLE_STORE_HEADER) + storeVariables.back().size() + GENERATOR_NVRAM_STORE_FREE_SPACE);
+    }
+
+    UINT32 headerSize = volumeHeaderSize();
+    UINT32 size = (UINT32)ALIGN8(headerSize + fullStoresSize + sizeof(VSS_VARIABLE_STORE_HEADER) + storeVariables.back().size() + GENERATOR_NVRAM_FREE_SPACE);
+    size = (size + GENERATOR_BLOCK_SIZE - 1) & ~(GENERATOR_BLOCK_SIZE - 1);
+
+    std::string volume = volumeHeader(NVRAM_MAIN_STORE_VOLUME_GUID, size);
+    for (UINT32 i = 0; i + 1 < stores; i++)
+        appendVssStore(volume, storeVariables[i], (UINT32)ALIGN8(sizeof(VSS_VARIABLE_STORE_HEADER) + storeVariables[i].size() + GENERATOR_NVRAM_STORE_FREE_SPACE));
+    appendVssStore(volume, storeVariables.back(), size - headerSize - fullStoresSize);
+    return volume;
+}
+
+// Apple microcode volume of Intel microcode updates, 8K to 64K each and packed back to back
+static std::string microcodeVolume(const UINT32 updates, GeneratorRandom & random)
+{
+    std::string body;
+    for (UINT32 i = 0; i < updates; i++) {
+        UINT32 totalSize = (UINT32)(8 + random.next() % 57) * 1024;
+        std::string update(totalSize, '\x00');
+        INTEL_MICROCODE_HEADER* header = (INTEL_MICROCODE_HEADER*)&update[0];
+        header->HeaderVersion = INTEL_MICROCODE_HEADER_VERSION_1;
+        header->UpdateRevision = (UINT32)(random.next() & 0xFFFF);
+        header->DateYear = 0x2020 + (UINT16)(i % 10);
+        header->DateDay = 0x10 + (UINT8)(i % 10);
+        header->DateMonth = 0x01 + (UINT8)(i % 9);
+        header->ProcessorSignature = 0x000906A0 + i;
+        header->LoaderRevision = 1;
+        header->ProcessorFlags = (UINT8)(1 << (i % 8));
+        header->DataSize = totalSize - sizeof(INTEL_MICROCODE_HEADER);
+        header->TotalSize = totalSize;
+        for (size_t j = sizeof(INTEL_MICROCODE_HEADER); j < update.size(); j++)
+            update[j] = (char)random.next();
+        header->Checksum = calculateChecksum32((const UINT32*)update.data(), totalSize);
+        body += update;
+    }
+
+    UINT32 size = (UINT32)(EFI_APPLE_MICROCODE_VOLUME_HEADER_SIZE + body.size() + GENERATOR_BLOCK_SIZE - 1) & ~(GENERATOR_BLOCK_SIZE - 1);
+    std::string volume = volumeHeader(EFI_APPLE_MICROCODE_VOLUME_GUID, size);
+    volume.append(EFI_APPLE_MICROCODE_VOLUME_HEADER_SIZE - volume.size(), '\xFF');
+    volume += body;
+    volume.append(size - volume.size(), '\xFF');
+    return volume;
+}
+
+// AMI NVAR store file with GUIDs stored in every entry
+static std::string nvarStoreFile(const UINT32 variables, GeneratorRandom & random)
+{
+    std::string body;
+    for (UINT32 i = 0; i < variables; i++) {
+        std::string name = "Var" + std::to_string(i);
+        std::string data(4 + (UINT32)(random.next() % 60), '\x00');
+        for (size_t j = 0; j < data.size(); j++)
+            data[j] = (char)random.next();
+        EFI_GUID guid = random.guid();
+
+        NVAR_ENTRY_HEADER header;
+        header.Signature = NVRAM_NVAR_ENTRY_SIGNATURE;
+        header.Size = (UINT16)(sizeof(header) + sizeof(guid) + name.size() + 1 + data.size());
+        header.Next = 0xFFFFFF;
+        header.Attributes = NVRAM_NVAR_ENTRY_VALID | NVRAM_NVAR_ENTRY_ASCII_NAME | NVRAM_NVAR_ENTRY_GUID | NVRAM_NVAR_ENTRY_RUNTIME;
+        body.append((const char*)&header, sizeof(header));
+        body.append((const char*)&guid, sizeof(guid));
+        body.append(name.c_str(), name.size() + 1);
+        body += data;
+    }
+    body.append(GENERATOR_NVRAM_FREE_SPACE, '\xFF');
+
+    EFI_GUID name;
+    memcpy(&name, NVRAM_NVAR_STORE_FILE_GUID.constData(), sizeof(EFI_GUID));
+    return fileHeader(name, EFI_FV_FILETYPE_RAW, (UINT32)(sizeof(EFI_FFS_FILE_HEADER) + body.size())) + body;
+}
+
+// Reset vector data at the very top of the image
+static std::string vtfFile()
+{
+    X86_RESET_VECTOR_DATA data;
+    memset(&data, 0, sizeof(data));
+    memcpy(data.ApEntryVector, "\x90\x90\xE9\xAB\xFF\x90\x90\x90", sizeof(data.ApEntryVector));
+    memcpy(data.ResetVector, "\x90\x90\xE9\x8B\xFF\x90\x90\x90", sizeof(data.ResetVector));
+    data.PeiCoreEntryPoint = 0xFFFFFF00;
+
+    EFI_GUID name;
+    memcpy(&name, EFI_FFS_VOLUME_TOP_FILE_GUID.constData(), sizeof(EFI_GUID));
+    return fileHeader(name, EFI_FV_FILETYPE_RAW, (UINT32)(sizeof(EFI_FFS_FILE_HEADER) + sizeof(data)))
+        + std::string((const char*)&data, sizeof(data));
+}
+
+static std::string intelDescriptor(const UINT64 imageSize, const UINT32 meOffset, const UINT32 meSize, const UINT32 biosOffset)
+{
+    std::string descriptor(FLASH_DESCRIPTOR_SIZE, '\xFF');
+    FLASH_DESCRIPTOR_HEADER* header = (FLASH_DESCRIPTOR_HEADER*)&descriptor[0];
+    header->Signature = FLASH_DESCRIPTOR_SIGNATURE;
+
+    // Big images are split between two chips of the same size
+    UINT8 chips = imageSize > 0x4000000 ? 2 : 1;
+    UINT8 density = FLASH_DENSITY_512KB;
+    while ((0x80000ULL << density) * chips < imageSize)
+        density++;
+
+    FLASH_DESCRIPTOR_MAP* map = (FLASH_DESCRIPTOR_MAP*)(header + 1);
+    memset(map, 0, sizeof(FLASH_DESCRIPTOR_MAP));
+    map->ComponentBase = 0x03;
+    map->NumberOfFlashChips = chips - 1;
+    map->RegionBase = 0x04;
+    map->NumberOfRegions = 3;
+    map->MasterBase = 0x08;
+    map->NumberOfMasters = 2;
+    map->PchStrapsBase = 0x10;
+    map->ProcStrapsBase = 0x20;
+    map->DescriptorVersion = FLASH_DESCRIPTOR_VERSION_INVALID;
+
+    // 20 MHz read clock marks v1 descriptor
+    FLASH_DESCRIPTOR_COMPONENT_SECTION* component = (FLASH_DESCRIPTOR_COMPONENT_SECTION*)calculateAddress8((UINT8*)header, map->ComponentBase);
+    memset(component, 0, sizeof(FLASH_DESCRIPTOR_COMPONENT_SECTION));
+    component->FlashParameters.FirstChipDensity = density;
+    component->FlashParameters.SecondChipDensity = chips > 1 ? density : FLASH_DENSITY_UNUSED;
+    component->FlashParameters.ReadClockFrequency = FLASH_FREQUENCY_20MHZ;
+
+    // Absent regions have zero limit
+    UINT16* region = (UINT16*)calculateAddress8((UINT8*)header, map->RegionBase);
+    for (UINT32 i = 0; i < sizeof(FLASH_DESCRIPTOR_REGION_SECTION) / sizeof(UINT16); i += 2) {
+        region[i] = 0x7FFF;
+        region[i + 1] = 0;
+    }
+    FLASH_DESCRIPTOR_REGION_SECTION* regions = (FLASH_DESCRIPTOR_REGION_SECTION*)region;
+    regions->DescriptorBase = 0;
+    regions->DescriptorLimit = 0;
+    regions->GbeBase = FLASH_DESCRIPTOR_SIZE / GENERATOR_BLOCK_SIZE;
+    regions->GbeLimit = (FLASH_DESCRIPTOR_SIZE + GENERATOR_GBE_REGION_SIZE - 1) / GENERATOR_BLOCK_SIZE;
+    regions->MeBase = (UINT16)(meOffset / GENERATOR_BLOCK_SIZE);
+    regions->MeLimit = (UINT16)((meOffset + meSize - 1) / GENERATOR_BLOCK_SIZE);
+    regions->BiosBase = (UINT16)(biosOffset / GENERATOR_BLOCK_SIZE);
+    regions->BiosLimit = (UINT16)((imageSize - 1) / GENERATOR_BLOCK_SIZE);
+
+    FLASH_DESCRIPTOR_MASTER_SECTION* master = (FLASH_DESCRIPTOR_MASTER_SECTION*)calculateAddress8((UINT8*)header, map->MasterBase);
+    memset(master, 0, sizeof(FLASH_DESCRIPTOR_MASTER_SECTION));
+    master->BiosRead = FLASH_DESCRIPTOR_REGION_ACCESS_DESC | FLASH_DESCRIPTOR_REGION_ACCESS_BIOS | FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+    master->BiosWrite = FLASH_DESCRIPTOR_REGION_ACCESS_BIOS | FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+    master->MeRead = FLASH_DESCRIPTOR_REGION_ACCESS_DESC | FLASH_DESCRIPTOR_REGION_ACCESS_ME | FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+    master->MeWrite = FLASH_DESCRIPTOR_REGION_ACCESS_ME | FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+    master->GbeRead = FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+    master->GbeWrite = FLASH_DESCRIPTOR_REGION_ACCESS_GBE;
+
+    // Empty VSCC table
+    FLASH_DESCRIPTOR_UPPER_MAP* upperMap = (FLASH_DESCRIPTOR_UPPER_MAP*)&descriptor[FLASH_DESCRIPTOR_UPPER_MAP_BASE];
+    memset(upperMap, 0, sizeof(FLASH_DESCRIPTOR_UPPER_MAP));
+    return descriptor;
+}
+
+static std::string gbeRegion(GeneratorRandom & random)
+{
+    std::string gbe(GENERATOR_GBE_REGION_SIZE, '\xFF');
+    GBE_MAC_ADDRESS* mac = (GBE_MAC_ADDRESS*)&gbe[0];
+    memcpy(mac->vendor, "\x00\x1B\x21", sizeof(mac->vendor));
+    UINT64 device = random.next();
+    memcpy(mac->device, &device, sizeof(mac->device));
+    GBE_VERSION* version = (GBE_VERSION*)&gbe[GBE_VERSION_OFFSET];
+    version->id = 0;
+    version->minor = 3;
+    version->major = 1;
+    return gbe;
+}
+
+// Hashes in CPD extensions are stored reversed
+static std::string reversedSha256(const std::string & data)
+{
+    UINT8 hash[SHA256_DIGEST_SIZE];
+    sha256(data.data(), (unsigned long)data.size(), hash);
+    return std::string(std::reverse_iterator<UINT8*>(hash + SHA256_DIGEST_SIZE), std::reverse_iterator<UINT8*>(hash));
+}
+
+static void appendCpdEntry(std::string & directory, const std::string & name, const UINT32 offset, const UINT32 length)
+{
+    CPD_ENTRY entry;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.EntryName, name.data(), name.size());
+    entry.Offset.Offset = offset;
+    entry.Length = length;
+    directory.append((const char*)&entry, sizeof(entry));
+}
+
+// Code partition with CPD directory of a manifest, metadata of every module and the modules themselves.
+// Manifest lists hashes of metadata and metadata hold hashes of uncompressed modules, as the parser checks them
+static std::string cpdPartition(const char* partitionName, const UINT32 number, const UINT32 modules, const UINT32 moduleSize, GeneratorRandom & random)
+{
+    std::vector<std::string> names, metadata, code;
+    for (UINT32 i = 0; i < modules; i++) {
+        char name[13];
+        snprintf(name, sizeof(name), "mod%02u", i % 100);
+        names.push_back(name);
+
+        std::string body(moduleSize, '\x00');
+        for (UINT32 j = 0; j < moduleSize; j += 8) {
+            UINT64 value = random.next();
+            memcpy(&body[j], &value, std::min<UINT32>(8, moduleSize - j));
+        }
+        code.push_back(body);
+
+        CPD_EXT_MODULE_ATTRIBUTES attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.ExtensionType = CPD_EXT_TYPE_MODULE_ATTRIBUTES;
+        attributes.ExtensionLength = (UINT32)(CpdExtModuleImageHashOffset + SHA256_DIGEST_SIZE);
+        attributes.CompressionType = CPD_EXT_MODULE_COMPRESSION_TYPE_UNCOMPRESSED;
+        attributes.UncompressedSize = moduleSize;
+        attributes.CompressedSize = moduleSize;
+        attributes.GlobalModuleId = number * 0x100 + i;
+        metadata.push_back(std::string((const char*)&attributes, sizeof(attributes)) + reversedSha256(body));
+    }
+
+    // Signed package info with metadata hashes
+    CPD_EXT_SIGNED_PACKAGE_INFO package;
+    memset(&package, 0, sizeof(package));
+    package.ExtensionType = CPD_EXT_TYPE_SIGNED_PACKAGE_INFO;
+    package.ExtensionLength = (UINT32)(sizeof(package) + modules * (CpdExtSignedPkgMetadataHashOffset + SHA256_DIGEST_SIZE));
+    memcpy(package.PackageName, partitionName, sizeof(package.PackageName));
+    std::string extensions((const char*)&package, sizeof(package));
+    for (UINT32 i = 0; i < modules; i++) {
+        CPD_EXT_SIGNED_PACKAGE_INFO_MODULE module;
+        memset(&module, 0, sizeof(module));
+        memcpy(module.Name, names[i].data(), names[i].size());
+        module.HashAlgorithm = 2; // SHA256
+        module.HashSize = SHA256_DIGEST_SIZE;
+        module.MetadataSize = (UINT32)metadata[i].size();
+        extensions += std::string((const char*)&module, sizeof(module)) + reversedSha256(metadata[i]);
+    }
+
+    CPD_MANIFEST_HEADER manifestHeader;
+    memset(&manifestHeader, 0, sizeof(manifestHeader));
+    manifestHeader.HeaderType = 4;
+    manifestHeader.HeaderLength = sizeof(manifestHeader) / sizeof(UINT32);
+    manifestHeader.HeaderVersion = 0x10000;
+    manifestHeader.Vendor = 0x8086;
+    manifestHeader.Size = (UINT32)((sizeof(manifestHeader) + extensions.size()) / sizeof(UINT32));
+    manifestHeader.HeaderId = ME_MANIFEST_HEADER_ID;
+    manifestHeader.VersionMajor = 11;
+    manifestHeader.VersionMinor = 8;
+    manifestHeader.VersionBugfix = 50;
+    manifestHeader.VersionBuild = (UINT16)(3000 + number);
+    std::string manifest = std::string((const char*)&manifestHeader, sizeof(manifestHeader)) + extensions;
+
+    // Manifest goes first, then all metadata, then modules
+    CPD_REV1_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.Signature = CPD_SIGNATURE;
+    header.NumEntries = 1 + 2 * modules;
+    header.HeaderVersion = 1;
+    header.EntryVersion = 1;
+    header.HeaderLength = sizeof(header);
+    memcpy(header.ShortName, partitionName, sizeof(header.ShortName));
+    std::string directory((const char*)&header, sizeof(header));
+
+    UINT32 offset = (UINT32)(sizeof(header) + header.NumEntries * sizeof(CPD_ENTRY));
+    std::string contents = manifest;
+    appendCpdEntry(directory, std::string(partitionName) + ".man", offset, (UINT32)manifest.size());
+    for (UINT32 i = 0; i < modules; i++) {
+        appendCpdEntry(directory, names[i] + ".met", offset + (UINT32)contents.size(), (UINT32)metadata[i].size());
+        contents += metadata[i];
+    }
+    for (UINT32 i = 0; i < modules; i++) {
+        appendCpdEntry(directory, names[i], offset + (UINT32)contents.size(), moduleSize);
+        contents += code[i];
+    }
+    return directory + contents;
+}
+
+// ME region of FPT with code partitions, the rest is erased
+static std::string meRegion(const UINT32 size, const UINT32 partitions, const UINT32 modules, const UINT32 moduleSize, GeneratorRandom & random)
+{
+    FPT_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(&header.Signature, FPT_HEADER_SIGNATURE.constData(), sizeof(header.Signature));
+    header.NumEntries = partitions;
+    header.HeaderVersion = 0x20;
+    header.EntryVersion = 0x10;
+    header.HeaderLength = sizeof(header);
+    std::string region((const char*)&header, sizeof(header));
+
+    std::string contents;
+    UINT32 offset = (UINT32)(sizeof(header) + partitions * sizeof(FPT_HEADER_ENTRY) + GENERATOR_BLOCK_SIZE - 1) & ~(GENERATOR_BLOCK_SIZE - 1);
+    for (UINT32 i = 0; i < partitions; i++) {
+        char name[5];
+        snprintf(name, sizeof(name), "P%03u", i % 1000);
+        std::string partition = cpdPartition(name, i, modules, moduleSize, random);
+        FPT_HEADER_ENTRY entry;
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.Name, name, sizeof(entry.Name));
+        entry.Offset = offset + (UINT32)contents.size();
+        entry.Size = (UINT32)partition.size();
+        region.append((const char*)&entry, sizeof(entry));
+        contents += partition;
+        contents.append(((contents.size() + GENERATOR_BLOCK_SIZE - 1) & ~(size_t)(GENERATOR_BLOCK_SIZE - 1)) - contents.size(), '\xFF');
+    }
+    region.append(offset - region.size(), '\xFF');
+    region += contents;
+    if (region.size() > size)
+        return std::string();
+    region.append(size - region.size(), '\xFF');
+    return region;
+}
+
+// ME region of IFWI 1.7 layout with empty FPT data partition and boot partition of BPDT with code partitions
+static std::string ifwiRegion(const UINT32 size, const UINT32 partitions, const UINT32 modules, const UINT32 moduleSize, GeneratorRandom & random)
+{
+    static const UINT16 types[] = { BPDT_ENTRY_TYPE_CSE_BUP, BPDT_ENTRY_TYPE_CSE_MAIN, BPDT_ENTRY_TYPE_ISH, BPDT_ENTRY_TYPE_PMC,
+        BPDT_ENTRY_TYPE_IUNIT, BPDT_ENTRY_TYPE_WLAN_UCODE, BPDT_ENTRY_TYPE_LOCL_SPRITES, BPDT_ENTRY_TYPE_TCSS_FW_IOM };
+
+    BPDT_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.Signature = BPDT_GREEN_SIGNATURE;
+    header.NumEntries = (UINT16)partitions;
+    header.HeaderVersion = BPDT_HEADER_VERSION_1;
+    header.FitcMajor = 11;
+    header.FitcMinor = 8;
+    header.FitcHotfix = 50;
+    header.FitcBuild = (UINT16)(3000 + random.next() % 1000);
+    std::string bpdt((const char*)&header, sizeof(header));
+
+    std::string contents;
+    UINT32 offset = (UINT32)(sizeof(header) + partitions * sizeof(BPDT_ENTRY) + GENERATOR_BLOCK_SIZE - 1) & ~(GENERATOR_BLOCK_SIZE - 1);
+    for (UINT32 i = 0; i < partitions; i++) {
+        char name[5];
+        snprintf(name, sizeof(name), "P%03u", i % 1000);
+        std::string partition = cpdPartition(name, i, modules, moduleSize, random);
+        BPDT_ENTRY entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.Type = types[i % (sizeof(types) / sizeof(types[0]))];
+        entry.CodeSubPartition = 1;
+        entry.Offset = offset + (UINT32)contents.size();
+        entry.Size = (UINT32)partition.size();
+        bpdt.append((const char*)&entry, sizeof(entry));
+        contents += partition;
+        contents.append(((contents.size() + GENERATOR_BLOCK_SIZE - 1) & ~(size_t)(GENERATOR_BLOCK_SIZE - 1)) - contents.size(), '\xFF');
+    }
+    bpdt.append(offset - bpdt.size(), '\xFF');
+    bpdt += contents;
+
+    // Data partition takes the block after the layout header, boot partition follows it
+    FPT_HEADER fptHeader;
+    memset(&fptHeader, 0, sizeof(fptHeader));
+    memcpy(&fptHeader.Signature, FPT_HEADER_SIGNATURE.constData(), sizeof(fptHeader.Signature));
+    fptHeader.HeaderVersion = 0x20;
+    fptHeader.EntryVersion = 0x10;
+    fptHeader.HeaderLength = sizeof(fptHeader);
+
+    IFWI_17_LAYOUT_HEADER layout;
+    memset(&layout, 0, sizeof(layout));
+    layout.HeaderSize = sizeof(layout);
+    layout.DataPartition.Offset = GENERATOR_BLOCK_SIZE;
+    layout.DataPartition.Size = GENERATOR_BLOCK_SIZE;
+    layout.BootPartition[0].Offset = 2 * GENERATOR_BLOCK_SIZE;
+    layout.BootPartition[0].Size = (UINT32)bpdt.size();
+    for (UINT32 i = 1; i < 5; i++)
+        layout.BootPartition[i].Offset = 0xFFFFFFFF;
+    layout.TempPage.Offset = 0xFFFFFFFF;
+
+    std::string region((const char*)&layout, sizeof(layout));
+    region.append(GENERATOR_BLOCK_SIZE - region.size(), '\xFF');
+    region.append((const char*)&fptHeader, sizeof(fptHeader));
+    region.append(2 * GENERATOR_BLOCK_SIZE - region.size(), '\xFF');
+    region += bpdt;
+    if (region.size() > size)
+        return std::string();
+    region.append(size - region.size(), '\xFF');
+    return region;
+}
+
+static bool writeBytes(std::ostream & output, const std::string & bytes, UINT64 & written)
+{
+    output.write(bytes.data(), bytes.size());
+    written += bytes.size();
+    return (bool)output;
+}
+
+static bool writeFill(std::ostream & output, const char value, UINT64 count, UINT64 & written)
+{
+    static const std::string erased(GENERATOR_WRITE_CHUNK_SIZE, '\xFF');
+    static const std::string zeroes(GENERATOR_WRITE_CHUNK_SIZE, '\x00');
+    const std::string & chunk = value == '\xFF' ? erased : zeroes;
+    while (count) {
+        UINT64 size = count < chunk.size() ? count : chunk.size();
+        output.write(chunk.data(), size);
+        written += size;
+        count -= size;
+    }
+    return (bool)output;
+}
+
+static UINT32 plannedFileSize(const std::vector<std::string> & modules, const GENERATOR_FILE & file)
+{
+    std::string name = "Module" + std::to_string(file.number);
+    return (UINT32)(sizeof(EFI_FFS_FILE_HEADER) + ALIGN4(modules[file.module].size())
+        + sizeof(EFI_COMMON_SECTION_HEADER) + (name.size() + 1) * sizeof(CHAR16));
+}
+
+// Files are laid out from the start of the volume, the VTF of the last volume ends at its top.
+// The gap before VTF is filled by a pad file, so it is either empty or fits a file header.
+static bool fitsIntoVolume(const UINT64 end, const GENERATOR_VOLUME & volume, const UINT32 vtfSize)
+{
+    if (!volume.hasVtf)
+        return end <= volume.size;
+    UINT64 vtfOffset = volume.size - vtfSize;
+    return ALIGN8(end) == vtfOffset || ALIGN8(end) + sizeof(EFI_FFS_FILE_HEADER) <= vtfOffset;
+}
+
+USTATUS generateImage(const GENERATOR_OPTIONS & options, std::ostream & output)
+{
+    // Check options
+    if (options.volumes == 0
+        || options.moduleSize < GENERATOR_MIN_MODULE_SIZE || options.moduleSize > GENERATOR_MAX_MODULE_SIZE
+        || options.uniqueModules == 0
+        || options.imageSize % GENERATOR_BLOCK_SIZE
+        || (options.filesPerVolume == 0 && options.imageSize == 0)
+        || options.nvramStores == 0 || (UINT64)options.nvramVariables * options.nvramStores > GENERATOR_MAX_NVRAM_VARIABLES
+        || options.microcodeUpdates > GENERATOR_MAX_MICROCODE_UPDATES)
+        return U_INVALID_PARAMETER;
+    if (options.compression != COMPRESSION_ALGORITHM_NONE && options.compression != COMPRESSION_ALGORITHM_EFI11
+        && options.compression != COMPRESSION_ALGORITHM_TIANO && options.compression != COMPRESSION_ALGORITHM_LZMA)
+        return U_INVALID_PARAMETER;
+    if (options.intelDescriptor
+        && (options.meRegionSize == 0 || options.meRegionSize % GENERATOR_BLOCK_SIZE || options.imageSize > GENERATOR_MAX_DESCRIPTOR_IMAGE_SIZE))
+        return U_INVALID_PARAMETER;
+    if (options.mePartitions
+        && (!options.intelDescriptor || options.mePartitions > GENERATOR_MAX_ME_PARTITIONS
+            || options.meModules == 0 || options.meModules > GENERATOR_MAX_ME_MODULES || options.meModuleSize == 0))
+        return U_INVALID_PARAMETER;
+    if (options.meIfwi && options.mePartitions == 0)
+        return U_INVALID_PARAMETER;
+
+    // Every part of the image has its own stream, so changing one parameter does not reshuffle the others
+    GeneratorRandom moduleRandom(options.seed * 4 + 0);
+    GeneratorRandom fileRandom(options.seed * 4 + 1);
+    GeneratorRandom nvramRandom(options.seed * 4 + 2);
+    GeneratorRandom regionRandom(options.seed * 4 + 3);
+
+    // Module bodies, the expensive part, are built once
+    std::vector<std::string> modules;
+    for (UINT32 i = 0; i < options.uniqueModules; i++) {
+        std::string sections;
+        appendSection(sections, EFI_SECTION_PE32, peImage(options.moduleSize, moduleRandom));
+        for (UINT32 depth = 0; depth < options.compressionDepth; depth++) {
+            std::string compressed;
+            USTATUS result = compressedSection(sections, options.compression, compressed);
+            if (result)
+                return result;
+            sections = compressed;
+        }
+        modules.push_back(sections);
+    }
+
+    std::string nvram;
+    std::string nvarStore;
+    if (options.nvramVariables) {
+        nvram = nvramVolume(options.nvramVariables, options.nvramStores, nvramRandom);
+        nvarStore = nvarStoreFile(options.nvramVariables, nvramRandom);
+    }
+    // Taken from NVRAM stream after NVRAM, so images without microcode keep their bytes
+    std::string microcode;
+    if (options.microcodeUpdates) {
+        microcode = microcodeVolume(options.microcodeUpdates, nvramRandom);
+    }
+    const std::string vtf = vtfFile();
+    const UINT32 headerSize = volumeHeaderSize();
+    const UINT32 vtfSize = (UINT32)vtf.size();
+
+    UINT64 regionsSize = options.intelDescriptor ? FLASH_DESCRIPTOR_SIZE + GENERATOR_GBE_REGION_SIZE + options.meRegionSize : 0;
+
+    // Plan volumes, in fill mode BIOS region is split between them evenly
+    std::vector<GENERATOR_VOLUME> volumes(options.volumes);
+    UINT64 fillVolumeSize = 0;
+    if (options.filesPerVolume == 0) {
+        if (options.imageSize < regionsSize + nvram.size() + microcode.size())
+            return U_INVALID_PARAMETER;
+        fillVolumeSize = ((options.imageSize - regionsSize - nvram.size() - microcode.size()) / options.volumes) & ~(UINT64)(GENERATOR_BLOCK_SIZE - 1);
+        if (fillVolumeSize > GENERATOR_MAX_VOLUME_SIZE || fillVolumeSize < headerSize + nvarStore.size() + vtfSize + GENERATOR_BLOCK_SIZE)
+            return U_INVALID_PARAMETER;
+    }
+
+    UINT32 number = 0;
+    UINT64 contentSize = nvram.size() + microcode.size();
+    for (UINT32 i = 0; i < options.volumes; i++) {
+        GENERATOR_VOLUME & volume = volumes[i];
+        volume.hasNvarStore = (i == 0 && !nvarStore.empty());
+        volume.hasVtf = (i + 1 == options.volumes);
+        volume.size = (UINT32)fillVolumeSize;
+
+        UINT64 end = headerSize + (volume.hasNvarStore ? nvarStore.size() : 0);
+        while (options.filesPerVolume == 0 || volume.files.size() < options.filesPerVolume) {
+            GENERATOR_FILE file;
+            file.name = fileRandom.guid();
+            file.module = (UINT32)(fileRandom.next() % options.uniqueModules);
+            file.number = number;
+            UINT64 fileEnd = ALIGN8(end) + plannedFileSize(modules, file);
+            if (options.filesPerVolume == 0 && !fitsIntoVolume(fileEnd, volume, vtfSize))
+                break;
+            volume.files.push_back(file);
+            number++;
+            end = fileEnd;
+        }
+
+        if (options.filesPerVolume) {
+            UINT64 size = end + (volume.hasVtf ? vtfSize : 0);
+            size = (size + GENERATOR_BLOCK_SIZE - 1) & ~(UINT64)(GENERATOR_BLOCK_SIZE - 1);
+            if (size > GENERATOR_MAX_VOLUME_SIZE)
+                return U_INVALID_PARAMETER;
+            volume.size = (UINT32)size;
+            if (!fitsIntoVolume(end, volume, vtfSize))
+                volume.size += GENERATOR_BLOCK_SIZE;
+        }
+        contentSize += volume.size;
+    }
+
+    UINT64 imageSize = options.imageSize;
+    if (imageSize == 0)
+        imageSize = (regionsSize + contentSize + GENERATOR_IMAGE_SIZE_ALIGNMENT - 1) & ~(UINT64)(GENERATOR_IMAGE_SIZE_ALIGNMENT - 1);
+    if (imageSize < regionsSize + contentSize)
+        return U_INVALID_PARAMETER;
+    if (options.intelDescriptor && imageSize > GENERATOR_MAX_DESCRIPTOR_IMAGE_SIZE)
+        return U_INVALID_PARAMETER;
+
+    // Regions, ME partitions are built first as they may not fit
+    std::string gbe, me;
+    if (options.intelDescriptor) {
+        gbe = gbeRegion(regionRandom);
+        if (options.mePartitions) {
+            if (options.meIfwi)
+                me = ifwiRegion(options.meRegionSize, options.mePartitions, options.meModules, options.meModuleSize, regionRandom);
+            else
+                me = meRegion(options.meRegionSize, options.mePartitions, options.meModules, options.meModuleSize, regionRandom);
+            if (me.empty())
+                return U_INVALID_PARAMETER;
+        }
+    }
+    UINT64 written = 0;
+    if (options.intelDescriptor) {
+        UINT32 meOffset = FLASH_DESCRIPTOR_SIZE + GENERATOR_GBE_REGION_SIZE;
+        writeBytes(output, intelDescriptor(imageSize, meOffset, options.meRegionSize, (UINT32)regionsSize), written);
+        writeBytes(output, gbe, written);
+    }
+    if (!me.empty()) {
+        writeBytes(output, me, written);
+    }
+    else if (options.intelDescriptor) {
+        ME_VERSION version;
+        memset(&version, 0, sizeof(version));
+        memcpy(&version.Signature, ME_VERSION_SIGNATURE2.constData(), sizeof(version.Signature));
+        version.Major = 11;
+        version.Minor = 8;
+        version.Bugfix = 50;
+        version.Build = (UINT16)(3000 + regionRandom.next() % 1000);
+        writeFill(output, '\xFF', GENERATOR_ME_VERSION_OFFSET, written);
+        writeBytes(output, std::string((const char*)&version, sizeof(version)), written);
+        writeFill(output, '\xFF', options.meRegionSize - GENERATOR_ME_VERSION_OFFSET - sizeof(version), written);
+    }
+
+    // BIOS region, volumes are pushed to the top of the image
+    writeFill(output, '\xFF', imageSize - regionsSize - contentSize, written);
+    writeBytes(output, nvram, written);
+    writeBytes(output, microcode, written);
+    for (size_t i = 0; i < volumes.size(); i++) {
+        const GENERATOR_VOLUME & volume = volumes[i];
+        UINT64 volumeStart = written;
+        writeBytes(output, volumeHeader(EFI_FIRMWARE_FILE_SYSTEM2_GUID, volume.size), written);
+        if (volume.hasNvarStore)
+            writeBytes(output, nvarStore, written);
+
+        for (size_t j = 0; j < volume.files.size(); j++) {
+            const GENERATOR_FILE & file = volume.files[j];
+            const std::string & module = modules[file.module];
+            writeFill(output, '\xFF', ALIGN8(written - volumeStart) - (written - volumeStart), written);
+            UINT8 type = (i == 0) ? EFI_FV_FILETYPE_PEIM : EFI_FV_FILETYPE_DRIVER;
+            writeBytes(output, fileHeader(file.name, type, plannedFileSize(modules, file)), written);
+            writeBytes(output, module, written);
+            writeFill(output, '\x00', ALIGN4(module.size()) - module.size(), written);
+            writeBytes(output, uiSection(file.number), written);
+        }
+
+        UINT64 end = written - volumeStart;
+        if (volume.hasVtf) {
+            UINT64 vtfOffset = volume.size - vtfSize;
+            writeFill(output, '\xFF', ALIGN8(end) - end, written);
+            if (ALIGN8(end) != vtfOffset) {
+                EFI_GUID name;
+                memcpy(&name, EFI_FFS_PAD_FILE_GUID.constData(), sizeof(EFI_GUID));
+                UINT32 padSize = (UINT32)(vtfOffset - ALIGN8(end));
+                writeBytes(output, fileHeader(name, EFI_FV_FILETYPE_PAD, padSize), written);
+                writeFill(output, '\xFF', padSize - sizeof(EFI_FFS_FILE_HEADER), written);
+            }
+            writeBytes(output, vtf, written);
+        }
+        else {
+            writeFill(output, '\xFF', volume.size - end, written);
+        }
+    }
+
+    if (!output)
+        return U_FILE_WRITE;
+    return written == imageSize ? U_SUCCESS : U_INVALID_PARAMETER;
+}
+
+USTATUS generateImage(const GENERATOR_OPTIONS & options, UByteArray & image)
+{
+    if (options.imageSize > 0x7FFFFFFF)
+        return U_INVALID_PARAMETER;
+
+    std::ostringstream output;
+    USTATUS result = generateImage(options, output);
+    if (result)
+        return result;
+
+    std::string data = output.str();
+    if (data.size() > 0x7FFFFFFF)
+        return U_INVALID_PARAMETER;
+    image = UByteArray(data);
+    return U_SUCCESS;
+}
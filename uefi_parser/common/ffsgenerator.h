@@ -0,0 +1,48 @@
+/* ffsgenerator.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef FFSGENERATOR_H
+#define FFSGENERATOR_H
+
+#include <ostream>
+
+#include "basetypes.h"
+#include "ubytearray.h"
+
+// Parameters of a synthetic image, the same parameters and seed always give the same bytes
+struct GENERATOR_OPTIONS {
+    UINT64 seed = 1;
+    UINT64 imageSize = 0;               // Multiple of 4K, 0 - smallest multiple of 1M that fits all volumes
+    bool   intelDescriptor = false;     // Descriptor, GbE and ME regions in front of BIOS region, up to 128M
+    UINT32 meRegionSize = 0x100000;
+    UINT32 mePartitions = 0;            // FPT code partitions with hashed CPD modules in ME region, 0 - only ME version
+    UINT32 meModules = 4;               // Modules of every ME partition, up to 100
+    UINT32 meModuleSize = 0x4000;       // Size of every uncompressed ME module
+    bool   meIfwi = false;              // IFWI 1.7 layout with code partitions in BPDT of boot partition instead of FPT
+    UINT32 volumes = 4;                 // FFSv2 volumes, the last one ends with a VTF at the top of the image
+    UINT32 filesPerVolume = 32;         // 0 - fill volumes with files up to the image size
+    UINT32 compressionDepth = 1;        // Nested compressed sections around every module
+    UINT8  compression = COMPRESSION_ALGORITHM_LZMA; // NONE, EFI11, TIANO or LZMA
+    UINT32 moduleSize = 0x10000;        // Uncompressed size of PE32 section of every file, up to 8M
+    UINT32 nvramVariables = 32;         // Variables in VSS volume and NVAR store file, 0 - no NVRAM
+    UINT32 nvramStores = 1;             // VSS stores in NVRAM volume, every one holds nvramVariables variables
+    UINT32 microcodeUpdates = 0;        // Intel microcode updates in Apple microcode volume after NVRAM volume, 0 - no such volume, up to 1000
+    UINT32 uniqueModules = 16;          // Distinct module bodies, compressed once and reused by all files
+};
+
+// Writes the image to the stream without keeping it in memory, so multi-gigabyte images are fine
+USTATUS generateImage(const GENERATOR_OPTIONS & options, std::ostream & output);
+
+// Same for images that fit into UByteArray
+USTATUS generateImage(const GENERATOR_OPTIONS & options, UByteArray & image);
+
+#endif // FFSGENERATOR_H
@@ -0,0 +1,94 @@
+/* ffshash.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <vector>
+
+#include "ffshash.h"
+#include "parserstats.h"
+#include "sha256.h"
+#include "threadpool.h"
+
+static void hashUpdate(struct sha256_state *state, const UByteArray & data)
+{
+    sha256_process(state, (const unsigned char*)data.constData(), (unsigned long)data.size());
+}
+
+static void hashItem(TreeModel *model, const UModelIndex & index)
+{
+    // Item data is hashed in place, parents add only the size of their body, it is covered by children
+    const UByteArray & body = model->constBody(index);
+    int childCount = model->rowCount(index);
+
+    struct sha256_state state;
+    sha256_init(&state);
+    UINT8 types[2] = { model->type(index), model->subtype(index) };
+    sha256_process(&state, types, sizeof(types));
+    hashUpdate(&state, model->constHeader(index));
+    if (childCount == 0) {
+        hashUpdate(&state, body);
+    }
+    else {
+        UINT64 bodySize = body.size();
+        sha256_process(&state, (const unsigned char*)&bodySize, sizeof(bodySize));
+    }
+    hashUpdate(&state, model->constTail(index));
+    for (int i = 0; i < childCount; i++)
+        hashUpdate(&state, model->constHash(model->index(i, 0, index)));
+
+    UINT8 digest[SHA256_DIGEST_SIZE];
+    sha256_done(&state, digest);
+    model->setHash(index, UByteArray((const char*)digest, sizeof(digest)));
+}
+
+USTATUS FfsHash::hashTree(TreeModel *model)
+{
+    if (!model)
+        return U_INVALID_PARAMETER;
+
+    STATS_SCOPE(StatsTimers::TreeHash);
+
+    // Items by depth, children of the invisible root item are level 0
+    std::vector<std::vector<UModelIndex> > levels;
+    std::vector<UModelIndex> current;
+    for (int i = 0; i < model->rowCount(); i++)
+        current.push_back(model->index(i, 0));
+    while (!current.empty()) {
+        std::vector<UModelIndex> next;
+        for (size_t i = 0; i < current.size(); i++) {
+            for (int j = 0; j < model->rowCount(current[i]); j++)
+                next.push_back(model->index(j, 0, current[i]));
+        }
+        levels.push_back(current);
+        current.swap(next);
+    }
+
+    // Deepest level first, every child is hashed before its parent
+    ThreadPool & pool = sharedThreadPool();
+    for (size_t level = levels.size(); level > 0; level--) {
+        const std::vector<UModelIndex> & items = levels[level - 1];
+        pool.parallelFor(items.size(), [model, &items](size_t i) { hashItem(model, items[i]); });
+    }
+    return U_SUCCESS;
+}
+
+std::string FfsHash::hashToString(const UByteArray & hash)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string text;
+    text.reserve(hash.size() * 2);
+    for (int32_t i = 0; i < hash.size(); i++) {
+        UINT8 value = (UINT8)hash[i];
+        text += digits[value >> 4];
+        text += digits[value & 0x0F];
+    }
+    return text;
+}
@@ -0,0 +1,36 @@
+/* ffshash.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef FFSHASH_H
+#define FFSHASH_H
+
+#include <string>
+
+#include "basetypes.h"
+#include "ubytearray.h"
+#include "ustring.h"
+#include "treemodel.h"
+
+namespace FfsHash {
+
+// Sets SHA256 Merkle hash of every item of the model, bottom-up.
+// Leaves hash type, subtype, header, body and tail. Parents hash type, subtype, header,
+// body size and tail followed by hashes of their children, so equal hashes mean equal subtrees.
+// Items of one tree level are hashed in parallel on a pool shared by all callers.
+USTATUS hashTree(TreeModel *model);
+
+// Uppercase hex of a hash, empty for an empty one
+std::string hashToString(const UByteArray & hash);
+
+};
+
+#endif // FFSHASH_H
@@ -26,6 +26,9 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "parsingdata.h"
 #include "types.h"
 #include "utility.h"
+#include "utf16.h"
+#include "parsertrace.h"
+#include "threadpool.h"
 
 #include "nvramparser.h"
 #include "meparser.h"
@@ -68,9 +71,114 @@ struct CPD_PARTITION_INFO {
     friend bool operator< (const CPD_PARTITION_INFO & lhs, const CPD_PARTITION_INFO & rhs){ return lhs.ptEntry.Offset.Offset < rhs.ptEntry.Offset.Offset; }
 };
 
-// Constructor
+// Hash checks of CPD partitions
+#define CPD_HASH_UNCHECKED 0
+#define CPD_HASH_VALID     1
+#define CPD_HASH_INVALID   2
+
+static const char* cpdHashCheckToString(const UINT8 check)
+{
+    switch (check) {
+    case CPD_HASH_VALID:   return "valid";
+    case CPD_HASH_INVALID: return "invalid";
+    default:               return "not performed";
+    }
+}
+
+// Size of CPD partition within its directory, partitions starting outside of it are empty
+static UINT32 cpdPartitionSize(const UByteArray & region, const UINT32 offset, const UINT32 length)
+{
+    if (offset >= (UINT32)region.size())
+        return 0;
+    return (UINT32)region.size() - offset < length ? (UINT32)region.size() - offset : length;
+}
+
+// Returns the first extension of given type from CPD extensions area, NULL if there is none
+static const CPD_EXTENTION_HEADER* findCpdExtension(const char* area, const UINT32 size, const UINT32 type)
+{
+    UINT32 offset = 0;
+    while (size - offset >= sizeof(CPD_EXTENTION_HEADER)) {
+        const CPD_EXTENTION_HEADER* extHeader = (const CPD_EXTENTION_HEADER*)(area + offset);
+        if (extHeader->Length < sizeof(CPD_EXTENTION_HEADER) || extHeader->Length > size - offset)
+            break;
+        if (extHeader->Type == type)
+            return extHeader;
+        offset += extHeader->Length;
+    }
+    return NULL;
+}
+
+// Metadata hashes listed in Signed Package Info extension of the manifest body, by module name.
+// Hashes are stored reversed, the ones that are not SHA256 are kept empty
+static void cpdMetadataHashes(const char* manifestBody, const UINT32 bodySize, std::map<UString, UByteArray> & hashes)
+{
+    const CPD_EXTENTION_HEADER* extHeader = findCpdExtension(manifestBody, bodySize, CPD_EXT_TYPE_SIGNED_PACKAGE_INFO);
+    if (!extHeader || extHeader->Length < sizeof(CPD_EXT_SIGNED_PACKAGE_INFO))
+        return;
+
+    const UINT8* modules = (const UINT8*)extHeader + sizeof(CPD_EXT_SIGNED_PACKAGE_INFO);
+    UINT32 size = extHeader->Length - sizeof(CPD_EXT_SIGNED_PACKAGE_INFO);
+    UINT32 offset = 0;
+    while (size - offset >= sizeof(CPD_EXT_SIGNED_PACKAGE_INFO_MODULE)) {
+        const CPD_EXT_SIGNED_PACKAGE_INFO_MODULE* moduleHeader = (const CPD_EXT_SIGNED_PACKAGE_INFO_MODULE*)(modules + offset);
+        if (moduleHeader->HashSize > size - offset - CpdExtSignedPkgMetadataHashOffset)
+            break;
+
+        UByteArray hash;
+        if (moduleHeader->HashSize == SHA256_DIGEST_SIZE) {
+            hash = UByteArray((const char*)moduleHeader + CpdExtSignedPkgMetadataHashOffset, SHA256_DIGEST_SIZE);
+            std::reverse(hash.begin(), hash.end());
+        }
+        hashes[usprintf("%.12s", moduleHeader->Name)] = hash;
+        offset += (UINT32)CpdExtSignedPkgMetadataHashOffset + moduleHeader->HashSize;
+    }
+}
+
+// Image hash from Module Attributes extension of metadata, empty if the module is compressed or the hash is not SHA256
+static UByteArray cpdModuleHash(const char* metadata, const UINT32 size)
+{
+    const CPD_EXTENTION_HEADER* extHeader = findCpdExtension(metadata, size, CPD_EXT_TYPE_MODULE_ATTRIBUTES);
+    if (!extHeader || extHeader->Length != CpdExtModuleImageHashOffset + SHA256_DIGEST_SIZE)
+        return UByteArray();
+
+    const CPD_EXT_MODULE_ATTRIBUTES* attrHeader = (const CPD_EXT_MODULE_ATTRIBUTES*)extHeader;
+    if (attrHeader->CompressionType != CPD_EXT_MODULE_COMPRESSION_TYPE_UNCOMPRESSED)
+        return UByteArray();
+
+    UByteArray hash((const char*)attrHeader + CpdExtModuleImageHashOffset, SHA256_DIGEST_SIZE);
+    std::reverse(hash.begin(), hash.end());
+    return hash;
+}
+
+static UINT8 checkCpdHash(const UByteArray & hash, const std::map<UString, UByteArray> & expectedHashes, const UString & name, ME_PARTITION_HASHES & hashes)
+{
+    hashes.Modules++;
+    std::map<UString, UByteArray>::const_iterator expected = expectedHashes.find(name);
+    if (expected == expectedHashes.end() || expected->second.isEmpty()) {
+        hashes.Unchecked++;
+        return CPD_HASH_UNCHECKED;
+    }
+    if (expected->second != hash) {
+        hashes.Invalid++;
+        return CPD_HASH_INVALID;
+    }
+    hashes.Valid++;
+    return CPD_HASH_VALID;
+}
+
+// Constructors
 FfsParser::FfsParser(TreeModel* treeModel) : model(treeModel),
-imageBase(0), addressDiff(0x100000000ULL),
+currentGuidNames(currentGuidDatabase()),
+imageBase(0), addressDiff(0x100000000ULL), deferredCodePartitions(NULL),
+bgAcmFound(false), bgKeyManifestFound(false), bgBootPolicyFound(false), bgProtectedRegionsBase(0) {
+    guidNames = currentGuidNames.get();
+    nvramParser = new NvramParser(treeModel, this);
+    meParser = new MeParser(treeModel, this);
+}
+
+FfsParser::FfsParser(TreeModel* treeModel, const GuidNameDatabase & guidDatabase) : model(treeModel),
+guidNames(&guidDatabase),
+imageBase(0), addressDiff(0x100000000ULL), deferredCodePartitions(NULL),
 bgAcmFound(false), bgKeyManifestFound(false), bgBootPolicyFound(false), bgProtectedRegionsBase(0) {
     nvramParser = new NvramParser(treeModel, this);
     meParser = new MeParser(treeModel, this);
@@ -95,6 +203,8 @@ std::vector<std::pair<UString, UModelIndex> > FfsParser::getMessages() const {
 // Firmware image parsing functions
 USTATUS FfsParser::parse(const UByteArray & buffer)
 {
+    STATS_SCOPE(StatsTimers::Parse);
+    STATS_ADD(StatsCounters::BytesScanned, buffer.size());
     UModelIndex root;
 
     // Reset global parser state
@@ -107,6 +217,8 @@ USTATUS FfsParser::parse(const UByteArray & buffer)
     bgProtectedRegionsBase = 0;
     lastVtf = UModelIndex();
     fitTable.clear();
+    nvramIndex.clear();
+    mePartitionHashes.clear();
     securityInfo = "";
     bgAcmFound = false;
     bgKeyManifestFound = false;
@@ -118,9 +230,14 @@ USTATUS FfsParser::parse(const UByteArray & buffer)
     bgDxeCoreIndex = UModelIndex();
 
     // Parse input buffer
-    USTATUS result = performFirstPass(buffer, root);
+    USTATUS result;
+    {
+        STATS_SCOPE(StatsTimers::FirstPass);
+        result = performFirstPass(buffer, root);
+    }
     if (result == U_SUCCESS) {
         if (lastVtf.isValid()) {
+            STATS_SCOPE(StatsTimers::SecondPass);
             result = performSecondPass(root);
         }
         else {
@@ -128,7 +245,10 @@ USTATUS FfsParser::parse(const UByteArray & buffer)
         }
     }
 
-    addInfoRecursive(root);
+    {
+        STATS_SCOPE(StatsTimers::AddInfo);
+        addInfoRecursive(root);
+    }
     return result;
 }
 
@@ -173,6 +293,7 @@ USTATUS FfsParser::parseGenericImage(const UByteArray & buffer, const UINT32 loc
 
 USTATUS FfsParser::parseCapsule(const UByteArray & capsule, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index)
 {
+    TRACE_SCOPE("parseCapsule", itemPath(parent), capsule.size());
     // Check buffer size to be more than or equal to size of EFI_CAPSULE_HEADER
     if ((UINT32)capsule.size() < sizeof(EFI_CAPSULE_HEADER)) {
         return U_ITEM_NOT_FOUND;
@@ -316,6 +437,7 @@ USTATUS FfsParser::parseCapsule(const UByteArray & capsule, const UINT32 localOf
 
 USTATUS FfsParser::parseIntelImage(const UByteArray & intelImage, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index)
 {
+    TRACE_SCOPE("parseIntelImage", itemPath(parent), intelImage.size());
     // Check for buffer size to be greater or equal to descriptor region size
     if (intelImage.size() < FLASH_DESCRIPTOR_SIZE) {
         msg(usprintf("%s: input file is smaller than minimum descriptor size of %Xh (%u) bytes", __FUNCTION__, FLASH_DESCRIPTOR_SIZE, FLASH_DESCRIPTOR_SIZE));
@@ -1021,6 +1143,7 @@ USTATUS FfsParser::parseRawArea(const UModelIndex & index)
 
 USTATUS FfsParser::parseVolumeHeader(const UByteArray & volume, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index)
 {
+    TRACE_SCOPE("parseVolumeHeader", itemPath(parent), volume.size());
     // Sanity check
     if (volume.isEmpty())
         return U_INVALID_PARAMETER;
@@ -1146,7 +1269,7 @@ USTATUS FfsParser::parseVolumeHeader(const UByteArray & volume, const UINT32 loc
     // Get info
     UByteArray header = volume.left(headerSize);
     UByteArray body = volume.mid(headerSize);
-    UString name = guidToUString(volumeHeader->FileSystemGuid);
+    UString name = guidToUString(volumeHeader->FileSystemGuid, *guidNames);
     UString info = usprintf("ZeroVector:\n%02X %02X %02X %02X %02X %02X %02X %02X\n"
         "%02X %02X %02X %02X %02X %02X %02X %02X\nSignature: _FVH\nFileSystem GUID: ",
         volumeHeader->ZeroVector[0], volumeHeader->ZeroVector[1], volumeHeader->ZeroVector[2], volumeHeader->ZeroVector[3],
@@ -1169,7 +1292,7 @@ USTATUS FfsParser::parseVolumeHeader(const UByteArray & volume, const UINT32 loc
         const EFI_FIRMWARE_VOLUME_EXT_HEADER* extendedHeader = (const EFI_FIRMWARE_VOLUME_EXT_HEADER*)(volume.constData() + volumeHeader->ExtHeaderOffset);
         info += usprintf("\nExtended header size: %Xh (%u)\nVolume GUID: ",
             extendedHeader->ExtHeaderSize, extendedHeader->ExtHeaderSize) + guidToUString(extendedHeader->FvName, false);
-        name = guidToUString(extendedHeader->FvName); // Replace FFS GUID with volume GUID
+        name = guidToUString(extendedHeader->FvName, *guidNames); // Replace FFS GUID with volume GUID
     }
 
     // Add text
@@ -1207,7 +1330,7 @@ USTATUS FfsParser::parseVolumeHeader(const UByteArray & volume, const UINT32 loc
 
     // Show messages
     if (isUnknown)
-        msg(usprintf("%s: unknown file system ", __FUNCTION__) + guidToUString(volumeHeader->FileSystemGuid), index);
+        msg(usprintf("%s: unknown file system ", __FUNCTION__) + guidToUString(volumeHeader->FileSystemGuid, *guidNames), index);
     if (msgInvalidChecksum)
         msg(usprintf("%s: volume header checksum is invalid", __FUNCTION__), index);
     if (msgAlignmentBitsSet)
@@ -1430,6 +1553,7 @@ USTATUS FfsParser::parseVolumeNonUefiData(const UByteArray & data, const UINT32
 
 USTATUS FfsParser::parseVolumeBody(const UModelIndex & index)
 {
+    TRACE_SCOPE("parseVolumeBody", itemPath(index), model->body(index).size());
     // Sanity check
     if (!index.isValid()) {
         return U_INVALID_PARAMETER;
@@ -1593,7 +1717,7 @@ USTATUS FfsParser::parseVolumeBody(const UModelIndex & index)
 
             // Check GUIDs for being equal
             if (currentGuid == anotherGuid) {
-                msg(usprintf("%s: file with duplicate GUID ", __FUNCTION__) + guidToUString(readUnaligned((EFI_GUID*)(anotherGuid.data()))), another);
+                msg(usprintf("%s: file with duplicate GUID ", __FUNCTION__) + guidToUString(readUnaligned((EFI_GUID*)(anotherGuid.data())), *guidNames), another);
             }
         }
     }
@@ -1755,7 +1879,7 @@ USTATUS FfsParser::parseFileHeader(const UByteArray & file, const UINT32 localOf
     UString name;
     UString info;
     if (fileHeader->Type != EFI_FV_FILETYPE_PAD) {
-        name = guidToUString(fileHeader->Name);
+        name = guidToUString(fileHeader->Name, *guidNames);
     } else {
         name = UString("Pad-file");
     }
@@ -1970,6 +2094,7 @@ USTATUS FfsParser::parsePadFileBody(const UModelIndex & index)
 
 USTATUS FfsParser::parseSections(const UByteArray & sections, const UModelIndex & index, const bool insertIntoTree)
 {
+    TRACE_SCOPE("parseSections", itemPath(index), sections.size());
     // Sanity check
     if (!index.isValid())
         return U_INVALID_PARAMETER;
@@ -2361,7 +2486,7 @@ USTATUS FfsParser::parseGuidedSectionHeader(const UByteArray & section, const UI
                 additionalInfo += UString("\nCertificate subtype: RSA2048/SHA256");
             }
             else {
-                additionalInfo += UString("\nCertificate subtype: unknown, GUID ") + guidToUString(winCertificateUefiGuid->CertType);
+                additionalInfo += UString("\nCertificate subtype: unknown, GUID ") + guidToUString(winCertificateUefiGuid->CertType, *guidNames);
                 msgUnknownCertSubtype = true;
             }
         }
@@ -2380,7 +2505,7 @@ USTATUS FfsParser::parseGuidedSectionHeader(const UByteArray & section, const UI
     UByteArray body = section.mid(dataOffset);
 
     // Get info
-    UString name = guidToUString(guid);
+    UString name = guidToUString(guid, *guidNames);
     UString info = UString("Section GUID: ") + guidToUString(guid, false) +
         usprintf("\nType: %02Xh\nFull size: %" PRIXQ "h (%" PRIuQ ")\nHeader size: %" PRIXQ "h (%" PRIuQ ")\nBody size: %" PRIXQ "h (%" PRIuQ ")\nData offset: %Xh\nAttributes: %04Xh",
         sectionHeader->Type,
@@ -2494,7 +2619,7 @@ USTATUS FfsParser::parseFreeformGuidedSectionHeader(const UByteArray & section,
         model->setParsingData(index, UByteArray((const char*)&pdata, sizeof(pdata)));
 
         // Rename section
-        model->setName(index, guidToUString(guid));
+        model->setName(index, guidToUString(guid, *guidNames));
     }
 
     return U_SUCCESS;
@@ -2867,11 +2992,8 @@ USTATUS FfsParser::parseVersionSectionBody(const UModelIndex & index)
         return U_INVALID_PARAMETER;
 
     // Add info
-#if QT_VERSION_MAJOR >= 6
-    model->addInfo(index, UString("\nVersion string: ") + UString::fromUtf16((const char16_t*)model->body(index).constData()));
-#else
-    model->addInfo(index, UString("\nVersion string: ") + UString::fromUtf16((const CHAR16*)model->body(index).constData()));
-#endif
+    const UByteArray & body = model->constBody(index);
+    model->addInfo(index, UString("\nVersion string: ") + uFromUtf16(body.constData(), (UINT32)body.size()));
 
     return U_SUCCESS;
 }
@@ -2902,7 +3024,7 @@ USTATUS FfsParser::parseDepexSectionBody(const UModelIndex & index)
             return U_SUCCESS;
         }
         guid = (const EFI_GUID*)(current + EFI_DEP_OPCODE_SIZE);
-        parsed += UString("\nBEFORE ") + guidToUString(readUnaligned(guid));
+        parsed += UString("\nBEFORE ") + guidToUString(readUnaligned(guid), *guidNames);
         current += EFI_DEP_OPCODE_SIZE + sizeof(EFI_GUID);
         if (*current != EFI_DEP_END){
             msg(usprintf("%s: DEPEX section ends with non-END opcode", __FUNCTION__), index);
@@ -2915,7 +3037,7 @@ USTATUS FfsParser::parseDepexSectionBody(const UModelIndex & index)
             return U_SUCCESS;
         }
         guid = (const EFI_GUID*)(current + EFI_DEP_OPCODE_SIZE);
-        parsed += UString("\nAFTER ") + guidToUString(readUnaligned(guid));
+        parsed += UString("\nAFTER ") + guidToUString(readUnaligned(guid), *guidNames);
         current += EFI_DEP_OPCODE_SIZE + sizeof(EFI_GUID);
         if (*current != EFI_DEP_END) {
             msg(usprintf("%s: DEPEX section ends with non-END opcode", __FUNCTION__), index);
@@ -2955,7 +3077,7 @@ USTATUS FfsParser::parseDepexSectionBody(const UModelIndex & index)
                 return U_SUCCESS;
             }
             guid = (const EFI_GUID*)(current + EFI_DEP_OPCODE_SIZE);
-            parsed += UString("\nPUSH ") + guidToUString(readUnaligned(guid));
+            parsed += UString("\nPUSH ") + guidToUString(readUnaligned(guid), *guidNames);
             current += EFI_DEP_OPCODE_SIZE + sizeof(EFI_GUID);
             break;
         case EFI_DEP_AND:
@@ -3006,11 +3128,8 @@ USTATUS FfsParser::parseUiSectionBody(const UModelIndex & index)
     if (!index.isValid())
         return U_INVALID_PARAMETER;
 
-#if QT_VERSION_MAJOR >= 6
-    UString text = UString::fromUtf16((const char16_t*)model->body(index).constData());
-#else
-    UString text = UString::fromUtf16((const CHAR16*)model->body(index).constData());
-#endif
+    const UByteArray & body = model->constBody(index);
+    UString text = uFromUtf16(body.constData(), (UINT32)body.size());
 
     // Add info
     model->addInfo(index, UString("\nText: ") + text);
@@ -3032,7 +3151,7 @@ USTATUS FfsParser::parseAprioriRawSection(const UByteArray & body, UString & par
     if (count > 0) {
         for (UINT32 i = 0; i < count; i++) {
             const EFI_GUID* guid = (const EFI_GUID*)body.constData() + i;
-            parsed += UString("\n") + guidToUString(readUnaligned(guid));
+            parsed += UString("\n") + guidToUString(readUnaligned(guid), *guidNames);
         }
     }
 
@@ -3243,13 +3362,22 @@ USTATUS FfsParser::performSecondPass(const UModelIndex & index)
     parseResetVectorData();
 
     // Find and parse FIT
-    parseFit(index);
+    {
+        STATS_SCOPE(StatsTimers::Fit);
+        parseFit(index);
+    }
 
     // Check protected ranges
-    checkProtectedRanges(index);
+    {
+        STATS_SCOPE(StatsTimers::ProtectedRanges);
+        checkProtectedRanges(index);
+    }
 
     // Check TE files to have original or adjusted base
-    checkTeImageBase(index);
+    {
+        STATS_SCOPE(StatsTimers::TeImageBase);
+        checkTeImageBase(index);
+    }
 
     return U_SUCCESS;
 }
@@ -4333,43 +4461,56 @@ USTATUS FfsParser::parseFitEntryBootGuardBootPolicy(const UByteArray & bootPolic
 }
 #endif
 
+// Returns true if the area is all 00h or all FFh, stops at the first byte that differs.
+// Every byte is equal to the next one only if all of them are the same.
+static bool isEmptyArea(const char* data, const UINT32 size)
+{
+    if (size == 0)
+        return true;
+    if (data[0] != '\x00' && data[0] != '\xFF')
+        return false;
+    return memcmp(data, data + 1, size - 1) == 0;
+}
+
 USTATUS FfsParser::parseMicrocodeVolumeBody(const UModelIndex & index)
 {
     const UINT32 headerSize = (UINT32)model->header(index).size();
-    const UINT32 bodySize = (UINT32)model->body(index).size();
+    const UByteArray & body = model->constBody(index);
+    const UINT32 bodySize = (UINT32)body.size();
     UINT32 offset = 0;
-    USTATUS result = U_SUCCESS;
 
-    while(true) {
+    // One forward pass, only the current update is copied out of the volume body
+    while (offset < bodySize) {
+        const char* current = body.constData() + offset;
+        const UINT32 restSize = bodySize - offset;
+
         // Parse current microcode
         UModelIndex currentMicrocode;
-        UByteArray ucode = model->body(index).mid(offset);
-
-        // Check for empty area
-        if (ucode.size() == ucode.count('\xFF') || ucode.size() == ucode.count('\x00')) {
-            result = U_INVALID_MICROCODE;
-        }
-        else {
-            result = parseIntelMicrocodeHeader(ucode, headerSize + offset, index, currentMicrocode);
+        USTATUS result = U_INVALID_MICROCODE;
+        if (!isEmptyArea(current, restSize)) {
+            UINT32 ucodeSize = restSize;
+            const INTEL_MICROCODE_HEADER* ucodeHeader = (const INTEL_MICROCODE_HEADER*)current;
+            if (restSize >= sizeof(INTEL_MICROCODE_HEADER) && microcodeHeaderValid(ucodeHeader) && ucodeHeader->TotalSize <= restSize)
+                ucodeSize = ucodeHeader->TotalSize;
+            result = parseIntelMicrocodeHeader(UByteArray(current, ucodeSize), headerSize + offset, index, currentMicrocode);
         }
 
         // Add the rest as padding
         if (result) {
-            if (offset < bodySize) {
-                // Get info
-                UString name = UString("Padding");
-                UString info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")", ucode.size(), ucode.size());
+            UByteArray padding(current, restSize);
 
-                // Add tree item
-                model->addItem(headerSize + offset, Types::Padding, getPaddingType(ucode), name, UString(), info, UByteArray(), ucode, UByteArray(), Fixed, index);
-            }
+            // Get info
+            UString name = UString("Padding");
+            UString info = usprintf("Full size: %Xh (%u)", restSize, restSize);
+
+            // Add tree item
+            UINT8 paddingType = getPaddingType(padding);
+            model->addItem(headerSize + offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(padding), UByteArray(), Fixed, index);
             return U_SUCCESS;
         }
 
         // Get to next candidate
-        offset += model->header(currentMicrocode).size() + model->body(currentMicrocode).size() + model->tail(currentMicrocode).size();
-        if (offset >= bodySize)
-            break;
+        offset += (UINT32)model->constBody(currentMicrocode).size();
     }
     return U_SUCCESS;
 }
@@ -4404,15 +4545,13 @@ USTATUS FfsParser::parseIntelMicrocodeHeader(const UByteArray & microcode, const
     }
 
     // Recalculate the whole microcode checksum
-    UByteArray tempMicrocode = microcode;
+    UByteArray tempMicrocode = microcode.left(ucodeHeader->TotalSize);
     INTEL_MICROCODE_HEADER* tempUcodeHeader = (INTEL_MICROCODE_HEADER*)(tempMicrocode.data());
     tempUcodeHeader->Checksum = 0;
     UINT32 calculated = calculateChecksum32((const UINT32*)tempMicrocode.constData(), tempUcodeHeader->TotalSize);
     bool msgInvalidChecksum = (ucodeHeader->Checksum != calculated);
 
-    // Construct header, body and tail
-    UByteArray header = microcode.left(sizeof(INTEL_MICROCODE_HEADER));
-    UByteArray body = microcode.mid(sizeof(INTEL_MICROCODE_HEADER), dataSize);
+    // Construct tail, header and body stay in the microcode binary
     UByteArray tail;
 
     // Check if the tail is present
@@ -4494,7 +4633,7 @@ USTATUS FfsParser::parseIntelMicrocodeHeader(const UByteArray & microcode, const
                  + extendedHeaderInfo;
 
     // Add tree item
-    index = model->addItem(localOffset, Types::Microcode, Subtypes::IntelMicrocode, name, UString(), info, UByteArray(), microcodeBinary, UByteArray(), Fixed, parent);
+    index = model->addItem(localOffset, Types::Microcode, Subtypes::IntelMicrocode, name, UString(), info, UByteArray(), std::move(microcodeBinary), UByteArray(), Fixed, parent);
     if (msgInvalidChecksum)
         msg(usprintf("%s: invalid microcode checksum %08Xh, should be %08Xh", __FUNCTION__, ucodeHeader->Checksum, calculated), index);
     if (msgUnknownOrDamagedMicrocodeTail)
@@ -4663,12 +4802,14 @@ make_partition_table_consistent:
     }
 
     // Partition map is consistent
+    std::vector<UModelIndex> partitionIndices(partitions.size());
+    std::vector<CPD_REGION_PARSING> cpdRegions;
+    std::vector<size_t> cpdPositions(partitions.size(), (size_t)-1);
     for (size_t i = 0; i < partitions.size(); i++) {
         if (partitions[i].type == Types::BpdtPartition) {
             // Get info
             UString name = bpdtEntryTypeToUString(partitions[i].ptEntry.Type);
             UByteArray partition = region.mid(partitions[i].ptEntry.Offset, partitions[i].ptEntry.Size);
-            UByteArray signature = partition.left(sizeof(UINT32));
 
             UString info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")\nType: %Xh",
                                     partition.size(), partition.size(),
@@ -4680,27 +4821,17 @@ make_partition_table_consistent:
 
             UString text = bpdtEntryTypeToUString(partitions[i].ptEntry.Type);
 
-            // Add tree item
-            UModelIndex partitionIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset, Types::BpdtPartition, 0, name, text, info, UByteArray(), partition, UByteArray(), Fixed, parent);
-
-            // Special case of S-BPDT
-            if (partitions[i].ptEntry.Type == BPDT_ENTRY_TYPE_SBPDT) {
-                UModelIndex sbpdtIndex;
-                parseBpdtRegion(partition, 0, partitions[i].ptEntry.Offset, partitionIndex, sbpdtIndex); // Third parameter is a fixup for S-BPDT offset entries, because they are calculated from the start of BIOS region
-            }
-
-            // Parse code partitions
-            if (readUnaligned((const UINT32*)partition.constData()) == CPD_SIGNATURE) {
-                // Parse code partition contents
-                UModelIndex cpdIndex;
-                parseCpdRegion(partition, 0, partitionIndex, cpdIndex);
-            }
-
-            // TODO: make this generic again
-            if (partitions[i].ptEntry.Type > BPDT_ENTRY_TYPE_TBT
-                && partitions[i].ptEntry.Type != BPDT_ENTRY_TYPE_SAMF
-                && partitions[i].ptEntry.Type != BPDT_ENTRY_TYPE_PPHY) {
-                msg(usprintf("%s: BPDT entry of unknown type found", __FUNCTION__), partitionIndex);
+            // Add tree item, its body is parsed in place below
+            partitionIndices[i] = model->addItem(localOffset + partitions[i].ptEntry.Offset, Types::BpdtPartition, 0, name, text, info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
+            const UByteArray & partitionBody = model->constBody(partitionIndices[i]);
+
+            // Code partitions are parsed in parallel below
+            if ((UINT32)partitionBody.size() >= sizeof(UINT32) && readUnaligned((const UINT32*)partitionBody.constData()) == CPD_SIGNATURE) {
+                cpdPositions[i] = cpdRegions.size();
+                CPD_REGION_PARSING cpdRegion = {};
+                cpdRegion.LocalOffset = 0;
+                cpdRegion.Parent = partitionIndices[i];
+                cpdRegions.push_back(cpdRegion);
             }
         }
         else if (partitions[i].type == Types::Padding) {
@@ -4712,7 +4843,8 @@ make_partition_table_consistent:
                             padding.size(), padding.size());
 
             // Add tree item
-            model->addItem(localOffset + partitions[i].ptEntry.Offset, Types::Padding, getPaddingType(padding), name, UString(), info, UByteArray(), padding, UByteArray(), Fixed, parent);
+            UINT8 paddingType = getPaddingType(padding);
+            model->addItem(localOffset + partitions[i].ptEntry.Offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(padding), UByteArray(), Fixed, parent);
         }
     }
 
@@ -4727,7 +4859,33 @@ make_partition_table_consistent:
                         padding.size(), padding.size());
 
         // Add tree item
-        model->addItem(localOffset + partitions.back().ptEntry.Offset + partitions.back().ptEntry.Size, Types::Padding, getPaddingType(padding), name, UString(), info, UByteArray(), padding, UByteArray(), Fixed, parent);
+        UINT8 paddingType = getPaddingType(padding);
+        model->addItem(localOffset + partitions.back().ptEntry.Offset + partitions.back().ptEntry.Size, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(padding), UByteArray(), Fixed, parent);
+    }
+
+    // Parse partition contents, results are merged in partition order
+    parseCpdRegions(cpdRegions);
+    for (size_t i = 0; i < partitions.size(); i++) {
+        if (partitions[i].type != Types::BpdtPartition)
+            continue;
+
+        // Special case of S-BPDT
+        if (partitions[i].ptEntry.Type == BPDT_ENTRY_TYPE_SBPDT) {
+            UModelIndex sbpdtIndex;
+            parseBpdtRegion(model->constBody(partitionIndices[i]), 0, partitions[i].ptEntry.Offset, partitionIndices[i], sbpdtIndex); // Third parameter is a fixup for S-BPDT offset entries, because they are calculated from the start of BIOS region
+        }
+
+        // Code partitions
+        if (cpdPositions[i] != (size_t)-1) {
+            mergeCpdRegion(cpdRegions[cpdPositions[i]]);
+        }
+
+        // TODO: make this generic again
+        if (partitions[i].ptEntry.Type > BPDT_ENTRY_TYPE_TBT
+            && partitions[i].ptEntry.Type != BPDT_ENTRY_TYPE_SAMF
+            && partitions[i].ptEntry.Type != BPDT_ENTRY_TYPE_PPHY) {
+            msg(usprintf("%s: BPDT entry of unknown type found", __FUNCTION__), partitionIndices[i]);
+        }
     }
 
     return U_SUCCESS;
@@ -4848,19 +5006,12 @@ USTATUS FfsParser::parseCpdRegion(const UByteArray & region, const UINT32 localO
         }
 
         // Parse into data block, find Module Attributes extension, and get compressed size from there
-        UINT32 offset = 0;
         UINT32 length = 0xFFFFFFFF; // Special guardian value
-        UByteArray partition = region.mid(partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length);
-        while (offset < (UINT32)partition.size()) {
-            const CPD_EXTENTION_HEADER* extHeader = (const CPD_EXTENTION_HEADER*) (partition.constData() + offset);
-            if (extHeader->Length <= ((UINT32)partition.size() - offset)) {
-                if (extHeader->Type == CPD_EXT_TYPE_MODULE_ATTRIBUTES) {
-                    const CPD_EXT_MODULE_ATTRIBUTES* attrHeader = (const CPD_EXT_MODULE_ATTRIBUTES*)(partition.constData() + offset);
-                    length = attrHeader->CompressedSize;
-                }
-                offset += extHeader->Length;
-            }
-            else break;
+        const CPD_EXTENTION_HEADER* extHeader = findCpdExtension(region.constData() + partitions[i].ptEntry.Offset.Offset,
+            cpdPartitionSize(region, partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length), CPD_EXT_TYPE_MODULE_ATTRIBUTES);
+        if (extHeader && extHeader->Length >= sizeof(CPD_EXT_MODULE_ATTRIBUTES)) {
+            const CPD_EXT_MODULE_ATTRIBUTES* attrHeader = (const CPD_EXT_MODULE_ATTRIBUTES*)extHeader;
+            length = attrHeader->CompressedSize;
         }
 
         // Search down for corresponding code partition
@@ -4985,11 +5136,42 @@ make_partition_table_consistent:
         partitions.push_back(padding);
     }
 
+    // Collect hashes of metadata listed in the manifest and hashes of modules listed in their metadata
+    std::map<UString, UByteArray> metadataHashes;
+    std::map<UString, UByteArray> moduleHashes;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        if (partitions[i].type != Types::CpdPartition || partitions[i].ptEntry.Offset.HuffmanCompressed)
+            continue;
+
+        const char* partition = region.constData() + partitions[i].ptEntry.Offset.Offset;
+        UINT32 partitionSize = cpdPartitionSize(region, partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length);
+        name = usprintf("%.12s", partitions[i].ptEntry.EntryName);
+        if (name.endsWith(".man") && partitionSize >= sizeof(CPD_MANIFEST_HEADER)) {
+            const CPD_MANIFEST_HEADER* manifestHeader = (const CPD_MANIFEST_HEADER*)partition;
+            UINT32 headerSize = manifestHeader->HeaderLength * sizeof(UINT32);
+            if (manifestHeader->HeaderId == ME_MANIFEST_HEADER_ID && headerSize <= partitionSize)
+                cpdMetadataHashes(partition + headerSize, partitionSize - headerSize, metadataHashes);
+        }
+        else if (name.endsWith(".met")) {
+            name.chop(4);
+            moduleHashes[name] = cpdModuleHash(partition, partitionSize);
+        }
+    }
+
+    ME_PARTITION_HASHES hashes;
+    hashes.Name = model->name(parent);
+    hashes.Index = index;
+    hashes.Modules = 0;
+    hashes.Valid = 0;
+    hashes.Invalid = 0;
+    hashes.Unchecked = 0;
+
     // Partition map is consistent
     for (size_t i = 0; i < partitions.size(); i++) {
+        // Partitions are read in place, every item body is the only copy of its data
+        const char* partition = region.constData() + partitions[i].ptEntry.Offset.Offset;
+        UINT32 partitionSize = cpdPartitionSize(region, partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length);
         if (partitions[i].type == Types::CpdPartition) {
-            UByteArray partition = region.mid(partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length);
-
             // Get info
             name = usprintf("%.12s", partitions[i].ptEntry.EntryName);
 
@@ -4997,15 +5179,16 @@ make_partition_table_consistent:
             if (name.endsWith(".man")) {
                 if (!partitions[i].ptEntry.Offset.HuffmanCompressed
                     && partitions[i].ptEntry.Length >= sizeof(CPD_MANIFEST_HEADER)) {
-                    const CPD_MANIFEST_HEADER* manifestHeader = (const CPD_MANIFEST_HEADER*) partition.constData();
-                    if (manifestHeader->HeaderId == ME_MANIFEST_HEADER_ID) {
-                        UByteArray header = partition.left(manifestHeader->HeaderLength * sizeof(UINT32));
-                        UByteArray body = partition.mid(manifestHeader->HeaderLength * sizeof(UINT32));
+                    const CPD_MANIFEST_HEADER* manifestHeader = (const CPD_MANIFEST_HEADER*) partition;
+                    UINT32 headerSize = manifestHeader->HeaderLength * sizeof(UINT32);
+                    if (manifestHeader->HeaderId == ME_MANIFEST_HEADER_ID && headerSize <= partitionSize) {
+                        UByteArray header(partition, headerSize);
+                        UByteArray body(partition + headerSize, partitionSize - headerSize);
 
                         info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")\nHeader size: %" PRIXQ "h (%" PRIuQ ")\nBody size: %" PRIXQ "h (%" PRIuQ ")"
                                         "\nHeader type: %u\nHeader length: %lXh (%lu)\nHeader version: %Xh\nFlags: %08Xh\nVendor: %Xh\n"
                                         "Date: %Xh\nSize: %lXh (%lu)\nVersion: %u.%u.%u.%u\nSecurity version number: %u\nModulus size: %lXh (%lu)\nExponent size: %lXh (%lu)",
-                                        partition.size(), partition.size(),
+                                        partitionSize, partitionSize,
                                         header.size(), header.size(),
                                         body.size(), body.size(),
                                         manifestHeader->HeaderType,
@@ -5021,7 +5204,7 @@ make_partition_table_consistent:
                                         manifestHeader->ExponentSize * sizeof(UINT32), manifestHeader->ExponentSize * sizeof(UINT32));
 
                         // Add tree item
-                        UModelIndex partitionIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition, Subtypes::ManifestCpdPartition, name, UString(), info, header, body, UByteArray(), Fixed, parent);
+                        UModelIndex partitionIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition, Subtypes::ManifestCpdPartition, name, UString(), info, header, std::move(body), UByteArray(), Fixed, parent);
 
                         // Parse data as extensions area
                         parseCpdExtensionsArea(partitionIndex);
@@ -5030,45 +5213,65 @@ make_partition_table_consistent:
             }
             // It's a metadata
             else if (name.endsWith(".met")) {
-                info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")\nHuffman compressed: ",
-                                partition.size(), partition.size())
+                info = usprintf("Full size: %Xh (%u)\nHuffman compressed: ",
+                                partitionSize, partitionSize)
                 + (partitions[i].ptEntry.Offset.HuffmanCompressed ? "Yes" : "No");
 
-                // Calculate SHA256 hash over the metadata and add it to its info
+                // Calculate SHA256 hash over the metadata, check it against the manifest and add it to its info
                 UByteArray hash(SHA256_DIGEST_SIZE, '\x00');
-                sha256(partition.constData(), partition.size(), hash.data());
-                info += UString("\nMetadata hash: ") + UString(hash.toHex().constData());
+                sha256(partition, partitionSize, hash.data());
+                UString moduleName = name;
+                moduleName.chop(4);
+                UINT8 check = checkCpdHash(hash, metadataHashes, moduleName, hashes);
+                info += UString("\nMetadata hash: ") + UString(hash.toHex().constData())
+                + UString("\nHash check: ") + cpdHashCheckToString(check);
 
                 // Add three item
-                UModelIndex partitionIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition,  Subtypes::MetadataCpdPartition, name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+                UModelIndex partitionIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition,  Subtypes::MetadataCpdPartition, name, UString(), info, UByteArray(), UByteArray(partition, partitionSize), UByteArray(), Fixed, parent);
+                if (check == CPD_HASH_INVALID) {
+                    msg(usprintf("%s: metadata hash doesn't match the one stored in the manifest", __FUNCTION__), partitionIndex);
+                }
 
                 // Parse data as extensions area
                 parseCpdExtensionsArea(partitionIndex);
             }
             // It's a code
             else {
-                info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")\nHuffman compressed: ",
-                                partition.size(), partition.size())
+                info = usprintf("Full size: %Xh (%u)\nHuffman compressed: ",
+                                partitionSize, partitionSize)
                 + (partitions[i].ptEntry.Offset.HuffmanCompressed ? "Yes" : "No");
 
-                // Calculate SHA256 hash over the code and add it to its info
+                // Calculate SHA256 hash over the code, check it against the metadata and add it to its info
                 UByteArray hash(SHA256_DIGEST_SIZE, '\x00');
-                sha256(partition.constData(), partition.size(), hash.data());
-                info += UString("\nHash: ") + UString(hash.toHex().constData());
+                sha256(partition, partitionSize, hash.data());
+                UINT8 check = checkCpdHash(hash, moduleHashes, name, hashes);
+                info += UString("\nHash: ") + UString(hash.toHex().constData())
+                + UString("\nHash check: ") + cpdHashCheckToString(check);
+
+                UModelIndex codeIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition, Subtypes::CodeCpdPartition, name, UString(), info, UByteArray(), UByteArray(partition, partitionSize), UByteArray(), Fixed, parent);
+                if (check == CPD_HASH_INVALID) {
+                    msg(usprintf("%s: module hash doesn't match the one stored in its metadata", __FUNCTION__), codeIndex);
+                }
 
-                UModelIndex codeIndex = model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::CpdPartition, Subtypes::CodeCpdPartition, name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
-                parseRawArea(codeIndex);
+                // Parsing of code as raw area can touch parser state, worker parsers leave it to the merge
+                if (deferredCodePartitions) {
+                    deferredCodePartitions->push_back(std::make_pair(codeIndex, messagesVector.size()));
+                }
+                else {
+                    parseRawArea(codeIndex);
+                }
             }
         }
         else if (partitions[i].type == Types::Padding) {
-            UByteArray partition = region.mid(partitions[i].ptEntry.Offset.Offset, partitions[i].ptEntry.Length);
+            UByteArray padding(partition, partitionSize);
 
             // Get info
             name = UString("Padding");
-            info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")", partition.size(), partition.size());
+            info = usprintf("Full size: %Xh (%u)", partitionSize, partitionSize);
 
             // Add tree item
-            model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::Padding, getPaddingType(partition), name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            UINT8 paddingType = getPaddingType(padding);
+            model->addItem(localOffset + partitions[i].ptEntry.Offset.Offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(padding), UByteArray(), Fixed, parent);
         }
         else {
             msg(usprintf("%s: CPD partition of unknown type found", __FUNCTION__), parent);
@@ -5076,9 +5279,51 @@ make_partition_table_consistent:
         }
     }
 
+    mePartitionHashes.push_back(hashes);
     return U_SUCCESS;
 }
 
+void FfsParser::parseCpdRegions(std::vector<CPD_REGION_PARSING> & regions)
+{
+    // Worker parsers are not worth it for a single directory or a single thread.
+    // In compressed data they would race on the fixed flag of the compression boundary item
+    ThreadPool & pool = sharedThreadPool();
+    if (regions.size() < 2 || pool.size() < 2 || model->compressed(regions.front().Parent)) {
+        for (size_t i = 0; i < regions.size(); i++)
+            regions[i].Parsed = false;
+        return;
+    }
+
+    // Every directory fills only the subtree of its own partition, so worker parsers need no locking
+    pool.parallelFor(regions.size(), [this, &regions](size_t i) {
+        CPD_REGION_PARSING & region = regions[i];
+        FfsParser worker(model, *guidNames);
+        worker.deferredCodePartitions = &region.CodePartitions;
+        region.Parsed = true;
+        region.Result = worker.parseCpdRegion(model->constBody(region.Parent), region.LocalOffset, region.Parent, region.Index);
+        region.Messages.swap(worker.messagesVector);
+        region.Hashes.swap(worker.mePartitionHashes);
+    });
+}
+
+USTATUS FfsParser::mergeCpdRegion(CPD_REGION_PARSING & region)
+{
+    if (!region.Parsed)
+        return parseCpdRegion(model->constBody(region.Parent), region.LocalOffset, region.Parent, region.Index);
+
+    // Code partitions are parsed as raw areas at the points serial parsing would do it
+    size_t merged = 0;
+    for (size_t i = 0; i < region.CodePartitions.size(); i++) {
+        size_t end = region.CodePartitions[i].second;
+        messagesVector.insert(messagesVector.end(), region.Messages.begin() + merged, region.Messages.begin() + end);
+        merged = end;
+        parseRawArea(region.CodePartitions[i].first);
+    }
+    messagesVector.insert(messagesVector.end(), region.Messages.begin() + merged, region.Messages.end());
+    mePartitionHashes.insert(mePartitionHashes.end(), region.Hashes.begin(), region.Hashes.end());
+    return region.Result;
+}
+
 USTATUS FfsParser::parseCpdExtensionsArea(const UModelIndex & index)
 {
     if (!index.isValid()) {
@@ -5241,7 +5486,7 @@ USTATUS FfsParser::parseSignedPackageInfoData(const UModelIndex & index)
                                     moduleHeader->HashSize, moduleHeader->HashSize,
                                     moduleHeader->MetadataSize, moduleHeader->MetadataSize) + UString(hash.toHex().constData());
             // Add tree otem
-            UModelIndex extIndex = model->addItem(offset, Types::CpdSpiEntry, 0, name, UString(), info, UByteArray(), module, UByteArray(), Fixed, index);
+            model->addItem(offset, Types::CpdSpiEntry, 0, name, UString(), info, UByteArray(), module, UByteArray(), Fixed, index);
             offset += module.size();
         }
         else break;
@@ -14,6 +14,8 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define FFSPARSER_H
 
 //#define U_ENABLE_FIT_PARSING_SUPPORT
+#define U_ENABLE_NVRAM_PARSING_SUPPORT
+#define U_ENABLE_ME_PARSING_SUPPORT
 
 #include <vector>
 
@@ -21,8 +23,11 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "ustring.h"
 #include "ubytearray.h"
 #include "treemodel.h"
+#include "guiddatabase.h"
+#include "nvramindex.h"
 #include "bootguard.h"
 #include "fit.h"
+#include "parserstats.h"
 
 typedef struct BG_PROTECTED_RANGE_ {
     UINT32     Offset;
@@ -38,16 +43,44 @@ typedef struct BG_PROTECTED_RANGE_ {
 #define BG_PROTECTED_RANGE_VENDOR_HASH_AMI_NEW       0x05
 #define BG_PROTECTED_RANGE_VENDOR_HASH_MICROSOFT     0x06
 
+// Hash checks of modules of one CPD directory, found in an FPT or BPDT partition
+typedef struct ME_PARTITION_HASHES_ {
+    UString     Name;       // Partition that holds the directory
+    UModelIndex Index;      // CPD partition table
+    UINT32      Modules;    // Metadata and code partitions
+    UINT32      Valid;
+    UINT32      Invalid;
+    UINT32      Unchecked;  // Compressed, not SHA256 or not listed in manifest or metadata
+} ME_PARTITION_HASHES;
+
+// CPD directory of one partition, parsed by a worker parser and then merged in partition order.
+// Directory is the body of Parent item, it's parsed in place
+typedef struct CPD_REGION_PARSING_ {
+    UINT32      LocalOffset;
+    UModelIndex Parent;
+    UModelIndex Index;
+    bool        Parsed;     // False if parsing is left to the merge, as there is nothing to run in parallel
+    USTATUS     Result;
+    std::vector<std::pair<UString, UModelIndex> > Messages;
+    std::vector<std::pair<UModelIndex, size_t> > CodePartitions; // Parsed as raw areas during merge, after given number of messages
+    std::vector<ME_PARTITION_HASHES> Hashes;
+} CPD_REGION_PARSING;
+
 class NvramParser;
 class MeParser;
 
 class FfsParser
 {
 public:
-    // Constructor and destructor
+    // Constructor and destructor, GUID names are taken from currentGuidDatabase()
+    // or from database that must outlive the parser
     FfsParser(TreeModel* treeModel);
+    FfsParser(TreeModel* treeModel, const GuidNameDatabase & guidDatabase);
     ~FfsParser();
 
+    // GUID names used for tree items
+    const GuidNameDatabase & getGuidDatabase() const { return *guidNames; }
+
     // Obtain parser messages
     std::vector<std::pair<UString, UModelIndex> > getMessages() const;
     // Clear messages
@@ -59,6 +92,12 @@ public:
     // Obtain parsed FIT table
     std::vector<std::pair<std::vector<UString>, UModelIndex> > getFitTable() const { return fitTable; }
 
+    // Obtain NVRAM variables found during parsing, data views point into the tree model
+    const NvramIndex & getNvramIndex() const { return nvramIndex; }
+
+    // Obtain hash checks of ME partitions, in partition order
+    const std::vector<ME_PARTITION_HASHES> & getMePartitionHashes() const { return mePartitionHashes; }
+
     // Obtain Security Info
     UString getSecurityInfo() const { return securityInfo; }
 
@@ -72,17 +111,25 @@ private:
     TreeModel *model;
     std::vector<std::pair<UString, UModelIndex> > messagesVector;
     void msg(const UString & message, const UModelIndex & index = UModelIndex()) {
+        STATS_ADD(StatsCounters::MessagesEmitted, 1);
         messagesVector.push_back(std::pair<UString, UModelIndex>(message, index));
     };
 
     NvramParser* nvramParser;
     MeParser* meParser;
+
+    // Keeps current database alive when no database is given
+    std::shared_ptr<const GuidNameDatabase> currentGuidNames;
+    const GuidNameDatabase* guidNames;
  
     UByteArray openedImage;
     UModelIndex lastVtf;
     UINT32 imageBase;
     UINT64 addressDiff;
     std::vector<std::pair<std::vector<UString>, UModelIndex> > fitTable;
+    NvramIndex nvramIndex;
+    std::vector<ME_PARTITION_HASHES> mePartitionHashes;
+    std::vector<std::pair<UModelIndex, size_t> >* deferredCodePartitions;
     
     UString securityInfo;
     bool bgAcmFound;
@@ -104,6 +151,8 @@ private:
 
     USTATUS parseBpdtRegion(const UByteArray & region, const UINT32 localOffset, const UINT32 sbpdtOffsetFixup, const UModelIndex & parent, UModelIndex & index);
     USTATUS parseCpdRegion(const UByteArray & region, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index);
+    void parseCpdRegions(std::vector<CPD_REGION_PARSING> & regions);
+    USTATUS mergeCpdRegion(CPD_REGION_PARSING & region);
     USTATUS parseCpdExtensionsArea(const UModelIndex & index);
     USTATUS parseSignedPackageInfoData(const UModelIndex & index);
     
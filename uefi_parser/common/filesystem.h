@@ -17,12 +17,17 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "basetypes.h"
 #include "ustring.h"
 #include "ubytearray.h"
+#include "parserstats.h"
 #include <sys/stat.h>
+#include <stdio.h>
 #include <fstream>
+#include <vector>
 
 #ifdef WIN32
 #include <direct.h>
+#include <io.h>
 #include <stdlib.h>
+#include <windows.h>
 static inline bool isExistOnFs(const UString & path) {
     struct _stat buf;
     return (_stat(path.toLocal8Bit(), &buf) == 0);
@@ -50,9 +55,31 @@ static inline UString getAbsPath(const UString & path) {
         return UString(abs);
     return path;
 }
+
+static inline bool getFileSize(const UString & path, UINT64 & size) {
+    struct _stat64 buf;
+    if (_stat64(path.toLocal8Bit(), &buf) != 0)
+        return false;
+    size = (UINT64)buf.st_size;
+    return true;
+}
+
+static inline bool listDirectory(const UString & dir, std::vector<UString> & names) {
+    struct _finddata_t data;
+    intptr_t handle = _findfirst((dir + UString("/*")).toLocal8Bit(), &data);
+    if (handle == -1)
+        return false;
+    do {
+        if (!(data.attrib & _A_SUBDIR))
+            names.push_back(UString(data.name));
+    } while (_findnext(handle, &data) == 0);
+    _findclose(handle);
+    return true;
+}
 #else
 #include <unistd.h>
 #include <stdlib.h>
+#include <dirent.h>
 static inline bool isExistOnFs(const UString & path) {
     struct stat buf;
     return (stat(path.toLocal8Bit(), &buf) == 0);
@@ -77,9 +104,45 @@ static inline UString getAbsPath(const UString & path) {
         return UString(abs);
     return path;
 }
+
+static inline bool getFileSize(const UString & path, UINT64 & size) {
+    struct stat buf;
+    if (stat(path.toLocal8Bit(), &buf) != 0)
+        return false;
+    size = (UINT64)buf.st_size;
+    return true;
+}
+
+static inline bool listDirectory(const UString & dir, std::vector<UString> & names) {
+    DIR* handle = opendir(dir.toLocal8Bit());
+    if (!handle)
+        return false;
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        struct stat buf;
+        if (stat((dir + UString("/") + UString(entry->d_name)).toLocal8Bit(), &buf) == 0 && S_ISREG(buf.st_mode))
+            names.push_back(UString(entry->d_name));
+    }
+    closedir(handle);
+    return true;
+}
+#endif
+
+static inline bool removeFile(const UString & path) {
+    return (remove(path.toLocal8Bit()) == 0);
+}
+
+// Atomically puts file at path to newPath, replacing file already there
+static inline bool replaceFile(const UString & path, const UString & newPath) {
+#ifdef WIN32
+    return MoveFileExA(path.toLocal8Bit(), newPath.toLocal8Bit(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return (rename(path.toLocal8Bit(), newPath.toLocal8Bit()) == 0);
 #endif
+}
 
 static inline USTATUS readFileIntoBuffer(const UString & inPath, UByteArray &buf) {
+    STATS_SCOPE(StatsTimers::FileRead);
     if (!isExistOnFs(inPath))
         return U_FILE_OPEN;
 
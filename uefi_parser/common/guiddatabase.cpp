@@ -13,16 +13,24 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "guiddatabase.h"
 #include "ubytearray.h"
 #include "ffs.h"
+#include "types.h"
+#include "utility.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <string>
 
+struct GUID_DATABASE_ENTRY {
+    EFI_GUID guid;
+    const char* name;
+};
+
 #if defined(U_ENABLE_GUID_DATABASE_SUPPORT)
 #include <sstream>
-#include <vector>
-#include <cstdio>
 
-static GuidDatabase gLocalGuidDatabase;
+// Sorted table generated from guids.csv at build time by guiddatabase_embed.cmake
+#include "guiddatabase_embedded.h"
 
 #ifdef QT_CORE_LIB
 
@@ -43,91 +51,182 @@ static std::string readGuidDatabase(const UString &path) {
 static std::string readGuidDatabase(const UString &path) {
     std::ifstream guids(path.toLocal8Bit());
     std::stringstream ret;
-    if (ret)
+    if (guids)
         ret << guids.rdbuf();
     return ret.str();
 }
 
 #endif
 
-void initGuidDatabase(const UString & path, UINT32* numEntries)
+#else
+#define GUID_DATABASE_EMBEDDED_ENTRIES 0
+static const GUID_DATABASE_ENTRY gEmbeddedGuidDatabase[1] = { { { 0xFFFFFFFF, 0xFFFF, 0xFFFF, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } }, NULL } };
+#endif
+
+// Order of GUID text, so the embedded table keeps the order of sorted guids.csv
+static bool guidDatabaseLess(const EFI_GUID & lhs, const EFI_GUID & rhs)
+{
+    if (lhs.Data1 != rhs.Data1)
+        return lhs.Data1 < rhs.Data1;
+    if (lhs.Data2 != rhs.Data2)
+        return lhs.Data2 < rhs.Data2;
+    if (lhs.Data3 != rhs.Data3)
+        return lhs.Data3 < rhs.Data3;
+    return memcmp(lhs.Data4, rhs.Data4, sizeof(lhs.Data4)) < 0;
+}
+
+static bool embeddedEntryLess(const GUID_DATABASE_ENTRY & entry, const EFI_GUID & guid)
 {
-    gLocalGuidDatabase.clear();
+    return guidDatabaseLess(entry.guid, guid);
+}
 
-    std::stringstream file(readGuidDatabase(path));
+bool GuidNameDatabase::overlayEntryLess(const OVERLAY_ENTRY & lhs, const OVERLAY_ENTRY & rhs)
+{
+    return guidDatabaseLess(lhs.guid, rhs.guid);
+}
 
-    while (!file.eof()) {
-        std::string line;
-        std::getline(file, line);
+bool GuidNameDatabase::overlayEntryLessThanGuid(const OVERLAY_ENTRY & entry, const EFI_GUID & guid)
+{
+    return guidDatabaseLess(entry.guid, guid);
+}
+
+GuidNameDatabase::GuidNameDatabase()
+{
+}
+
+GuidNameDatabase::GuidNameDatabase(const UString & path)
+{
+#if defined(U_ENABLE_GUID_DATABASE_SUPPORT)
+    std::string file;
+    if (!path.isEmpty())
+        file = readGuidDatabase(path);
+
+    std::string::size_type lineStart = 0;
+    while (lineStart < file.size()) {
+        std::string::size_type lineEnd = file.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = file.size();
+        std::string line = file.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
 
         // Use sharp symbol as commentary
         if (line.size() == 0 || line[0] == '#')
             continue;
 
         // GUID and name are comma-separated
-        std::vector<UString> lineParts;
-        std::string::size_type prev = 0, curr = 0;
-        while ((curr = line.find(',', curr)) != std::string::npos) {
-            std::string substring( line.substr(prev, curr-prev) );
-            lineParts.push_back(UString(substring.c_str()));
-            prev = ++curr;
-        }
-        lineParts.push_back(UString(line.substr(prev, curr-prev).c_str()));
-
-        if (lineParts.size() < 2)
+        std::string::size_type comma = line.find(',');
+        if (comma == std::string::npos)
             continue;
+        std::string::size_type nameEnd = line.find(',', comma + 1);
+        if (nameEnd == std::string::npos)
+            nameEnd = line.size();
 
-        EFI_GUID guid;
-        if (!ustringToGuid(lineParts[0], guid))
+        OVERLAY_ENTRY entry;
+        if (!ustringToGuid(UString(line.substr(0, comma).c_str()), entry.guid))
             continue;
+        entry.name = line.substr(comma + 1, nameEnd - comma - 1);
+        overlay.push_back(entry);
+    }
 
-        gLocalGuidDatabase[guid] = lineParts[1];
+    // Stable sort keeps file order of duplicates, the last one wins
+    std::stable_sort(overlay.begin(), overlay.end(), overlayEntryLess);
+    size_t kept = 0;
+    for (size_t i = 0; i < overlay.size(); i++) {
+        if (kept > 0 && !guidDatabaseLess(overlay[kept - 1].guid, overlay[i].guid))
+            kept--;
+        if (kept != i)
+            overlay[kept] = overlay[i];
+        kept++;
     }
+    overlay.resize(kept);
+    overlay.shrink_to_fit();
+#else
+    U_UNUSED_PARAMETER(path);
+#endif
+}
 
-    if (numEntries)
-        *numEntries = (UINT32)gLocalGuidDatabase.size();
+const char* GuidNameDatabase::lookup(const EFI_GUID & guid) const
+{
+    std::vector<OVERLAY_ENTRY>::const_iterator loaded = std::lower_bound(overlay.begin(), overlay.end(), guid, overlayEntryLessThanGuid);
+    if (loaded != overlay.end() && !guidDatabaseLess(guid, loaded->guid))
+        return loaded->name.c_str();
+
+    const GUID_DATABASE_ENTRY* end = gEmbeddedGuidDatabase + GUID_DATABASE_EMBEDDED_ENTRIES;
+    const GUID_DATABASE_ENTRY* embedded = std::lower_bound(gEmbeddedGuidDatabase, end, guid, embeddedEntryLess);
+    if (embedded != end && !guidDatabaseLess(guid, embedded->guid))
+        return embedded->name;
+    return NULL;
 }
 
-UString guidDatabaseLookup(const EFI_GUID & guid)
+UINT32 GuidNameDatabase::size() const
 {
-    return gLocalGuidDatabase[guid];
+    return (UINT32)(GUID_DATABASE_EMBEDDED_ENTRIES + overlay.size());
+}
+
+const GuidNameDatabase & GuidNameDatabase::builtIn()
+{
+    static const GuidNameDatabase database;
+    return database;
+}
+
+// Constructed on first use, so parsers created during static initialization get it too
+static std::shared_ptr<const GuidNameDatabase> & currentGuidDatabaseStorage()
+{
+    static std::shared_ptr<const GuidNameDatabase> database(new GuidNameDatabase());
+    return database;
+}
+
+std::shared_ptr<const GuidNameDatabase> currentGuidDatabase()
+{
+    return std::atomic_load(&currentGuidDatabaseStorage());
 }
 
-#else
 void initGuidDatabase(const UString & path, UINT32* numEntries)
 {
-    U_UNUSED_PARAMETER(path);
+    std::shared_ptr<const GuidNameDatabase> database(new GuidNameDatabase(path));
+    std::atomic_store(&currentGuidDatabaseStorage(), database);
     if (numEntries)
-        *numEntries = 0;
+        *numEntries = database->size();
 }
 
 UString guidDatabaseLookup(const EFI_GUID & guid)
 {
-    U_UNUSED_PARAMETER(guid);
-    return UString();
+    const char* name = currentGuidDatabase()->lookup(guid);
+    return name ? UString(name) : UString();
 }
-#endif
 
-GuidDatabase guidDatabaseFromTreeRecursive(TreeModel * model, const UModelIndex index)
+void guidDatabaseFromTree(const TreeModel * model, const UModelIndex & index, GuidDatabase & db)
 {
-    GuidDatabase db;
-
-    if (!index.isValid())
-        return db;
-
-    for (int i = 0; i < model->rowCount(index); i++) {
-#if ((QT_VERSION_MAJOR == 5) && (QT_VERSION_MINOR < 6)) || (QT_VERSION_MAJOR < 5)
-        GuidDatabase tmpDb = guidDatabaseFromTreeRecursive(model, index.child(i, index.column()));
-#else
-        GuidDatabase tmpDb = guidDatabaseFromTreeRecursive(model, index.model()->index(i, index.column(), index));
-#endif
+    if (!model || !index.isValid())
+        return;
+
+    // Preorder walk with explicit stack, first name found for a GUID is kept,
+    // so files win over files nested in them and earlier files over later ones
+    std::vector<UModelIndex> stack(1, index);
+    while (!stack.empty()) {
+        UModelIndex current = stack.back();
+        stack.pop_back();
+
+        if (model->type(current) == Types::File) {
+            UString text = model->text(current);
+            if (!text.isEmpty()) {
+                UByteArray header = model->header(current);
+                if ((size_t)header.size() >= sizeof(EFI_GUID))
+                    db.insert(std::make_pair(readUnaligned((const EFI_GUID*)header.constData()), text));
+            }
+        }
 
-        db.insert(tmpDb.begin(), tmpDb.end());
+        for (int i = model->rowCount(current) - 1; i >= 0; i--)
+            stack.push_back(model->index(i, 0, current));
     }
+}
 
-    if (model->type(index) == Types::File && !model->text(index).isEmpty())
-        db[readUnaligned((const EFI_GUID*)model->header(index).left(16).constData())] = model->text(index);
-
+GuidDatabase guidDatabaseFromTreeRecursive(TreeModel * model, const UModelIndex index)
+{
+    GuidDatabase db;
+    guidDatabaseFromTree(model, index, db);
     return db;
 }
 
@@ -14,13 +14,13 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define GUID_DATABASE_H
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "basetypes.h"
 #include "ustring.h"
-#include "ffsparser.h"
-#include "ffs.h"
-#include "utility.h"
+#include "treemodel.h"
 
 #define U_ENABLE_GUID_DATABASE_SUPPORT
 
@@ -34,8 +34,47 @@ struct OperatorLessForGuids : public std::binary_function<EFI_GUID, EFI_GUID, bo
 
 typedef std::map<EFI_GUID, UString, OperatorLessForGuids> GuidDatabase;
 
-UString guidDatabaseLookup(const EFI_GUID & guid);
+// Immutable set of GUID names, safe to share between threads parsing different images.
+// Names of guids.csv are compiled in as a sorted table, "GUID,Name" lines of a file
+// given to the constructor are put over them. Lookup is a binary search in both.
+class GuidNameDatabase
+{
+public:
+    // Built-in names only
+    GuidNameDatabase();
+    // Built-in names and names from file, missing file gives built-in names only
+    explicit GuidNameDatabase(const UString & path);
+
+    // Name of GUID or NULL, valid while the database exists
+    const char* lookup(const EFI_GUID & guid) const;
+    // Number of built-in and loaded entries
+    UINT32 size() const;
+
+    // Shared database with built-in names only
+    static const GuidNameDatabase & builtIn();
+
+private:
+    GuidNameDatabase(const GuidNameDatabase &);
+    GuidNameDatabase & operator=(const GuidNameDatabase &);
+
+    struct OVERLAY_ENTRY {
+        EFI_GUID guid;
+        std::string name;
+    };
+    std::vector<OVERLAY_ENTRY> overlay;
+
+    static bool overlayEntryLess(const OVERLAY_ENTRY & lhs, const OVERLAY_ENTRY & rhs);
+    static bool overlayEntryLessThanGuid(const OVERLAY_ENTRY & entry, const EFI_GUID & guid);
+};
+
+// Process-wide database used by parsers constructed without one.
+// initGuidDatabase replaces it with a new one loaded from path, parsers
+// already holding the previous database keep using it.
+std::shared_ptr<const GuidNameDatabase> currentGuidDatabase();
 void initGuidDatabase(const UString & path = "", UINT32* numEntries = NULL);
+UString guidDatabaseLookup(const EFI_GUID & guid);
+// Adds GUIDs and UI names of all files under index to db, names already in db are kept
+void guidDatabaseFromTree(const TreeModel * model, const UModelIndex & index, GuidDatabase & db);
 GuidDatabase guidDatabaseFromTreeRecursive(TreeModel * model, const UModelIndex index);
 USTATUS guidDatabaseExportToFile(const UString & outPath, GuidDatabase & db);
 
@@ -0,0 +1,86 @@
+# guiddatabase_embed.cmake
+#
+# Converts guids.csv into a sorted table of GUID_DATABASE_ENTRY initializers
+# compiled into guiddatabase.cpp, so no database file is parsed at startup.
+#
+# Usage: cmake -DINPUT=guids.csv -DOUTPUT=guiddatabase_embedded.h -P guiddatabase_embed.cmake
+#
+# Entries are sorted by GUID text, which is the order of guidDatabaseCompare,
+# the last entry wins for GUIDs listed more than once.
+
+if(NOT INPUT OR NOT OUTPUT)
+    message(FATAL_ERROR "INPUT and OUTPUT must be set")
+endif()
+
+set(HEX "[0-9A-Fa-f]")
+set(GUID_REGEX "^(${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}-${HEX}${HEX}${HEX}${HEX}-${HEX}${HEX}${HEX}${HEX}-${HEX}${HEX}${HEX}${HEX}-${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}${HEX}),([^,]*)")
+
+file(STRINGS "${INPUT}" LINES ENCODING UTF-8)
+
+# Sort keys are uppercase GUIDs followed by the line number, so the last duplicate sorts last
+set(KEYS "")
+set(LINE_NUMBER 0)
+foreach(LINE IN LISTS LINES)
+    math(EXPR LINE_NUMBER "${LINE_NUMBER} + 1")
+    if(NOT LINE MATCHES "${GUID_REGEX}")
+        continue()
+    endif()
+    string(TOUPPER "${CMAKE_MATCH_1}" GUID)
+    string(STRIP "${CMAKE_MATCH_2}" NAME)
+    if(NAME STREQUAL "")
+        continue()
+    endif()
+    string(REPLACE "\\" "\\\\" NAME "${NAME}")
+    string(REPLACE "\"" "\\\"" NAME "${NAME}")
+    string(LENGTH "0000000${LINE_NUMBER}" LENGTH)
+    math(EXPR LENGTH "${LENGTH} - 8")
+    string(SUBSTRING "0000000${LINE_NUMBER}" ${LENGTH} 8 ORDER)
+    list(APPEND KEYS "${GUID}|${ORDER}|${NAME}")
+endforeach()
+list(SORT KEYS)
+
+set(ENTRIES "")
+set(PREVIOUS_GUID "")
+set(PREVIOUS_ENTRY "")
+set(COUNT 0)
+foreach(KEY IN LISTS KEYS)
+    string(SUBSTRING "${KEY}" 0 36 GUID)
+    string(SUBSTRING "${KEY}" 46 -1 NAME)
+    string(SUBSTRING "${GUID}" 0 8 DATA1)
+    string(SUBSTRING "${GUID}" 9 4 DATA2)
+    string(SUBSTRING "${GUID}" 14 4 DATA3)
+    set(DATA4 "")
+    foreach(POSITION 19 21 24 26 28 30 32 34)
+        string(SUBSTRING "${GUID}" ${POSITION} 2 BYTE)
+        list(APPEND DATA4 "0x${BYTE}")
+    endforeach()
+    string(REPLACE ";" ", " DATA4 "${DATA4}")
+    set(ENTRY "    { { 0x${DATA1}, 0x${DATA2}, 0x${DATA3}, { ${DATA4} } }, \"${NAME}\" },\n")
+    if(NOT PREVIOUS_GUID STREQUAL "" AND NOT PREVIOUS_GUID STREQUAL GUID)
+        string(APPEND ENTRIES "${PREVIOUS_ENTRY}")
+        math(EXPR COUNT "${COUNT} + 1")
+    endif()
+    set(PREVIOUS_GUID "${GUID}")
+    set(PREVIOUS_ENTRY "${ENTRY}")
+endforeach()
+if(NOT PREVIOUS_GUID STREQUAL "")
+    string(APPEND ENTRIES "${PREVIOUS_ENTRY}")
+    math(EXPR COUNT "${COUNT} + 1")
+endif()
+
+get_filename_component(INPUT_NAME "${INPUT}" NAME)
+set(CONTENT "// Generated from ${INPUT_NAME} by guiddatabase_embed.cmake, do not edit\n\n")
+string(APPEND CONTENT "#define GUID_DATABASE_EMBEDDED_ENTRIES ${COUNT}\n\n")
+string(APPEND CONTENT "static const GUID_DATABASE_ENTRY gEmbeddedGuidDatabase[GUID_DATABASE_EMBEDDED_ENTRIES + 1] = {\n")
+string(APPEND CONTENT "${ENTRIES}")
+# Terminator keeps the array valid when the file has no entries
+string(APPEND CONTENT "    { { 0xFFFFFFFF, 0xFFFF, 0xFFFF, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } }, NULL }\n};\n")
+
+# Unchanged output is not rewritten, so dependent sources are not rebuilt
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" OLD_CONTENT)
+    if(OLD_CONTENT STREQUAL CONTENT)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${CONTENT}")
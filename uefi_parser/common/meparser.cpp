@@ -43,8 +43,8 @@ USTATUS MeParser::parseMeRegionBody(const UModelIndex & index)
     if (!index.isValid())
         return U_INVALID_PARAMETER;
 
-    // Obtain ME region
-    UByteArray meRegion = model->body(index);
+    // Obtain ME region, partitions are parsed in place
+    const UByteArray & meRegion = model->constBody(index);
 
     // Check region size
     if ((UINT32)meRegion.size() < ME_ROM_BYPASS_VECTOR_SIZE + sizeof(UINT32)) {
@@ -186,6 +186,11 @@ USTATUS MeParser::parseFptRegion(const UByteArray & region, const UModelIndex &
     }
 
 make_partition_table_consistent:
+    // All partitions can be absent or skipped
+    if (partitions.empty()) {
+        return U_SUCCESS;
+    }
+
     // Sort partitions by offset
     std::sort(partitions.begin(), partitions.end());
     
@@ -259,6 +264,7 @@ make_partition_table_consistent:
     }
     
     // Partition map is consistent
+    std::vector<CPD_REGION_PARSING> cpdRegions;
     for (size_t i = 0; i < partitions.size(); i++) {
         UByteArray partition = region.mid(partitions[i].ptEntry.Offset, partitions[i].ptEntry.Size);
         if (partitions[i].type == Types::FptPartition) {
@@ -271,11 +277,14 @@ make_partition_table_consistent:
 
             // Add tree item
             UINT8 type = Subtypes::CodeFptPartition + partitions[i].ptEntry.Type;
-            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, Types::FptPartition, type, name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
-            if (type == Subtypes::CodeFptPartition && partition.size() >= (int) sizeof(UINT32) && readUnaligned((const UINT32*)partition.constData()) == CPD_SIGNATURE) {
-                // Parse code partition contents
-                UModelIndex cpdIndex;
-                ffsParser->parseCpdRegion(partition, partitions[i].ptEntry.Offset, partitionIndex, cpdIndex);
+            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, Types::FptPartition, type, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
+            const UByteArray & partitionBody = model->constBody(partitionIndex);
+            if (type == Subtypes::CodeFptPartition && partitionBody.size() >= (int) sizeof(UINT32) && readUnaligned((const UINT32*)partitionBody.constData()) == CPD_SIGNATURE) {
+                // Code partition contents are parsed in parallel below, in place in the body of partition item
+                CPD_REGION_PARSING cpdRegion = {};
+                cpdRegion.LocalOffset = partitions[i].ptEntry.Offset;
+                cpdRegion.Parent = partitionIndex;
+                cpdRegions.push_back(cpdRegion);
             }
         }
         else if (partitions[i].type == Types::Padding) {
@@ -284,9 +293,16 @@ make_partition_table_consistent:
             info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")", partition.size(), partition.size());
             
             // Add tree item
-            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, getPaddingType(partition), name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            UINT8 paddingType = getPaddingType(partition);
+            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
         }
     }
+
+    // Messages of every partition are merged in partition order, so they don't depend on scheduling
+    ffsParser->parseCpdRegions(cpdRegions);
+    for (size_t i = 0; i < cpdRegions.size(); i++) {
+        ffsParser->mergeCpdRegion(cpdRegions[i]);
+    }
     
     return U_SUCCESS;
 }
@@ -346,6 +362,11 @@ USTATUS MeParser::parseIfwi16Region(const UByteArray & region, const UModelIndex
     }
 
 make_partition_table_consistent:
+    // All partitions can be skipped
+    if (partitions.empty()) {
+        return U_SUCCESS;
+    }
+
     // Sort partitions by offset
     std::sort(partitions.begin(), partitions.end());
     
@@ -432,17 +453,17 @@ make_partition_table_consistent:
                             partition.size(), partition.size());
             
             // Add tree item
-            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, partitions[i].type, partitions[i].subtype, name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, partitions[i].type, partitions[i].subtype, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
             
-            // Parse partition further
+            // Parse partition further, in place in the body of partition item
             if (partitions[i].subtype == Subtypes::DataIfwiPartition) {
                 UModelIndex dataPartitionFptRegionIndex;
-                parseFptRegion(partition, partitionIndex, dataPartitionFptRegionIndex);
+                parseFptRegion(model->constBody(partitionIndex), partitionIndex, dataPartitionFptRegionIndex);
             }
             else if (partitions[i].subtype == Subtypes::BootIfwiPartition) {
                 // Parse code partition contents
                 UModelIndex bootPartitionBpdtRegionIndex;
-                ffsParser->parseBpdtRegion(partition, 0, 0, partitionIndex, bootPartitionBpdtRegionIndex);
+                ffsParser->parseBpdtRegion(model->constBody(partitionIndex), 0, 0, partitionIndex, bootPartitionBpdtRegionIndex);
             }
         }
         else if (partitions[i].type == Types::Padding) {
@@ -451,7 +472,8 @@ make_partition_table_consistent:
             info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")", partition.size(), partition.size());
             
             // Add tree item
-            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, getPaddingType(partition), name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            UINT8 paddingType = getPaddingType(partition);
+            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
         }
     }
 
@@ -528,6 +550,11 @@ USTATUS MeParser::parseIfwi17Region(const UByteArray & region, const UModelIndex
     }
     
 make_partition_table_consistent:
+    // All partitions can be skipped
+    if (partitions.empty()) {
+        return U_SUCCESS;
+    }
+
     // Sort partitions by offset
     std::sort(partitions.begin(), partitions.end());
     
@@ -618,17 +645,17 @@ make_partition_table_consistent:
                             partition.size(), partition.size());
             
             // Add tree item
-            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, partitions[i].type, partitions[i].subtype, name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            partitionIndex = model->addItem(partitions[i].ptEntry.Offset, partitions[i].type, partitions[i].subtype, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
             
-            // Parse partition further
+            // Parse partition further, in place in the body of partition item
             if (partitions[i].subtype == Subtypes::DataIfwiPartition) {
                 UModelIndex dataPartitionFptRegionIndex;
-                parseFptRegion(partition, partitionIndex, dataPartitionFptRegionIndex);
+                parseFptRegion(model->constBody(partitionIndex), partitionIndex, dataPartitionFptRegionIndex);
             }
             else if (partitions[i].subtype == Subtypes::BootIfwiPartition) {
                 // Parse code partition contents
                 UModelIndex bootPartitionBpdtRegionIndex;
-                ffsParser->parseBpdtRegion(partition, 0, 0, partitionIndex, bootPartitionBpdtRegionIndex);
+                ffsParser->parseBpdtRegion(model->constBody(partitionIndex), 0, 0, partitionIndex, bootPartitionBpdtRegionIndex);
             }
         }
         else if (partitions[i].type == Types::Padding) {
@@ -637,7 +664,8 @@ make_partition_table_consistent:
             info = usprintf("Full size: %" PRIXQ "h (%" PRIuQ ")", partition.size(), partition.size());
             
             // Add tree item
-            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, getPaddingType(partition), name, UString(), info, UByteArray(), partition, UByteArray(), Fixed, parent);
+            UINT8 paddingType = getPaddingType(partition);
+            model->addItem(partitions[i].ptEntry.Offset, Types::Padding, paddingType, name, UString(), info, UByteArray(), std::move(partition), UByteArray(), Fixed, parent);
         }
     }
     
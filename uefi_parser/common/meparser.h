@@ -45,6 +45,7 @@ private:
     std::vector<std::pair<UString, UModelIndex> > messagesVector;
 
     void msg(const UString message, const UModelIndex index = UModelIndex()) {
+        STATS_ADD(StatsCounters::MessagesEmitted, 1);
         messagesVector.push_back(std::pair<UString, UModelIndex>(message, index));
     }
 
@@ -0,0 +1,106 @@
+/* nvramdiff.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <cstring>
+
+#include "nvramdiff.h"
+#include "parserstats.h"
+#include "utility.h"
+
+static UINT32 invalidInstances(const NvramIndex* index, const std::vector<size_t> & positions)
+{
+    UINT32 invalid = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        if (!index->getVariables()[positions[i]].isValid)
+            invalid++;
+    }
+    return invalid;
+}
+
+// Attributes of different store types have different meaning, only data is compared then
+static bool isSameValue(const NVRAM_VARIABLE* oldVariable, const UINT64 oldHash, const NVRAM_VARIABLE* newVariable, const UINT64 newHash)
+{
+    if (oldVariable->type == newVariable->type && oldVariable->attributes != newVariable->attributes)
+        return false;
+    return oldHash == newHash
+        && oldVariable->dataSize == newVariable->dataSize
+        && memcmp(oldVariable->data, newVariable->data, oldVariable->dataSize) == 0;
+}
+
+USTATUS NvramDiff::compare()
+{
+    STATS_SCOPE(StatsTimers::NvramDiff);
+    entries.clear();
+    memset(&stats, 0, sizeof(stats));
+    if (!oldIndex || !newIndex)
+        return U_INVALID_PARAMETER;
+
+    // First instance of every key stands for the variable
+    const std::vector<NVRAM_VARIABLE> & oldVariables = oldIndex->getVariables();
+    for (size_t i = 0; i < oldVariables.size(); i++) {
+        if (oldIndex->find(oldVariables[i].key).front() != i)
+            continue;
+        stats.oldVariables++;
+        compareVariable(oldVariables[i].key);
+    }
+
+    const std::vector<NVRAM_VARIABLE> & newVariables = newIndex->getVariables();
+    for (size_t i = 0; i < newVariables.size(); i++) {
+        if (newIndex->find(newVariables[i].key).front() != i)
+            continue;
+        stats.newVariables++;
+        if (oldIndex->find(newVariables[i].key).empty())
+            compareVariable(newVariables[i].key);
+    }
+
+    return U_SUCCESS;
+}
+
+void NvramDiff::compareVariable(const NVRAM_VARIABLE_KEY & key)
+{
+    const std::vector<size_t> & oldPositions = oldIndex->find(key);
+    const std::vector<size_t> & newPositions = newIndex->find(key);
+
+    NVRAM_DIFF_ENTRY entry;
+    entry.key = key;
+    entry.oldVariable = oldIndex->current(key);
+    entry.newVariable = newIndex->current(key);
+    entry.oldHash = entry.oldVariable ? dataFingerprint(entry.oldVariable->data, entry.oldVariable->dataSize) : 0;
+    entry.newHash = entry.newVariable ? dataFingerprint(entry.newVariable->data, entry.newVariable->dataSize) : 0;
+    entry.oldInstances = (UINT32)oldPositions.size();
+    entry.newInstances = (UINT32)newPositions.size();
+    entry.oldInvalid = invalidInstances(oldIndex, oldPositions);
+    entry.newInvalid = invalidInstances(newIndex, newPositions);
+
+    if (entry.newVariable && !entry.oldVariable) {
+        entry.change = NvramDiffChanges::Added;
+        stats.added++;
+        entries.push_back(entry);
+    }
+    else if (entry.oldVariable && !entry.newVariable) {
+        entry.change = NvramDiffChanges::Removed;
+        stats.removed++;
+        entries.push_back(entry);
+    }
+    else if (entry.oldVariable && entry.newVariable
+        && !isSameValue(entry.oldVariable, entry.oldHash, entry.newVariable, entry.newHash)) {
+        entry.change = NvramDiffChanges::Changed;
+        stats.changed++;
+        entries.push_back(entry);
+    }
+
+    if (entry.newInstances > 1) {
+        entry.change = NvramDiffChanges::Duplicated;
+        stats.duplicated++;
+        entries.push_back(entry);
+    }
+}
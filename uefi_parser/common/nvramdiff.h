@@ -0,0 +1,79 @@
+/* nvramdiff.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef NVRAMDIFF_H
+#define NVRAMDIFF_H
+
+#include <vector>
+
+#include "basetypes.h"
+#include "nvramindex.h"
+
+namespace NvramDiffChanges {
+    enum NvramDiffChangeTypes {
+        Added = 0,
+        Removed,
+        Changed,
+        Duplicated
+    };
+}
+
+struct NVRAM_DIFF_ENTRY {
+    UINT8  change;
+    NVRAM_VARIABLE_KEY key;
+    const NVRAM_VARIABLE* oldVariable;  // Current instances, NULL if there is none
+    const NVRAM_VARIABLE* newVariable;
+    UINT64 oldHash;                     // Data fingerprints of current instances
+    UINT64 newHash;
+    UINT32 oldInstances;                // All stored instances, deleted and superseded ones included
+    UINT32 newInstances;
+    UINT32 oldInvalid;                  // Deleted and damaged instances
+    UINT32 newInvalid;
+};
+
+struct NVRAM_DIFF_STATS {
+    UINT32 oldVariables;    // Distinct keys
+    UINT32 newVariables;
+    UINT32 added;
+    UINT32 removed;
+    UINT32 changed;
+    UINT32 duplicated;
+};
+
+// Variable level comparison of NVRAM of two parsed images.
+// Variables are matched by vendor GUID and name, current instances of matched ones are compared
+// by attributes and by fingerprints of their data that are confirmed by comparing the data.
+// A variable is added or removed when only one image has a current instance of it,
+// deleted instances left in the other image are counted, but are not compared.
+// A variable stored more than once in the new image is reported as duplicated too.
+// Entries go in order of the first instance in old image, then of added ones in new image.
+class NvramDiff
+{
+public:
+    NvramDiff(const NvramIndex* oldNvramIndex, const NvramIndex* newNvramIndex) : oldIndex(oldNvramIndex), newIndex(newNvramIndex) {}
+    ~NvramDiff() {};
+
+    USTATUS compare();
+
+    const std::vector<NVRAM_DIFF_ENTRY>& getEntries() const { return entries; }
+    const NVRAM_DIFF_STATS& getStats() const { return stats; }
+
+private:
+    const NvramIndex* oldIndex;
+    const NvramIndex* newIndex;
+    std::vector<NVRAM_DIFF_ENTRY> entries;
+    NVRAM_DIFF_STATS stats;
+
+    void compareVariable(const NVRAM_VARIABLE_KEY & key);
+};
+
+#endif // NVRAMDIFF_H
@@ -0,0 +1,147 @@
+/* nvramindex.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <cstring>
+
+#include "nvramindex.h"
+#include "types.h"
+#include "utf16.h"
+
+size_t NvramVariableKeyHash::operator()(const NVRAM_VARIABLE_KEY & key) const
+{
+    UINT64 words[2];
+    memcpy(words, &key.guid, sizeof(words));
+    UINT64 hash = (words[0] ^ (words[1] * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+    return (size_t)(hash ^ (hash >> 32)) ^ std::hash<std::u16string>()(key.name);
+}
+
+void NvramIndex::clear()
+{
+    variables.clear();
+    instances.clear();
+    names.clear();
+    detachedData.reset();
+}
+
+void NvramIndex::add(const NVRAM_VARIABLE & variable)
+{
+    instances[variable.key].push_back(variables.size());
+    names[variable.key.name].push_back(variables.size());
+    variables.push_back(variable);
+}
+
+const std::vector<size_t> & NvramIndex::find(const NVRAM_VARIABLE_KEY & key) const
+{
+    static const std::vector<size_t> none;
+    std::unordered_map<NVRAM_VARIABLE_KEY, std::vector<size_t>, NvramVariableKeyHash>::const_iterator found = instances.find(key);
+    return found == instances.end() ? none : found->second;
+}
+
+const std::vector<size_t> & NvramIndex::findByName(const std::u16string & name) const
+{
+    static const std::vector<size_t> none;
+    std::unordered_map<std::u16string, std::vector<size_t> >::const_iterator found = names.find(name);
+    return found == names.end() ? none : found->second;
+}
+
+const NVRAM_VARIABLE* NvramIndex::current(const NVRAM_VARIABLE_KEY & key) const
+{
+    const std::vector<size_t> & positions = find(key);
+    for (size_t i = positions.size(); i > 0; i--) {
+        const NVRAM_VARIABLE & variable = variables[positions[i - 1]];
+        // Data of a link entry is replaced by the next entry of its chain
+        if (variable.isValid && !(variable.type == Types::NvarEntry && variable.subtype == Subtypes::LinkNvarEntry))
+            return &variable;
+    }
+    return NULL;
+}
+
+void NvramIndex::detach()
+{
+    if (detachedData)
+        return;
+
+    size_t total = 0;
+    for (size_t i = 0; i < variables.size(); i++)
+        total += variables[i].dataSize;
+
+    // One buffer for all data, filled before views are moved to it
+    std::shared_ptr<std::string> buffer(new std::string());
+    buffer->reserve(total);
+    for (size_t i = 0; i < variables.size(); i++)
+        buffer->append((const char*)variables[i].data, variables[i].dataSize);
+
+    const UINT8* data = (const UINT8*)buffer->data();
+    for (size_t i = 0; i < variables.size(); i++) {
+        variables[i].data = data;
+        variables[i].index = UModelIndex();
+        data += variables[i].dataSize;
+    }
+    detachedData = buffer;
+}
+
+std::u16string nvramNameFromUcs2(const void* data, const UINT32 size)
+{
+    std::u16string name(utf16Length(data, size / 2), u'\0');
+    if (!name.empty())
+        memcpy(&name[0], data, name.size() * sizeof(char16_t));
+    return name;
+}
+
+std::u16string nvramNameFromAscii(const void* data, const UINT32 size)
+{
+    const UINT8* bytes = (const UINT8*)data;
+    std::u16string name;
+    for (UINT32 i = 0; i < size && bytes[i]; i++)
+        name.push_back((char16_t)bytes[i]);
+    return name;
+}
+
+std::u16string nvramNameFromUtf8(const std::string & name)
+{
+    std::u16string result;
+    size_t i = 0;
+    while (i < name.size()) {
+        UINT8 lead = (UINT8)name[i];
+        UINT32 codePoint;
+        size_t length;
+        if (lead < 0x80)      { codePoint = lead; length = 1; }
+        else if (lead < 0xC0) { codePoint = 0xFFFD; length = 1; }
+        else if (lead < 0xE0) { codePoint = lead & 0x1F; length = 2; }
+        else if (lead < 0xF0) { codePoint = lead & 0x0F; length = 3; }
+        else                  { codePoint = lead & 0x07; length = 4; }
+
+        size_t j = 1;
+        for (; j < length && i + j < name.size() && ((UINT8)name[i + j] & 0xC0) == 0x80; j++)
+            codePoint = (codePoint << 6) | ((UINT8)name[i + j] & 0x3F);
+        if (j < length) // Truncated sequence
+            codePoint = 0xFFFD;
+        i += j;
+
+        if (codePoint >= 0x10000 && codePoint <= 0x10FFFF) {
+            codePoint -= 0x10000;
+            result.push_back((char16_t)(0xD800 + (codePoint >> 10)));
+            result.push_back((char16_t)(0xDC00 + (codePoint & 0x3FF)));
+        }
+        else {
+            result.push_back((char16_t)(codePoint > 0x10FFFF ? 0xFFFD : codePoint));
+        }
+    }
+    return result;
+}
+
+std::string nvramNameToUtf8(const std::u16string & name)
+{
+    std::string result;
+    utf16ToUtf8(name.data(), (UINT32)name.size(), result);
+    return result;
+}
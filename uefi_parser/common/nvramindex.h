@@ -0,0 +1,89 @@
+/* nvramindex.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef NVRAMINDEX_H
+#define NVRAMINDEX_H
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "basetypes.h"
+#include "treemodel.h"
+
+// Vendor GUID and UTF-16 name of a variable, Fsys variables have zero GUID
+struct NVRAM_VARIABLE_KEY {
+    EFI_GUID       guid;
+    std::u16string name;
+
+    bool operator==(const NVRAM_VARIABLE_KEY & other) const {
+        return name == other.name && memcmp(&guid, &other.guid, sizeof(EFI_GUID)) == 0;
+    }
+};
+
+struct NvramVariableKeyHash {
+    size_t operator()(const NVRAM_VARIABLE_KEY & key) const;
+};
+
+// One instance of a variable as stored, including deleted and superseded ones
+struct NVRAM_VARIABLE {
+    NVRAM_VARIABLE_KEY key;
+    UINT8       type;       // Types::NvarEntry, VssEntry, FsysEntry or EvsaEntry
+    UINT8       subtype;
+    bool        isValid;    // False for deleted and damaged instances
+    UINT32      attributes; // Attributes as stored, their meaning depends on type
+    UINT32      offset;     // Base of the entry item
+    UModelIndex index;      // Entry item, invalid after detach()
+    const UINT8* data;      // Variable data, points into the tree item body or into detached copy
+    UINT32      dataSize;
+};
+
+// All NVRAM variable instances of an image in parse order with hash lookup by vendor GUID and name.
+// Filled by NvramParser, data views stay valid while the tree model lives or until detach().
+class NvramIndex
+{
+public:
+    NvramIndex() {}
+
+    void clear();
+    void add(const NVRAM_VARIABLE & variable);
+
+    size_t size() const { return variables.size(); }
+    const std::vector<NVRAM_VARIABLE> & getVariables() const { return variables; }
+
+    // Positions in getVariables() of all instances in parse order, empty if there are none
+    const std::vector<size_t> & find(const NVRAM_VARIABLE_KEY & key) const;
+    // Same for variables of any vendor
+    const std::vector<size_t> & findByName(const std::u16string & name) const;
+    // Last valid instance that is not a superseded NVAR link, NULL if there is none
+    const NVRAM_VARIABLE* current(const NVRAM_VARIABLE_KEY & key) const;
+
+    // Copy variable data out of the tree model, so the index outlives it
+    void detach();
+
+private:
+    std::vector<NVRAM_VARIABLE> variables;
+    std::unordered_map<NVRAM_VARIABLE_KEY, std::vector<size_t>, NvramVariableKeyHash> instances;
+    std::unordered_map<std::u16string, std::vector<size_t> > names;
+    // Shared by copies of a detached index
+    std::shared_ptr<const std::string> detachedData;
+};
+
+// Name conversions, UCS-2 input is read up to terminator or size bytes and may be unaligned
+std::u16string nvramNameFromUcs2(const void* data, const UINT32 size);
+std::u16string nvramNameFromAscii(const void* data, const UINT32 size);
+std::u16string nvramNameFromUtf8(const std::string & name);
+std::string nvramNameToUtf8(const std::u16string & name);
+
+#endif // NVRAMINDEX_H
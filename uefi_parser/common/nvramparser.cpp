@@ -20,11 +20,65 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "parsingdata.h"
 #include "utility.h"
 #include "nvram.h"
+#include "threadpool.h"
+#include "utf16.h"
 #include "ffs.h"
 #include "fit.h"
 #include "uinttypes.h"
 
 #ifdef U_ENABLE_NVRAM_PARSING_SUPPORT
+void NvramParser::indexVariable(const UModelIndex & varIndex, const NVRAM_VARIABLE_KEY & key, const UINT32 attributes, const bool isValid, const UINT32 dataOffset)
+{
+    const UByteArray & body = model->constBody(varIndex);
+    UINT32 skipped = dataOffset < (UINT32)body.size() ? dataOffset : (UINT32)body.size();
+    NVRAM_VARIABLE variable;
+    variable.key = key;
+    variable.type = model->type(varIndex);
+    variable.subtype = model->subtype(varIndex);
+    variable.isValid = isValid;
+    variable.attributes = attributes;
+    variable.offset = model->base(varIndex);
+    variable.index = varIndex;
+    variable.data = (const UINT8*)body.constData() + skipped;
+    variable.dataSize = (UINT32)body.size() - skipped;
+    if (storeVariables)
+        storeVariables->push_back(variable);
+    else
+        ffsParser->nvramIndex.add(variable);
+}
+
+// Vendor GUID and name of NVAR entry that is not data-only, read the same way for deleted entries.
+// Data follows GUID or GUID index and name, which take keySize bytes after the entry header.
+static bool nvarEntryKey(const UByteArray & store, const UINT32 offset, NVRAM_VARIABLE_KEY & key, UINT32 & keySize)
+{
+    const NVAR_ENTRY_HEADER* entryHeader = (const NVAR_ENTRY_HEADER*)(store.constData() + offset);
+    UINT32 nameOffset = (entryHeader->Attributes & NVRAM_NVAR_ENTRY_GUID) ? sizeof(EFI_GUID) : sizeof(UINT8);
+    if (entryHeader->Size < sizeof(NVAR_ENTRY_HEADER) + nameOffset)
+        return false;
+
+    const UINT8* entryBody = (const UINT8*)(entryHeader + 1);
+    if (entryHeader->Attributes & NVRAM_NVAR_ENTRY_GUID) {
+        key.guid = readUnaligned((const EFI_GUID*)entryBody);
+    }
+    else {
+        UINT32 guidIndex = *entryBody;
+        if ((guidIndex + 1) * sizeof(EFI_GUID) > (UINT32)store.size())
+            return false;
+        key.guid = readUnaligned((const EFI_GUID*)(store.constData() + store.size()) - 1 - guidIndex);
+    }
+
+    UINT32 nameSize = entryHeader->Size - sizeof(NVAR_ENTRY_HEADER) - nameOffset;
+    if (entryHeader->Attributes & NVRAM_NVAR_ENTRY_ASCII_NAME) {
+        key.name = nvramNameFromAscii(entryBody + nameOffset, nameSize);
+        keySize = nameOffset + (UINT32)key.name.size() + 1;
+    }
+    else {
+        key.name = nvramNameFromUcs2(entryBody + nameOffset, nameSize);
+        keySize = nameOffset + ((UINT32)key.name.size() + 1) * 2;
+    }
+    return true;
+}
+
 USTATUS NvramParser::parseNvarStore(const UModelIndex & index)
 {
     // Sanity check
@@ -49,6 +103,8 @@ USTATUS NvramParser::parseNvarStore(const UModelIndex & index)
     // Parse all entries
     UINT32 offset = 0;
     UINT32 guidsInStore = 0;
+    // Names of chains continued by data-only entries at these offsets
+    std::map<UINT32, NVRAM_VARIABLE_KEY> chainKeys;
     while (1) {
         bool msgUnknownExtDataFormat = false;
         bool msgExtHeaderTooLong = false;
@@ -265,18 +321,14 @@ USTATUS NvramParser::parseNvarStore(const UModelIndex & index)
                 nameSize = (UINT32)(text.length() + 1);
             }
             else { // Name is stored as UCS2 string of CHAR16s
-#if QT_VERSION_MAJOR >= 6
-                text = UString::fromUtf16((char16_t*)namePtr);
-#else
-                text = UString::fromUtf16((CHAR16*)namePtr);
-#endif
-
-                nameSize = (UINT32)((text.length() + 1) * 2);
+                UINT32 nameBytes = (UINT32)(data.constData() + data.size() - namePtr);
+                text = uFromUtf16(namePtr, nameBytes);
+                nameSize = (utf16Length(namePtr, nameBytes / 2) + 1) * 2;
             }
 
             // Get entry GUID
             if (entryHeader->Attributes & NVRAM_NVAR_ENTRY_GUID) { // GUID is strored in the variable itself
-                name = guidToUString(readUnaligned((EFI_GUID*)(entryHeader + 1)));
+                name = guidToUString(readUnaligned((EFI_GUID*)(entryHeader + 1)), ffsParser->getGuidDatabase());
                 guid = guidToUString(readUnaligned((EFI_GUID*)(entryHeader + 1)), false);
             }
             // GUID is stored in GUID list at the end of the store
@@ -287,7 +339,7 @@ USTATUS NvramParser::parseNvarStore(const UModelIndex & index)
 
                 // The list begins at the end of the store and goes backwards
                 const EFI_GUID* guidPtr = (const EFI_GUID*)(data.constData() + data.size()) - 1 - guidIndex;
-                name = guidToUString(readUnaligned(guidPtr));
+                name = guidToUString(readUnaligned(guidPtr), ffsParser->getGuidDatabase());
                 guid = guidToUString(readUnaligned(guidPtr), false);
                 hasGuidIndex = true;
             }
@@ -360,6 +412,27 @@ USTATUS NvramParser::parseNvarStore(const UModelIndex & index)
         // Set parsing data for created entry
         model->setParsingData(varIndex, UByteArray((const char*)&pdata, sizeof(pdata)));
 
+        // Add entry to variable index, data-only entries take the name of their chain
+        NVRAM_VARIABLE_KEY key;
+        UINT32 keySize = 0;
+        bool hasKey = false;
+        if (entryHeader->Attributes & NVRAM_NVAR_ENTRY_DATA_ONLY) {
+            std::map<UINT32, NVRAM_VARIABLE_KEY>::const_iterator chain = chainKeys.find(offset);
+            if (chain != chainKeys.end()) {
+                key = chain->second;
+                hasKey = true;
+            }
+        }
+        else {
+            hasKey = nvarEntryKey(data, offset, key, keySize);
+        }
+        if (hasKey) {
+            // Bodies of invalid entries still hold GUID and name
+            indexVariable(varIndex, key, entryHeader->Attributes, pdata.isValid == TRUE, subtype == Subtypes::InvalidNvarEntry ? keySize : 0);
+            if (entryHeader->Next != lastVariableFlag)
+                chainKeys[offset + entryHeader->Next] = key;
+        }
+
         // Show messages
         if (msgUnknownExtDataFormat) msg(usprintf("%s: unknown extended data format", __FUNCTION__), varIndex);
         if (msgExtHeaderTooLong)     msg(usprintf("%s: extended header size (%Xh) is greater than body size (%" PRIXQ "h)", __FUNCTION__,
@@ -501,42 +574,78 @@ USTATUS NvramParser::parseNvramVolumeBody(const UModelIndex & index)
         }
     }
 
-    // Parse bodies
+    // Parse bodies of VSS, Fsys and EVSA stores in parallel, each one fills only its own subtree.
+    // Messages and variables of every store are then taken in store order together with serially
+    // parsed FDC and flash map stores, that may contain nested volumes, so result does not depend on scheduling.
+    std::vector<UModelIndex> stores;
     for (int i = 0; i < model->rowCount(index); i++) {
 #if ((QT_VERSION_MAJOR == 5) && (QT_VERSION_MINOR < 6)) || (QT_VERSION_MAJOR < 5)
         UModelIndex current = index.child(i, 0);
 #else
         UModelIndex current = index.model()->index(i, 0, index);
 #endif
+        stores.push_back(current);
+    }
 
-        switch (model->type(current)) {
-        case Types::FdcStore:
-            parseFdcStoreBody(current);
-            break;
-        case Types::VssStore:
-            parseVssStoreBody(current, 0);
-            break;
-        case Types::Vss2Store:
-            parseVssStoreBody(current, 4);
-            break;
-        case Types::FsysStore:
-            parseFsysStoreBody(current);
-            break;
-        case Types::EvsaStore:
-            parseEvsaStoreBody(current);
-            break;
-        case Types::FlashMapStore:
-            parseFlashMapBody(current);
-            break;
-        default:
-            // Ignore unknown!
-            break;
-        }
+    std::vector<size_t> parallelStores;
+    for (size_t i = 0; i < stores.size(); i++) {
+        UINT8 type = model->type(stores[i]);
+        if (type == Types::VssStore || type == Types::Vss2Store || type == Types::FsysStore || type == Types::EvsaStore)
+            parallelStores.push_back(i);
+    }
+
+    std::vector<std::vector<std::pair<UString, UModelIndex> > > storeMessages(stores.size());
+    std::vector<std::vector<NVRAM_VARIABLE> > variables(stores.size());
+    std::function<void(size_t)> parseParallelStore = [this, &stores, &parallelStores, &storeMessages, &variables](size_t i) {
+        size_t store = parallelStores[i];
+        NvramParser worker(model, ffsParser);
+        worker.storeVariables = &variables[store];
+        worker.parseStoreBody(stores[store]);
+        storeMessages[store].swap(worker.messagesVector);
+    };
+    // Fixed flag of new items in compressed data is rewritten at the compression boundary
+    // above the volume, so stores there are parsed serially
+    if (model->compressed(index)) {
+        for (size_t i = 0; i < parallelStores.size(); i++)
+            parseParallelStore(i);
+    }
+    else {
+        sharedThreadPool().parallelFor(parallelStores.size(), parseParallelStore);
+    }
+
+    for (size_t i = 0; i < stores.size(); i++) {
+        UINT8 type = model->type(stores[i]);
+        if (type == Types::FdcStore || type == Types::FlashMapStore)
+            parseStoreBody(stores[i]);
+        messagesVector.insert(messagesVector.end(), storeMessages[i].begin(), storeMessages[i].end());
+        for (size_t j = 0; j < variables[i].size(); j++)
+            ffsParser->nvramIndex.add(variables[i][j]);
     }
 
     return U_SUCCESS;
 }
 
+USTATUS NvramParser::parseStoreBody(const UModelIndex & index)
+{
+    switch (model->type(index)) {
+    case Types::FdcStore:
+        return parseFdcStoreBody(index);
+    case Types::VssStore:
+        return parseVssStoreBody(index, 0);
+    case Types::Vss2Store:
+        return parseVssStoreBody(index, 4);
+    case Types::FsysStore:
+        return parseFsysStoreBody(index);
+    case Types::EvsaStore:
+        return parseEvsaStoreBody(index);
+    case Types::FlashMapStore:
+        return parseFlashMapBody(index);
+    default:
+        // Ignore unknown!
+        return U_SUCCESS;
+    }
+}
+
 USTATUS NvramParser::findNextStore(const UModelIndex & index, const UByteArray & volume, const UINT32 localOffset, const UINT32 storeOffset, UINT32 & nextStoreOffset)
 {
     UINT32 dataSize = (UINT32)volume.size();
@@ -1511,14 +1620,10 @@ USTATUS NvramParser::parseVssStoreBody(const UModelIndex & index, UINT8 alignmen
             name = UString("Invalid");
         }
         else { // Add GUID and text for valid variables
-            name = guidToUString(readUnaligned(variableGuid));
+            name = guidToUString(readUnaligned(variableGuid), ffsParser->getGuidDatabase());
             info += UString("Variable GUID: ") + guidToUString(readUnaligned(variableGuid), false) + UString("\n");
 
-#if QT_VERSION_MAJOR >= 6
-            text = UString::fromUtf16((char16_t *)variableName);
-#else
-            text = UString::fromUtf16(variableName);
-#endif
+            text = uFromUtf16(variableName, dataSize - (UINT32)((const char*)variableName - data.constData()));
         }
 
         // Add info
@@ -1551,7 +1656,16 @@ USTATUS NvramParser::parseVssStoreBody(const UModelIndex & index, UINT8 alignmen
         }
 
         // Add tree item
-        model->addItem(localOffset + offset, Types::VssEntry, subtype, name, text, info, header, body, UByteArray(), Fixed, index);
+        UModelIndex varIndex = model->addItem(localOffset + offset, Types::VssEntry, subtype, name, text, info, header, body, UByteArray(), Fixed, index);
+
+        // Add variable to index, deleted ones included
+        if (variableGuid) {
+            NVRAM_VARIABLE_KEY key;
+            key.guid = readUnaligned(variableGuid);
+            UINT32 nameOffset = (UINT32)((const char*)variableName - data.constData());
+            key.name = nvramNameFromUcs2(variableName, nameOffset < offset + variableSize ? offset + variableSize - nameOffset : 0);
+            indexVariable(varIndex, key, variableHeader->Attributes, !isInvalid);
+        }
 
         // Apply alignment, if needed
         if (alignment) {
@@ -1650,7 +1764,13 @@ USTATUS NvramParser::parseFsysStoreBody(const UModelIndex & index)
             body.size(), body.size());
 
         // Add tree item
-        model->addItem(localOffset + offset, Types::FsysEntry, valid ? Subtypes::NormalFsysEntry : Subtypes::InvalidFsysEntry, UString(name.constData()), UString(), info, header, body, UByteArray(), Fixed, index);
+        UModelIndex varIndex = model->addItem(localOffset + offset, Types::FsysEntry, valid ? Subtypes::NormalFsysEntry : Subtypes::InvalidFsysEntry, UString(name.constData()), UString(), info, header, body, UByteArray(), Fixed, index);
+
+        // Add variable to index, Fsys variables have no vendor GUID
+        NVRAM_VARIABLE_KEY key;
+        memset(&key.guid, 0, sizeof(EFI_GUID));
+        key.name = nvramNameFromAscii(name.constData(), (UINT32)name.size());
+        indexVariable(varIndex, key, 0, valid);
 
         // Move to next variable
         offset += variableSize;
@@ -1686,6 +1806,7 @@ USTATUS NvramParser::parseEvsaStoreBody(const UModelIndex & index)
 
     std::map<UINT16, EFI_GUID> guidMap;
     std::map<UINT16, UString> nameMap;
+    std::map<UINT16, std::u16string> variableNameMap;
 
     // Parse all entries
     UINT32 unparsedSize = storeDataSize;
@@ -1731,7 +1852,7 @@ USTATUS NvramParser::parseEvsaStoreBody(const UModelIndex & index)
             header = data.mid(offset, sizeof(EVSA_GUID_ENTRY));
             body = data.mid(offset + sizeof(EVSA_GUID_ENTRY), guidHeader->Header.Size - sizeof(EVSA_GUID_ENTRY));
             EFI_GUID guid = *(EFI_GUID*)body.constData();
-            name = guidToUString(guid);
+            name = guidToUString(guid, ffsParser->getGuidDatabase());
             info = UString("GUID: ") + guidToUString(guid, false) + usprintf("\nFull size: %Xh (%u)\nHeader size: %" PRIXQ "h (%" PRIuQ ")\nBody size: %" PRIXQ "h (%" PRIuQ ")\nType: %02Xh\nChecksum: %02Xh",
                 variableSize, variableSize,
                 header.size(), header.size(),
@@ -1750,11 +1871,7 @@ USTATUS NvramParser::parseEvsaStoreBody(const UModelIndex & index)
             header = data.mid(offset, sizeof(EVSA_NAME_ENTRY));
             body = data.mid(offset + sizeof(EVSA_NAME_ENTRY), nameHeader->Header.Size - sizeof(EVSA_NAME_ENTRY));
 
-#if QT_VERSION_MAJOR >= 6
-            name = UString::fromUtf16((const char16_t *)body.constData());
-#else
-            name = UString::fromUtf16((const CHAR16*)body.constData());
-#endif
+            name = uFromUtf16(body.constData(), (UINT32)body.size());
 
             info = UString("Name: ") + name + usprintf("\nFull size: %Xh (%u)\nHeader size: %" PRIXQ "h (%" PRIuQ ")\nBody size: %" PRIXQ "h (%" PRIuQ ")\nType: %02Xh\nChecksum: %02Xh",
                 variableSize, variableSize,
@@ -1766,6 +1883,7 @@ USTATUS NvramParser::parseEvsaStoreBody(const UModelIndex & index)
                 + usprintf("\nVarId: %04Xh", nameHeader->VarId);
             subtype = Subtypes::NameEvsaEntry;
             nameMap.insert(std::pair<UINT16, UString>(nameHeader->VarId, name));
+            variableNameMap.insert(std::pair<UINT16, std::u16string>(nameHeader->VarId, nvramNameFromUcs2(body.constData(), (UINT32)body.size())));
         }
         // Data entry
         else if (entryHeader->Type == NVRAM_EVSA_ENTRY_TYPE_DATA1 ||
@@ -1870,6 +1988,12 @@ USTATUS NvramParser::parseEvsaStoreBody(const UModelIndex & index)
                 }
                 model->setText(current, name);
                 model->addInfo(current, UString("GUID: ") + guid + UString("\nName: ") + name + UString("\n"), false);
+
+                // Add variable to index, invalid data entries included
+                NVRAM_VARIABLE_KEY key;
+                key.guid = guidMap[dataHeader->GuidId];
+                key.name = variableNameMap[dataHeader->VarId];
+                indexVariable(current, key, dataHeader->Attributes, dataHeader->Header.Type != NVRAM_EVSA_ENTRY_TYPE_DATA_INVALID);
             }
         }
     }
@@ -1912,7 +2036,7 @@ USTATUS NvramParser::parseFlashMapBody(const UModelIndex & index)
             break;
         }
 
-        UString name = guidToUString(entryHeader->Guid);
+        UString name = guidToUString(entryHeader->Guid, ffsParser->getGuidDatabase());
 
         // Construct header
         UByteArray header = data.mid(offset, sizeof(PHOENIX_FLASH_MAP_ENTRY));
@@ -28,7 +28,7 @@ class NvramParser
 {
 public:
     // Default constructor and destructor
-    NvramParser(TreeModel* treeModel, FfsParser* parser) : model(treeModel), ffsParser(parser) {}
+    NvramParser(TreeModel* treeModel, FfsParser* parser) : model(treeModel), ffsParser(parser), storeVariables(NULL) {}
     ~NvramParser() {}
 
     // Returns messages
@@ -44,10 +44,16 @@ private:
     TreeModel *model;
     FfsParser *ffsParser;
     std::vector<std::pair<UString, UModelIndex> > messagesVector;
+    // Variables of a store parsed on a worker, added to NVRAM index by the volume parser if set
+    std::vector<NVRAM_VARIABLE>* storeVariables;
     void msg(const UString & message, const UModelIndex & index = UModelIndex()) {
+        STATS_ADD(StatsCounters::MessagesEmitted, 1);
         messagesVector.push_back(std::pair<UString, UModelIndex>(message, index));
     };
 
+    // Adds variable entry item to NVRAM index of the FFS parser, data begins at dataOffset of item body
+    void indexVariable(const UModelIndex & varIndex, const NVRAM_VARIABLE_KEY & key, const UINT32 attributes, const bool isValid, const UINT32 dataOffset = 0);
+
     USTATUS findNextStore(const UModelIndex & index, const UByteArray & volume, const UINT32 localOffset, const UINT32 storeOffset, UINT32 & nextStoreOffset);
     USTATUS getStoreSize(const UByteArray & data, const UINT32 storeOffset, UINT32 & storeSize);
     USTATUS parseStoreHeader(const UByteArray & store, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index);
@@ -63,6 +69,7 @@ private:
     USTATUS parseSlicPubkeyHeader(const UByteArray & store, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index);
     USTATUS parseSlicMarkerHeader(const UByteArray & store, const UINT32 localOffset, const UModelIndex & parent, UModelIndex & index);
 
+    USTATUS parseStoreBody(const UModelIndex & index);
     USTATUS parseFdcStoreBody(const UModelIndex & index);
     USTATUS parseVssStoreBody(const UModelIndex & index, const UINT8 alignment);
     USTATUS parseFsysStoreBody(const UModelIndex & index);
@@ -0,0 +1,458 @@
+/* parserstats.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "parserstats.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <new>
+
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT) && !defined(U_ENABLE_STATS_SUPPORT)
+#error U_ENABLE_ALLOC_STATS_SUPPORT requires U_ENABLE_STATS_SUPPORT
+#endif
+
+#if defined(U_ENABLE_STATS_SUPPORT)
+static const char* timerNames[StatsTimers::Count] = {
+    "fileRead",
+    "crc",
+    "parse",
+    "firstPass",
+    "secondPass",
+    "fit",
+    "protectedRanges",
+    "teImageBase",
+    "addInfo",
+    "decompressEfi",
+    "decompressLzma",
+    "decompressLzmaF86",
+    "decompressGzip",
+    "explore",
+    "treeHash",
+    "jsonRead",
+    "jsonWrite",
+    "nvramDiff"
+};
+
+static const char* counterNames[StatsCounters::Count] = {
+    "bytesScanned",
+    "bytesDecompressedEfi",
+    "bytesDecompressedLzma",
+    "bytesDecompressedLzmaF86",
+    "bytesDecompressedGzip",
+    "itemsCreated",
+    "messagesEmitted"
+};
+
+static std::atomic<UINT64> timerNs[StatsTimers::Count];
+static std::atomic<UINT64> timerCalls[StatsTimers::Count];
+static std::atomic<UINT64> counterValues[StatsCounters::Count];
+
+// Innermost timer scope of the calling thread, allocations are attributed to it.
+// StatsTimers::Count stands for allocations outside of any scope.
+static thread_local UINT8 currentPhase = StatsTimers::Count;
+
+static UINT64 statsNow()
+{
+    return (UINT64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+static const char* perfCounterNames[StatsPerfCounters::Count] = {
+    "cycles",
+    "instructions",
+    "cacheMisses",
+    "branchMisses"
+};
+
+static const UINT64 perfCounterConfigs[StatsPerfCounters::Count] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static std::atomic<bool> perfEnabled(false);
+static std::atomic<UINT64> perfValues[StatsTimers::Count][StatsPerfCounters::Count];
+
+// Counter group of one thread, opened on first use and closed when the thread exits
+class PerfGroup
+{
+public:
+    PerfGroup() : opened(false), failed(false), numOpened(0) {
+        for (int i = 0; i < StatsPerfCounters::Count; i++) {
+            fds[i] = -1;
+            slots[i] = -1;
+        }
+    }
+
+    ~PerfGroup() {
+        for (int i = 0; i < StatsPerfCounters::Count; i++)
+            if (fds[i] >= 0)
+                close(fds[i]);
+    }
+
+    // Group leader is the cycle counter, other counters are skipped when the CPU has no such event
+    bool open(std::string & reason) {
+        if (opened || failed)
+            return opened;
+        for (int i = 0; i < StatsPerfCounters::Count; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = perfCounterConfigs[i];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.disabled = (i == 0);
+            fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fds[i] < 0) {
+                if (i == 0) {
+                    reason = std::string("perf_event_open failed: ") + strerror(errno);
+                    failed = true;
+                    return false;
+                }
+                continue;
+            }
+            slots[i] = numOpened++;
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        opened = true;
+        return true;
+    }
+
+    bool read(UINT64* values) {
+        std::string reason;
+        if (!open(reason))
+            return false;
+        UINT64 buffer[1 + StatsPerfCounters::Count];
+        if (::read(fds[0], buffer, sizeof(buffer)) < (ssize_t)sizeof(UINT64) * (1 + numOpened))
+            return false;
+        for (int i = 0; i < StatsPerfCounters::Count; i++)
+            values[i] = slots[i] >= 0 ? buffer[1 + slots[i]] : 0;
+        return true;
+    }
+
+private:
+    bool opened;
+    bool failed;
+    int numOpened;
+    int fds[StatsPerfCounters::Count];
+    int slots[StatsPerfCounters::Count];
+};
+
+static thread_local PerfGroup perfGroup;
+
+bool statsEnablePerfCounters(std::string & reason)
+{
+    UINT64 values[StatsPerfCounters::Count];
+    if (!perfGroup.open(reason) || !perfGroup.read(values))
+        return false;
+    perfEnabled = true;
+    return true;
+}
+#else
+bool statsEnablePerfCounters(std::string & reason)
+{
+    reason = "hardware counters are supported on Linux only";
+    return false;
+}
+#endif
+
+StatsScope::StatsScope(const UINT8 timerType) : timer(timerType), previousPhase(currentPhase), start(statsNow())
+{
+    currentPhase = timerType;
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    perf = perfEnabled.load(std::memory_order_relaxed) && perfGroup.read(perfStart);
+#endif
+}
+
+StatsScope::~StatsScope()
+{
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    UINT64 perfEnd[StatsPerfCounters::Count];
+    if (perf && perfGroup.read(perfEnd)) {
+        for (int i = 0; i < StatsPerfCounters::Count; i++)
+            perfValues[timer][i].fetch_add(perfEnd[i] - perfStart[i], std::memory_order_relaxed);
+    }
+#endif
+    timerNs[timer].fetch_add(statsNow() - start, std::memory_order_relaxed);
+    timerCalls[timer].fetch_add(1, std::memory_order_relaxed);
+    currentPhase = previousPhase;
+}
+
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT)
+// Size of every block is kept in a header in front of it,
+// header size keeps the alignment malloc guarantees
+#define ALLOC_HEADER_SIZE 16
+
+static std::atomic<UINT64> allocCalls[StatsTimers::Count + 1];
+static std::atomic<UINT64> allocBytes[StatsTimers::Count + 1];
+// Highest number of live bytes of the whole process seen while the phase was active
+static std::atomic<UINT64> allocPeak[StatsTimers::Count + 1];
+static std::atomic<UINT64> liveBytes;
+static std::atomic<UINT64> livePeak;
+
+static void updatePeak(std::atomic<UINT64> & peak, const UINT64 value)
+{
+    UINT64 current = peak.load(std::memory_order_relaxed);
+    while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+void* statsMalloc(size_t size)
+{
+    UINT8* block = (UINT8*)malloc(size + ALLOC_HEADER_SIZE);
+    if (!block)
+        return NULL;
+    *(size_t*)block = size;
+
+    UINT8 phase = currentPhase;
+    allocCalls[phase].fetch_add(1, std::memory_order_relaxed);
+    allocBytes[phase].fetch_add(size, std::memory_order_relaxed);
+    UINT64 live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    updatePeak(allocPeak[phase], live);
+    updatePeak(livePeak, live);
+    return block + ALLOC_HEADER_SIZE;
+}
+
+void statsFree(void* pointer)
+{
+    if (!pointer)
+        return;
+    UINT8* block = (UINT8*)pointer - ALLOC_HEADER_SIZE;
+    liveBytes.fetch_sub(*(size_t*)block, std::memory_order_relaxed);
+    free(block);
+}
+
+void* operator new(size_t size)
+{
+    void* pointer = statsMalloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return statsMalloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return statsMalloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    statsFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    statsFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    statsFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    statsFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t &) noexcept
+{
+    statsFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t &) noexcept
+{
+    statsFree(pointer);
+}
+#endif
+
+void statsAdd(const UINT8 counterType, const UINT64 value)
+{
+    counterValues[counterType].fetch_add(value, std::memory_order_relaxed);
+}
+
+bool statsEnabled()
+{
+    return true;
+}
+
+void statsReset()
+{
+    for (int i = 0; i < StatsTimers::Count; i++) {
+        timerNs[i] = 0;
+        timerCalls[i] = 0;
+    }
+    for (int i = 0; i < StatsCounters::Count; i++)
+        counterValues[i] = 0;
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    for (int i = 0; i < StatsTimers::Count; i++)
+        for (int j = 0; j < StatsPerfCounters::Count; j++)
+            perfValues[i][j] = 0;
+#endif
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT)
+    for (int i = 0; i <= StatsTimers::Count; i++) {
+        allocCalls[i] = 0;
+        allocBytes[i] = 0;
+        allocPeak[i] = 0;
+    }
+    livePeak = liveBytes.load();
+#endif
+}
+
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+// Bytes processed by the phase, decompression phases produce decompressed bytes,
+// all other phases go over the whole input
+static UINT64 perfPhaseBytes(const int timerType)
+{
+    switch (timerType) {
+    case StatsTimers::DecompressEfi:     return counterValues[StatsCounters::BytesDecompressedEfi];
+    case StatsTimers::DecompressLzma:    return counterValues[StatsCounters::BytesDecompressedLzma];
+    case StatsTimers::DecompressLzmaF86: return counterValues[StatsCounters::BytesDecompressedLzmaF86];
+    case StatsTimers::DecompressGzip:    return counterValues[StatsCounters::BytesDecompressedGzip];
+    default:                             return counterValues[StatsCounters::BytesScanned];
+    }
+}
+#endif
+
+void statsOutput(std::ostream & outputStream)
+{
+    std::ios_base::fmtflags flags(outputStream.flags());
+    outputStream << "Parser statistics:" << std::endl;
+    outputStream << "   " << std::left << std::setw(20) << "Timer" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Total ms" << std::setw(14) << "Avg us" << std::endl;
+    for (int i = 0; i < StatsTimers::Count; i++) {
+        UINT64 calls = timerCalls[i];
+        if (!calls)
+            continue;
+        double totalMs = timerNs[i] / 1000000.0;
+        outputStream << "   " << std::left << std::setw(20) << timerNames[i] << std::right << std::setw(10) << calls
+            << std::fixed << std::setprecision(3) << std::setw(14) << totalMs
+            << std::setw(14) << totalMs * 1000.0 / calls << std::endl;
+    }
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    if (perfEnabled) {
+        outputStream << std::endl << "   " << std::left << std::setw(20) << "Hardware counters" << std::right << std::setw(14) << "Cycles"
+            << std::setw(14) << "Instructions" << std::setw(8) << "IPC" << std::setw(16) << "Cache miss/KB" << std::setw(16) << "Branch miss/KB" << std::endl;
+        for (int i = 0; i < StatsTimers::Count; i++) {
+            if (!timerCalls[i])
+                continue;
+            UINT64 cycles = perfValues[i][StatsPerfCounters::Cycles];
+            UINT64 kilobytes = perfPhaseBytes(i) / 1024;
+            outputStream << "   " << std::left << std::setw(20) << timerNames[i] << std::right << std::setw(14) << cycles
+                << std::setw(14) << perfValues[i][StatsPerfCounters::Instructions] << std::fixed << std::setprecision(2)
+                << std::setw(8) << (cycles ? (double)perfValues[i][StatsPerfCounters::Instructions] / cycles : 0.0)
+                << std::setw(16) << (kilobytes ? (double)perfValues[i][StatsPerfCounters::CacheMisses] / kilobytes : 0.0)
+                << std::setw(16) << (kilobytes ? (double)perfValues[i][StatsPerfCounters::BranchMisses] / kilobytes : 0.0) << std::endl;
+        }
+    }
+#endif
+    outputStream << std::endl << "   " << std::left << std::setw(26) << "Counter" << std::right << std::setw(14) << "Value" << std::endl;
+    for (int i = 0; i < StatsCounters::Count; i++)
+        outputStream << "   " << std::left << std::setw(26) << counterNames[i] << std::right << std::setw(14) << counterValues[i] << std::endl;
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT)
+    outputStream << std::endl << "   " << std::left << std::setw(20) << "Allocations" << std::right << std::setw(10) << "Calls"
+        << std::setw(14) << "Bytes" << std::setw(14) << "Peak live" << std::endl;
+    for (int i = 0; i <= StatsTimers::Count; i++) {
+        if (!allocCalls[i])
+            continue;
+        outputStream << "   " << std::left << std::setw(20) << (i < StatsTimers::Count ? timerNames[i] : "other") << std::right
+            << std::setw(10) << allocCalls[i] << std::setw(14) << allocBytes[i] << std::setw(14) << allocPeak[i] << std::endl;
+    }
+    outputStream << "   " << std::left << std::setw(20) << "peakLiveBytes" << std::right << std::setw(38) << livePeak << std::endl;
+#endif
+    outputStream << std::endl;
+    outputStream.flags(flags);
+}
+
+void statsOutputJson(std::ostream & outputStream)
+{
+    std::ios_base::fmtflags flags(outputStream.flags());
+    outputStream << "{\"timers\":{";
+    for (int i = 0; i < StatsTimers::Count; i++) {
+        outputStream << (i ? "," : "") << "\"" << timerNames[i] << "\":{\"calls\":" << timerCalls[i]
+            << ",\"totalMs\":" << std::fixed << std::setprecision(3) << timerNs[i] / 1000000.0 << "}";
+    }
+    outputStream << "},\"counters\":{";
+    for (int i = 0; i < StatsCounters::Count; i++)
+        outputStream << (i ? "," : "") << "\"" << counterNames[i] << "\":" << counterValues[i];
+    outputStream << "}";
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    if (perfEnabled) {
+        outputStream << ",\"hardwareCounters\":{";
+        for (int i = 0; i < StatsTimers::Count; i++) {
+            outputStream << (i ? "," : "") << "\"" << timerNames[i] << "\":{";
+            for (int j = 0; j < StatsPerfCounters::Count; j++)
+                outputStream << (j ? "," : "") << "\"" << perfCounterNames[j] << "\":" << perfValues[i][j];
+            outputStream << ",\"bytes\":" << perfPhaseBytes(i) << "}";
+        }
+        outputStream << "}";
+    }
+#endif
+#if defined(U_ENABLE_ALLOC_STATS_SUPPORT)
+    outputStream << ",\"allocations\":{";
+    for (int i = 0; i <= StatsTimers::Count; i++) {
+        outputStream << (i ? "," : "") << "\"" << (i < StatsTimers::Count ? timerNames[i] : "other") << "\":{\"calls\":" << allocCalls[i]
+            << ",\"bytes\":" << allocBytes[i] << ",\"peakLiveBytes\":" << allocPeak[i] << "}";
+    }
+    outputStream << "},\"peakLiveBytes\":" << livePeak;
+#endif
+    outputStream << "}" << std::endl;
+    outputStream.flags(flags);
+}
+#else
+bool statsEnabled()
+{
+    return false;
+}
+
+bool statsEnablePerfCounters(std::string & reason)
+{
+    reason = "parser statistics are disabled in this build";
+    return false;
+}
+
+void statsReset()
+{
+}
+
+void statsOutput(std::ostream & outputStream)
+{
+    outputStream << "Parser statistics are disabled in this build." << std::endl;
+}
+
+void statsOutputJson(std::ostream & outputStream)
+{
+    outputStream << "{}" << std::endl;
+}
+#endif
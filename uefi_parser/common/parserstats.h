@@ -0,0 +1,117 @@
+/* parserstats.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef PARSERSTATS_H
+#define PARSERSTATS_H
+
+#include <ostream>
+#include <string>
+
+#include "basetypes.h"
+#include "allocstats.h"
+
+// Comment out to compile all timers and counters out of the engine
+#define U_ENABLE_STATS_SUPPORT
+
+// Hardware counters of every timer scope read with perf_event_open, Linux only
+#if defined(U_ENABLE_STATS_SUPPORT) && defined(__linux__)
+#define U_ENABLE_PERF_STATS_SUPPORT
+#endif
+
+namespace StatsPerfCounters {
+    enum StatsPerfCounterTypes {
+        Cycles = 0,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        Count
+    };
+}
+
+// Process-wide timers, nested scopes are measured inclusively.
+// Time of scopes running concurrently on several threads is summed up.
+namespace StatsTimers {
+    enum StatsTimerTypes {
+        FileRead = 0,
+        Crc,
+        Parse,
+        FirstPass,
+        SecondPass,
+        Fit,
+        ProtectedRanges,
+        TeImageBase,
+        AddInfo,
+        DecompressEfi,
+        DecompressLzma,
+        DecompressLzmaF86,
+        DecompressGzip,
+        Explore,
+        TreeHash,
+        JsonRead,
+        JsonWrite,
+        NvramDiff,
+        Count
+    };
+}
+
+namespace StatsCounters {
+    enum StatsCounterTypes {
+        BytesScanned = 0,
+        BytesDecompressedEfi,
+        BytesDecompressedLzma,
+        BytesDecompressedLzmaF86,
+        BytesDecompressedGzip,
+        ItemsCreated,
+        MessagesEmitted,
+        Count
+    };
+}
+
+#if defined(U_ENABLE_STATS_SUPPORT)
+class StatsScope
+{
+public:
+    explicit StatsScope(const UINT8 timerType);
+    ~StatsScope();
+
+private:
+    UINT8 timer;
+    UINT8 previousPhase;
+    UINT64 start;
+#if defined(U_ENABLE_PERF_STATS_SUPPORT)
+    bool perf;
+    UINT64 perfStart[StatsPerfCounters::Count];
+#endif
+};
+
+void statsAdd(const UINT8 counterType, const UINT64 value);
+
+#define STATS_SCOPE_NAME2(line) statsScope##line
+#define STATS_SCOPE_NAME(line) STATS_SCOPE_NAME2(line)
+#define STATS_SCOPE(timerType) StatsScope STATS_SCOPE_NAME(__LINE__)(timerType)
+#define STATS_ADD(counterType, value) statsAdd(counterType, (UINT64)(value))
+#else
+#define STATS_SCOPE(timerType)
+#define STATS_ADD(counterType, value)
+#endif
+
+bool statsEnabled();
+// Start counting cycles, instructions, cache and branch misses in timer scopes.
+// Returns false with the reason when hardware counters are not available.
+bool statsEnablePerfCounters(std::string & reason);
+void statsReset();
+// Human readable tables or one JSON object, with allocations per phase
+// when built with U_ENABLE_ALLOC_STATS_SUPPORT
+void statsOutput(std::ostream & outputStream);
+void statsOutputJson(std::ostream & outputStream);
+
+#endif // PARSERSTATS_H
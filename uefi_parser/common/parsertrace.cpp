@@ -0,0 +1,191 @@
+/* parsertrace.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "parsertrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(U_ENABLE_TRACE_SUPPORT)
+struct TRACE_EVENT {
+    UINT64 timestamp;
+    const char* name;
+    std::string path;
+    UINT64 size;
+    bool begin;
+};
+
+struct TRACE_THREAD {
+    UINT32 tid;
+    std::string name;
+    std::vector<TRACE_EVENT> events;
+    std::vector<std::string> paths;
+};
+
+std::atomic<bool> traceActive(false);
+
+static std::mutex traceMutex;
+static std::vector<std::shared_ptr<TRACE_THREAD> > traceThreads;
+static std::atomic<UINT32> traceGeneration(0);
+static std::chrono::steady_clock::time_point traceStartTime;
+
+// Buffer of the calling thread, registered again after every traceStart()
+static thread_local std::shared_ptr<TRACE_THREAD> currentThread;
+static thread_local UINT32 currentGeneration = 0;
+
+static TRACE_THREAD* traceThread()
+{
+    if (currentThread && currentGeneration == traceGeneration)
+        return currentThread.get();
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (!currentThread || currentGeneration != traceGeneration) {
+        currentThread = std::make_shared<TRACE_THREAD>();
+        currentThread->tid = (UINT32)traceThreads.size() + 1;
+        currentThread->name = "Thread " + std::to_string(currentThread->tid);
+        currentGeneration = traceGeneration;
+        traceThreads.push_back(currentThread);
+    }
+    return currentThread.get();
+}
+
+static UINT64 traceNow()
+{
+    return (UINT64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStartTime).count();
+}
+
+TraceScope::TraceScope(const char* scopeName, const UString & path, const UINT64 size) : name(scopeName), active(traceEnabled())
+{
+    if (!active)
+        return;
+
+    TRACE_THREAD* thread = traceThread();
+    std::string itemPath(path.toLocal8Bit());
+    if (itemPath.empty() && !thread->paths.empty())
+        itemPath = thread->paths.back();
+    thread->paths.push_back(itemPath);
+
+    TRACE_EVENT event;
+    event.timestamp = traceNow();
+    event.name = name;
+    event.path = itemPath;
+    event.size = size;
+    event.begin = true;
+    thread->events.push_back(event);
+}
+
+TraceScope::~TraceScope()
+{
+    if (!active)
+        return;
+
+    TRACE_THREAD* thread = traceThread();
+    if (!thread->paths.empty())
+        thread->paths.pop_back();
+
+    TRACE_EVENT event;
+    event.timestamp = traceNow();
+    event.name = name;
+    event.size = 0;
+    event.begin = false;
+    thread->events.push_back(event);
+}
+
+static std::string traceEscape(const std::string & text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += (char)c;
+        }
+        else if (c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        }
+        else {
+            escaped += (char)c;
+        }
+    }
+    return escaped;
+}
+
+bool traceStart()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceThreads.clear();
+    traceGeneration++;
+    traceStartTime = std::chrono::steady_clock::now();
+    traceActive = true;
+    return true;
+}
+
+void traceSetThreadName(const std::string & name)
+{
+    if (!traceEnabled())
+        return;
+    TRACE_THREAD* thread = traceThread();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    thread->name = name;
+}
+
+USTATUS traceWrite(const std::string & path)
+{
+    traceActive = false;
+    std::ofstream outputFile(path, std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return U_FILE_OPEN;
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    bool first = true;
+    outputFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < traceThreads.size(); i++) {
+        const TRACE_THREAD & thread = *traceThreads[i];
+        outputFile << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread.tid
+            << ",\"args\":{\"name\":\"" << traceEscape(thread.name) << "\"}}";
+        first = false;
+        for (size_t j = 0; j < thread.events.size(); j++) {
+            const TRACE_EVENT & event = thread.events[j];
+            char timestamp[32];
+            snprintf(timestamp, sizeof(timestamp), "%.3f", event.timestamp / 1000.0);
+            outputFile << ",\n{\"ph\":\"" << (event.begin ? "B" : "E") << "\",\"name\":\"" << event.name
+                << "\",\"pid\":1,\"tid\":" << thread.tid << ",\"ts\":" << timestamp;
+            if (event.begin)
+                outputFile << ",\"args\":{\"path\":\"" << traceEscape(event.path) << "\",\"size\":" << event.size << "}";
+            outputFile << "}";
+        }
+    }
+    outputFile << "\n]}" << std::endl;
+    return outputFile ? U_SUCCESS : U_FILE_WRITE;
+}
+#else
+bool traceStart()
+{
+    return false;
+}
+
+void traceSetThreadName(const std::string &)
+{
+}
+
+USTATUS traceWrite(const std::string &)
+{
+    return U_NOT_IMPLEMENTED;
+}
+#endif
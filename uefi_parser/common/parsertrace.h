@@ -0,0 +1,61 @@
+/* parsertrace.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef PARSERTRACE_H
+#define PARSERTRACE_H
+
+#include <atomic>
+#include <string>
+
+#include "basetypes.h"
+#include "ustring.h"
+
+// Comment out to compile all trace points out of the engine
+#define U_ENABLE_TRACE_SUPPORT
+
+// Begin/end events of parser activity in Chrome trace format (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own buffer and is shown as a separate track.
+#if defined(U_ENABLE_TRACE_SUPPORT)
+extern std::atomic<bool> traceActive;
+
+inline bool traceEnabled() { return traceActive.load(std::memory_order_relaxed); }
+
+class TraceScope
+{
+public:
+    // Empty path means the path of the enclosing scope on this thread.
+    // Path and size are evaluated by TRACE_SCOPE only while recording.
+    TraceScope(const char* name, const UString & path, const UINT64 size);
+    ~TraceScope();
+
+private:
+    const char* name;
+    bool active;
+};
+
+#define TRACE_SCOPE_NAME2(line) traceScope##line
+#define TRACE_SCOPE_NAME(line) TRACE_SCOPE_NAME2(line)
+#define TRACE_SCOPE(name, path, size) TraceScope TRACE_SCOPE_NAME(__LINE__)(name, traceEnabled() ? UString(path) : UString(), traceEnabled() ? (UINT64)(size) : 0)
+#else
+inline bool traceEnabled() { return false; }
+
+#define TRACE_SCOPE(name, path, size)
+#endif
+
+// Start recording, events of previous recording are dropped
+bool traceStart();
+// Name of the track of calling thread
+void traceSetThreadName(const std::string & name);
+// Stop recording and write all events, must not run concurrently with traced code
+USTATUS traceWrite(const std::string & path);
+
+#endif // PARSERTRACE_H
@@ -15,15 +15,19 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <stdint.h>
 #include <string.h>
 
-struct sha256_state {
-    uint64_t length;
-    uint32_t state[8], curlen;
-    uint8_t buf[SHA256_DIGEST_SIZE*2];
-};
-
-void sha256_init(struct sha256_state *md);
-int sha256_process(struct sha256_state *md, const unsigned char *in, unsigned long inlen);
-int sha256_done(struct sha256_state *md, uint8_t *out);
+/* SHA extensions of x86 CPUs are used when present, checked once at run time */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SHA256_USE_SHANI
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHANI_TARGET
+#else
+#include <cpuid.h>
+#include <stdatomic.h>
+#define SHANI_TARGET __attribute__((target("sha,sse4.1")))
+#endif
+#endif
 
 #define GET_BE32(a) ((((uint32_t) (a)[0]) << 24) | (((uint32_t) (a)[1]) << 16) | \
                           (((uint32_t) (a)[2]) << 8) | ((uint32_t) (a)[3]))
@@ -59,7 +63,7 @@ void sha256(const void *in, unsigned long inlen, void* out)
 /* This is based on SHA256 implementation in LibTomCrypt that was released into
  * public domain by Tom St Denis. */
 /* the K array */
-static const unsigned long K[64] = {
+static const uint32_t K[64] = {
     0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL,
     0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL, 0xd807aa98UL, 0x12835b01UL,
     0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL,
@@ -89,6 +93,7 @@ static const unsigned long K[64] = {
 #ifndef MIN
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #endif
+#define block_size 64
 /* compress 512-bits */
 static void sha256_compress(struct sha256_state *md, unsigned char *buf)
 {
@@ -123,6 +128,115 @@ h  = t0 + t1;
         md->state[i] = md->state[i] + S[i];
     }
 }
+#ifdef SHA256_USE_SHANI
+static int sha256_shani_supported(void)
+{
+    /* SSSE3 and SSE4.1 in leaf 1, SHA in leaf 7 */
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return 0;
+    __cpuid(regs, 1);
+    if (!(regs[2] & (1 << 9)) || !(regs[2] & (1 << 19)))
+        return 0;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 29)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, 0) < 7)
+        return 0;
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & (1 << 9)) || !(ecx & (1 << 19)))
+        return 0;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1 << 29)) != 0;
+#endif
+}
+
+/* Rounds are done four at a time, state is kept as ABEF and CDGH halves the instructions work with */
+SHANI_TARGET static void sha256_compress_shani(uint32_t state[8], const unsigned char *in, unsigned long blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, saved0, saved1, msg, tmp;
+    __m128i w[4];
+    int i;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);  /* CDAB */
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B); /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);    /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0); /* CDGH */
+
+    while (blocks--) {
+        saved0 = state0;
+        saved1 = state1;
+        for (i = 0; i < 4; i++)
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 16 * i)), mask);
+
+        for (i = 0; i < 16; i++) {
+            msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            /* Schedule of the group after next one, it reuses the oldest message register */
+            if (i >= 3 && i < 15) {
+                tmp = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+                w[(i + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(w[(i + 1) & 3], tmp), w[i & 3]);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            if (i >= 1 && i < 13)
+                w[(i - 1) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+        }
+
+        state0 = _mm_add_epi32(state0, saved0);
+        state1 = _mm_add_epi32(state1, saved1);
+        in += block_size;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    /* HGFE */
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+/* CPU is checked on first use, racing first calls of pool threads store the same value atomically */
+static int sha256_use_shani(void)
+{
+#if defined(_MSC_VER)
+    static volatile long shani = -1;
+    long value = _InterlockedCompareExchange(&shani, -1, -1);
+    if (value < 0) {
+        value = sha256_shani_supported();
+        _InterlockedExchange(&shani, value);
+    }
+    return (int)value;
+#else
+    static atomic_int shani = -1;
+    int value = atomic_load_explicit(&shani, memory_order_relaxed);
+    if (value < 0) {
+        value = sha256_shani_supported();
+        atomic_store_explicit(&shani, value, memory_order_relaxed);
+    }
+    return value;
+#endif
+}
+#endif
+
+/* compress consecutive 512-bit blocks */
+static void sha256_compress_blocks(struct sha256_state *md, const unsigned char *in, unsigned long blocks)
+{
+#ifdef SHA256_USE_SHANI
+    if (sha256_use_shani()) {
+        sha256_compress_shani(md->state, in, blocks);
+        return;
+    }
+#endif
+    while (blocks--) {
+        sha256_compress(md, (unsigned char *) in);
+        in += block_size;
+    }
+}
+
 /* Initialize the hash state */
 void sha256_init(struct sha256_state *md)
 {
@@ -148,15 +262,15 @@ int sha256_process(struct sha256_state *md, const unsigned char *in,
                           unsigned long inlen)
 {
     unsigned long n;
-#define block_size 64
     if (md->curlen > sizeof(md->buf))
         return -1;
     while (inlen > 0) {
         if (md->curlen == 0 && inlen >= block_size) {
-            sha256_compress(md, (unsigned char *) in);
-            md->length += block_size * 8;
-            in += block_size;
-            inlen -= block_size;
+            n = inlen / block_size;
+            sha256_compress_blocks(md, in, n);
+            md->length += (uint64_t)n * block_size * 8;
+            in += n * block_size;
+            inlen -= n * block_size;
         } else {
             n = MIN(inlen, (block_size - md->curlen));
             memcpy(md->buf + md->curlen, in, n);
@@ -17,9 +17,22 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #define SHA256_DIGEST_SIZE 32
 
+struct sha256_state {
+    uint64_t length;
+    uint32_t state[8], curlen;
+    uint8_t buf[SHA256_DIGEST_SIZE*2];
+};
+
 void sha256(const void *in, unsigned long inlen, void* out);
+
+// Incremental hashing of data given in parts, sha256_process and sha256_done return 0 on success
+void sha256_init(struct sha256_state *md);
+int sha256_process(struct sha256_state *md, const unsigned char *in, unsigned long inlen);
+int sha256_done(struct sha256_state *md, unsigned char *out);
     
 #ifdef __cplusplus
 }
@@ -0,0 +1,141 @@
+/* threadpool.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "threadpool.h"
+#include "parsertrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(UINT32 numThreads) : pending(0), stopping(false)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+
+    for (UINT32 i = 0; i < numThreads; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void ThreadPool::submit(const std::function<void()> & task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks.push_back(task);
+        pending++;
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasksDone.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::workerLoop()
+{
+    traceSetThreadName("Pool worker");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+
+        task();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            pending--;
+            if (pending == 0)
+                tasksDone.notify_all();
+        }
+    }
+}
+
+// Shared between caller and helper tasks of one parallelFor call,
+// helpers started after the loop is over only touch this state and exit
+struct PARALLEL_FOR_STATE {
+    std::atomic<size_t> next;
+    size_t count;
+    std::function<void(size_t)> body;
+    std::mutex mutex;
+    std::condition_variable idle;
+    size_t active;
+};
+
+static void parallelForRun(const std::shared_ptr<PARALLEL_FOR_STATE> & state)
+{
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->active++;
+    }
+
+    for (size_t i = state->next++; i < state->count; i = state->next++)
+        state->body(i);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->active--;
+    if (state->active == 0)
+        state->idle.notify_all();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> & body)
+{
+    if (count == 0)
+        return;
+    if (count == 1 || workers.size() < 2) {
+        for (size_t i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+
+    std::shared_ptr<PARALLEL_FOR_STATE> state = std::make_shared<PARALLEL_FOR_STATE>();
+    state->next = 0;
+    state->count = count;
+    state->body = body;
+    state->active = 0;
+
+    size_t helpers = std::min(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; i++)
+        submit([state] { parallelForRun(state); });
+
+    parallelForRun(state);
+
+    // Wait only for helpers that are still running items, queued ones will find nothing to do
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->idle.wait(lock, [&state] { return state->active == 0; });
+}
+
+ThreadPool & sharedThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,59 @@
+/* threadpool.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "basetypes.h"
+
+class ThreadPool
+{
+public:
+    // Zero means one worker per hardware thread
+    explicit ThreadPool(UINT32 numThreads = 0);
+    ~ThreadPool();
+
+    UINT32 size() const { return (UINT32)workers.size(); }
+
+    // Queue a task to be run by one of the workers
+    void submit(const std::function<void()> & task);
+    // Block until every submitted task is finished
+    void wait();
+
+    // Run body(0) .. body(count - 1) on the pool and the calling thread.
+    // The caller takes part in the work, so it is safe to call from inside a pool task.
+    void parallelFor(size_t count, const std::function<void(size_t)> & body);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable tasksDone;
+    size_t pending;
+    bool stopping;
+
+    void workerLoop();
+};
+
+// One worker per hardware thread, created on first use and shared by engine code
+// that splits its own work, like tree hashing and chunking of compared images
+ThreadPool & sharedThreadPool();
+
+#endif // THREADPOOL_H
@@ -16,7 +16,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 TreeItem::TreeItem(const UINT32 offset, const UINT8 type, const UINT8 subtype,
     const UString & name, const UString & text, const UString & info,
-    const UByteArray & header, const UByteArray & body, const UByteArray & tail,
+    const UByteArray & header, UByteArray body, const UByteArray & tail,
     const bool fixed, const bool compressed,
     TreeItem *parent) :
     itemOffset(offset),
@@ -28,7 +28,7 @@ TreeItem::TreeItem(const UINT32 offset, const UINT8 type, const UINT8 subtype,
     itemText(text),
     itemInfo(info),
     itemHeader(header),
-    itemBody(body),
+    itemBody(std::move(body)),
     itemTail(tail),
     itemFixed(fixed),
     itemCompressed(compressed),
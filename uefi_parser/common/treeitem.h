@@ -25,7 +25,7 @@ class TreeItem
 {
 public:
     TreeItem(const UINT32 offset, const UINT8 type, const UINT8 subtype, const UString &name, const UString &text, const UString &info,
-        const UByteArray & header, const UByteArray & body, const UByteArray & tail,
+        const UByteArray & header, UByteArray body, const UByteArray & tail,
         const bool fixed, const bool compressed,
         TreeItem *parent = 0);
     ~TreeItem();                                                               // Non-trivial implementation in CPP file
@@ -61,12 +61,15 @@ public:
     void setText(const UString &text) { itemText = text; }
 
     UByteArray header() const { return itemHeader; }
+    const UByteArray & constHeader() const { return itemHeader; }
     bool hasEmptyHeader() const { return itemHeader.isEmpty(); }
 
     UByteArray body() const { return itemBody; };
+    const UByteArray & constBody() const { return itemBody; }
     bool hasEmptyBody() const { return itemBody.isEmpty(); }
 
     UByteArray tail() const { return itemTail; };
+    const UByteArray & constTail() const { return itemTail; }
     bool hasEmptyTail() const { return itemTail.isEmpty(); }
 
     UString info() const { return itemInfo; }
@@ -89,6 +92,11 @@ public:
     UINT8 marking() const { return itemMarking; }
     void setMarking(const UINT8 marking) { itemMarking = marking; }
 
+    UByteArray hash() const { return itemHash; }
+    const UByteArray & constHash() const { return itemHash; }
+    bool hasEmptyHash() const { return itemHash.isEmpty(); }
+    void setHash(const UByteArray & hash) { itemHash = hash; }
+
 private:
     std::list<TreeItem*> childItems;
     UINT32     itemOffset;
@@ -105,6 +113,7 @@ private:
     bool       itemFixed;
     bool       itemCompressed;
     UByteArray itemParsingData;
+    UByteArray itemHash;
     TreeItem*  parentItem;
 };
 
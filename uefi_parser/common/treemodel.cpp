@@ -12,6 +12,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 */
 
 #include "treemodel.h"
+#include "parserstats.h"
 
 #include "stack"
 
@@ -210,6 +211,15 @@ UByteArray TreeModel::header(const UModelIndex &index) const
     return item->header();
 }
 
+const UByteArray & TreeModel::constHeader(const UModelIndex &index) const
+{
+    static const UByteArray empty;
+    if (!index.isValid())
+        return empty;
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->constHeader();
+}
+
 bool TreeModel::hasEmptyHeader(const UModelIndex &index) const
 {
     if (!index.isValid())
@@ -226,6 +236,15 @@ UByteArray TreeModel::body(const UModelIndex &index) const
     return item->body();
 }
 
+const UByteArray & TreeModel::constBody(const UModelIndex &index) const
+{
+    static const UByteArray empty;
+    if (!index.isValid())
+        return empty;
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->constBody();
+}
+
 bool TreeModel::hasEmptyBody(const UModelIndex &index) const
 {
     if (!index.isValid())
@@ -242,6 +261,15 @@ UByteArray TreeModel::tail(const UModelIndex &index) const
     return item->tail();
 }
 
+const UByteArray & TreeModel::constTail(const UModelIndex &index) const
+{
+    static const UByteArray empty;
+    if (!index.isValid())
+        return empty;
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->constTail();
+}
+
 bool TreeModel::hasEmptyTail(const UModelIndex &index) const
 {
     if (!index.isValid())
@@ -303,8 +331,12 @@ void TreeModel::setFixed(const UModelIndex &index, const bool fixed)
     if (!index.isValid())
         return;
 
+    // Items are written only on change, so parsers filling distinct subtrees in parallel
+    // only read their common ancestors, that are already fixed.
+    // Compressed subtrees are excluded, their boundary item is set and reset on every call
     TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
-    item->setFixed(fixed);
+    if (item->fixed() != fixed)
+        item->setFixed(fixed);
 
     if (!item->parent())
         return;
@@ -312,7 +344,8 @@ void TreeModel::setFixed(const UModelIndex &index, const bool fixed)
     if (fixed) {
         // Special handling for uncompressed to compressed boundary
         if (item->compressed() && item->parent()->compressed() == FALSE) {
-            item->setFixed(item->parent()->fixed());
+            if (item->fixed() != item->parent()->fixed())
+                item->setFixed(item->parent()->fixed());
             return;
         }
 
@@ -460,12 +493,50 @@ void TreeModel::setParsingData(const UModelIndex &index, const UByteArray &data)
     emit dataChanged(this->index(0, 0), index);
 }
 
+UByteArray TreeModel::hash(const UModelIndex &index) const
+{
+    if (!index.isValid())
+        return UByteArray();
+
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->hash();
+}
+
+const UByteArray & TreeModel::constHash(const UModelIndex &index) const
+{
+    static const UByteArray empty;
+    if (!index.isValid())
+        return empty;
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->constHash();
+}
+
+bool TreeModel::hasEmptyHash(const UModelIndex &index) const
+{
+    if (!index.isValid())
+        return true;
+
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    return item->hasEmptyHash();
+}
+
+void TreeModel::setHash(const UModelIndex &index, const UByteArray &hash)
+{
+    if (!index.isValid())
+        return;
+
+    // Not shown in any column, so no dataChanged, hashes of different items are set from several threads
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    item->setHash(hash);
+}
+
 UModelIndex TreeModel::addItem(const UINT32 offset, const UINT8 type, const UINT8 subtype,
     const UString & name, const UString & text, const UString & info,
-    const UByteArray & header, const UByteArray & body, const UByteArray & tail,
+    const UByteArray & header, UByteArray body, const UByteArray & tail,
     const ItemFixedState fixed,
     const UModelIndex & parent, const UINT8 mode)
 {
+    STATS_ADD(StatsCounters::ItemsCreated, 1);
     TreeItem *item = 0;
     TreeItem *parentItem = 0;
     int parentColumn = 0;
@@ -485,7 +556,7 @@ UModelIndex TreeModel::addItem(const UINT32 offset, const UINT8 type, const UINT
         }
     }
 
-    TreeItem *newItem = new TreeItem(offset, type, subtype, name, text, info, header, body, tail, Movable, this->compressed(parent), parentItem);
+    TreeItem *newItem = new TreeItem(offset, type, subtype, name, text, info, header, std::move(body), tail, Movable, this->compressed(parent), parentItem);
      
     if (mode == CREATE_MODE_APPEND) {
         emit layoutAboutToBeChanged();
@@ -566,7 +637,7 @@ goDeeper:
 #endif
     
         UINT32 currentBase = this->base(currentIndex);
-        UINT32 fullSize = (UINT32)(header(currentIndex).size() + body(currentIndex).size() + tail(currentIndex).size());
+        UINT32 fullSize = (UINT32)(constHeader(currentIndex).size() + constBody(currentIndex).size() + constTail(currentIndex).size());
         if ((compressed(currentIndex) == false || (compressed(currentIndex) == true && compressed(currentIndex.parent()) == false)) // Base is meaningful only for true uncompressed items
             && currentBase <= base && base < currentBase + fullSize) { // Base must be in range [currentBase, currentBase + fullSize)
             // Found a better candidate
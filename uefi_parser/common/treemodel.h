@@ -174,21 +174,34 @@ public:
     void setMarking(const UModelIndex &index, const UINT8 marking);
 
     UByteArray header(const UModelIndex &index) const;
+    // Header without a copy, valid while the item exists
+    const UByteArray & constHeader(const UModelIndex &index) const;
     bool hasEmptyHeader(const UModelIndex &index) const;
 
     UByteArray body(const UModelIndex &index) const;
+    // Body without a copy, valid while the item exists
+    const UByteArray & constBody(const UModelIndex &index) const;
     bool hasEmptyBody(const UModelIndex &index) const;
 
     UByteArray tail(const UModelIndex &index) const;
+    // Tail without a copy, valid while the item exists
+    const UByteArray & constTail(const UModelIndex &index) const;
     bool hasEmptyTail(const UModelIndex &index) const;
 
     UByteArray parsingData(const UModelIndex &index) const;
     bool hasEmptyParsingData(const UModelIndex &index) const;
     void setParsingData(const UModelIndex &index, const UByteArray &pdata);
 
+    // Merkle hash set by FfsHash::hashTree, empty before it
+    UByteArray hash(const UModelIndex &index) const;
+    const UByteArray & constHash(const UModelIndex &index) const;
+    bool hasEmptyHash(const UModelIndex &index) const;
+    void setHash(const UModelIndex &index, const UByteArray &hash);
+
+    // Body is taken by value, so a temporary one like region.mid(...) is moved into the item without another copy
     UModelIndex addItem(const UINT32 offset, const UINT8 type, const UINT8 subtype,
         const UString & name, const UString & text, const UString & info,
-        const UByteArray & header, const UByteArray & body, const UByteArray & tail,
+        const UByteArray & header, UByteArray body, const UByteArray & tail,
         const ItemFixedState fixed,
         const UModelIndex & parent = UModelIndex(), const UINT8 mode = CREATE_MODE_APPEND);
 
@@ -15,160 +15,175 @@ WITHWARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "ffs.h"
 #include "fit.h"
 
-UString regionTypeToUString(const UINT8 type)
+const char* regionTypeToString(const UINT8 type)
 {
     switch (type) {
-    case Subtypes::DescriptorRegion:  return UString("Descriptor");
-    case Subtypes::BiosRegion:        return UString("BIOS");
-    case Subtypes::MeRegion:          return UString("ME");
-    case Subtypes::GbeRegion:         return UString("GbE");
-    case Subtypes::PdrRegion:         return UString("PDR");
-    case Subtypes::DevExp1Region:     return UString("DevExp1");
-    case Subtypes::Bios2Region:       return UString("BIOS2");
-    case Subtypes::MicrocodeRegion:   return UString("Microcode");
-    case Subtypes::EcRegion:          return UString("EC");
-    case Subtypes::DevExp2Region:     return UString("DevExp2");
-    case Subtypes::IeRegion:          return UString("IE");
-    case Subtypes::Tgbe1Region:       return UString("10GbE1");
-    case Subtypes::Tgbe2Region:       return UString("10GbE2");
-    case Subtypes::Reserved1Region:   return UString("Reserved1");
-    case Subtypes::Reserved2Region:   return UString("Reserved2");
-    case Subtypes::PttRegion:         return UString("PTT");
+    case Subtypes::DescriptorRegion:  return "Descriptor";
+    case Subtypes::BiosRegion:        return "BIOS";
+    case Subtypes::MeRegion:          return "ME";
+    case Subtypes::GbeRegion:         return "GbE";
+    case Subtypes::PdrRegion:         return "PDR";
+    case Subtypes::DevExp1Region:     return "DevExp1";
+    case Subtypes::Bios2Region:       return "BIOS2";
+    case Subtypes::MicrocodeRegion:   return "Microcode";
+    case Subtypes::EcRegion:          return "EC";
+    case Subtypes::DevExp2Region:     return "DevExp2";
+    case Subtypes::IeRegion:          return "IE";
+    case Subtypes::Tgbe1Region:       return "10GbE1";
+    case Subtypes::Tgbe2Region:       return "10GbE2";
+    case Subtypes::Reserved1Region:   return "Reserved1";
+    case Subtypes::Reserved2Region:   return "Reserved2";
+    case Subtypes::PttRegion:         return "PTT";
     };
 
-    return  UString("Unknown");
+    return "Unknown";
 }
 
-UString itemTypeToUString(const UINT8 type)
+UString regionTypeToUString(const UINT8 type)
+{
+    return UString(regionTypeToString(type));
+}
+
+const char* itemTypeToString(const UINT8 type)
 {
     switch (type) {
-    case Types::Root:           return UString("Root");
-    case Types::Image:          return UString("Image");
-    case Types::Capsule:        return UString("Capsule");
-    case Types::Region:         return UString("Region");
-    case Types::Volume:         return UString("Volume");
-    case Types::Padding:        return UString("Padding");
-    case Types::File:           return UString("File");
-    case Types::Section:        return UString("Section");
-    case Types::FreeSpace:      return UString("Free space");
-    case Types::VssStore:       return UString("VSS store");
-    case Types::Vss2Store:      return UString("VSS2 store");
-    case Types::FtwStore:       return UString("FTW store");
-    case Types::FdcStore:       return UString("FDC store");
-    case Types::FsysStore:      return UString("Fsys store");
-    case Types::EvsaStore:      return UString("EVSA store");
-    case Types::CmdbStore:      return UString("CMDB store");
-    case Types::FlashMapStore:  return UString("FlashMap store");
-    case Types::NvarEntry:      return UString("NVAR entry");
-    case Types::VssEntry:       return UString("VSS entry");
-    case Types::FsysEntry:      return UString("Fsys entry");
-    case Types::EvsaEntry:      return UString("EVSA entry");
-    case Types::FlashMapEntry:  return UString("FlashMap entry");
-    case Types::Microcode:      return UString("Microcode");
-    case Types::SlicData:       return UString("SLIC data");
+    case Types::Root:           return "Root";
+    case Types::Image:          return "Image";
+    case Types::Capsule:        return "Capsule";
+    case Types::Region:         return "Region";
+    case Types::Volume:         return "Volume";
+    case Types::Padding:        return "Padding";
+    case Types::File:           return "File";
+    case Types::Section:        return "Section";
+    case Types::FreeSpace:      return "Free space";
+    case Types::VssStore:       return "VSS store";
+    case Types::Vss2Store:      return "VSS2 store";
+    case Types::FtwStore:       return "FTW store";
+    case Types::FdcStore:       return "FDC store";
+    case Types::FsysStore:      return "Fsys store";
+    case Types::EvsaStore:      return "EVSA store";
+    case Types::CmdbStore:      return "CMDB store";
+    case Types::FlashMapStore:  return "FlashMap store";
+    case Types::NvarEntry:      return "NVAR entry";
+    case Types::VssEntry:       return "VSS entry";
+    case Types::FsysEntry:      return "Fsys entry";
+    case Types::EvsaEntry:      return "EVSA entry";
+    case Types::FlashMapEntry:  return "FlashMap entry";
+    case Types::Microcode:      return "Microcode";
+    case Types::SlicData:       return "SLIC data";
     // ME-specific
-    case Types::FptStore:       return UString("FPT store");
-    case Types::FptEntry:       return UString("FPT entry");
-    case Types::IfwiHeader:     return UString("IFWI header");
-    case Types::IfwiPartition:  return UString("IFWI partition");
-    case Types::FptPartition:   return UString("FPT partition");
-    case Types::BpdtStore:      return UString("BPDT store");
-    case Types::BpdtEntry:      return UString("BPDT entry");
-    case Types::BpdtPartition:  return UString("BPDT partition");
-    case Types::CpdStore:       return UString("CPD store");
-    case Types::CpdEntry:       return UString("CPD entry");
-    case Types::CpdPartition:   return UString("CPD partition");
-    case Types::CpdExtension:   return UString("CPD extension");
-    case Types::CpdSpiEntry:    return UString("CPD SPI entry");
+    case Types::FptStore:       return "FPT store";
+    case Types::FptEntry:       return "FPT entry";
+    case Types::IfwiHeader:     return "IFWI header";
+    case Types::IfwiPartition:  return "IFWI partition";
+    case Types::FptPartition:   return "FPT partition";
+    case Types::BpdtStore:      return "BPDT store";
+    case Types::BpdtEntry:      return "BPDT entry";
+    case Types::BpdtPartition:  return "BPDT partition";
+    case Types::CpdStore:       return "CPD store";
+    case Types::CpdEntry:       return "CPD entry";
+    case Types::CpdPartition:   return "CPD partition";
+    case Types::CpdExtension:   return "CPD extension";
+    case Types::CpdSpiEntry:    return "CPD SPI entry";
     }
 
-    return  UString("Unknown");
+    return "Unknown";
 }
 
-UString itemSubtypeToUString(const UINT8 type, const UINT8 subtype)
+UString itemTypeToUString(const UINT8 type)
+{
+    return UString(itemTypeToString(type));
+}
+
+const char* itemSubtypeToString(const UINT8 type, const UINT8 subtype)
 {
     switch (type) {
     case Types::Image:
-        if (subtype == Subtypes::IntelImage)               return UString("Intel");
-        if (subtype == Subtypes::UefiImage)                return UString("UEFI");
+        if (subtype == Subtypes::IntelImage)               return "Intel";
+        if (subtype == Subtypes::UefiImage)                return "UEFI";
         break;
     case Types::Padding:
-        if (subtype == Subtypes::ZeroPadding)              return UString("Empty (0x00)");
-        if (subtype == Subtypes::OnePadding)               return UString("Empty (0xFF)");
-        if (subtype == Subtypes::DataPadding)              return UString("Non-empty");
+        if (subtype == Subtypes::ZeroPadding)              return "Empty (0x00)";
+        if (subtype == Subtypes::OnePadding)               return "Empty (0xFF)";
+        if (subtype == Subtypes::DataPadding)              return "Non-empty";
         break;
     case Types::Volume:
-        if (subtype == Subtypes::UnknownVolume)            return UString("Unknown");
-        if (subtype == Subtypes::Ffs2Volume)               return UString("FFSv2");
-        if (subtype == Subtypes::Ffs3Volume)               return UString("FFSv3");
-        if (subtype == Subtypes::NvramVolume)              return UString("NVRAM");
-        if (subtype == Subtypes::MicrocodeVolume)          return UString("Microcode");
+        if (subtype == Subtypes::UnknownVolume)            return "Unknown";
+        if (subtype == Subtypes::Ffs2Volume)               return "FFSv2";
+        if (subtype == Subtypes::Ffs3Volume)               return "FFSv3";
+        if (subtype == Subtypes::NvramVolume)              return "NVRAM";
+        if (subtype == Subtypes::MicrocodeVolume)          return "Microcode";
         break;
     case Types::Capsule:
-        if (subtype == Subtypes::AptioSignedCapsule)       return UString("Aptio signed");
-        if (subtype == Subtypes::AptioUnsignedCapsule)     return UString("Aptio unsigned");
-        if (subtype == Subtypes::UefiCapsule)              return UString("UEFI 2.0");
-        if (subtype == Subtypes::ToshibaCapsule)           return UString("Toshiba");
+        if (subtype == Subtypes::AptioSignedCapsule)       return "Aptio signed";
+        if (subtype == Subtypes::AptioUnsignedCapsule)     return "Aptio unsigned";
+        if (subtype == Subtypes::UefiCapsule)              return "UEFI 2.0";
+        if (subtype == Subtypes::ToshibaCapsule)           return "Toshiba";
         break;
-    case Types::Region:                                    return regionTypeToUString(subtype);
-    case Types::File:                                      return fileTypeToUString(subtype);
-    case Types::Section:                                   return sectionTypeToUString(subtype);
+    case Types::Region:                                    return regionTypeToString(subtype);
+    case Types::File:                                      return fileTypeToString(subtype);
+    case Types::Section:                                   return sectionTypeToString(subtype);
     case Types::NvarEntry:
-        if (subtype == Subtypes::InvalidNvarEntry)         return UString("Invalid");
-        if (subtype == Subtypes::InvalidLinkNvarEntry)     return UString("Invalid link");
-        if (subtype == Subtypes::LinkNvarEntry)            return UString("Link");
-        if (subtype == Subtypes::DataNvarEntry)            return UString("Data");
-        if (subtype == Subtypes::FullNvarEntry)            return UString("Full");
+        if (subtype == Subtypes::InvalidNvarEntry)         return "Invalid";
+        if (subtype == Subtypes::InvalidLinkNvarEntry)     return "Invalid link";
+        if (subtype == Subtypes::LinkNvarEntry)            return "Link";
+        if (subtype == Subtypes::DataNvarEntry)            return "Data";
+        if (subtype == Subtypes::FullNvarEntry)            return "Full";
         break;
     case Types::VssEntry:
-        if (subtype == Subtypes::InvalidVssEntry)          return UString("Invalid");
-        if (subtype == Subtypes::StandardVssEntry)         return UString("Standard");
-        if (subtype == Subtypes::AppleVssEntry)            return UString("Apple");
-        if (subtype == Subtypes::AuthVssEntry)             return UString("Auth");
-        if (subtype == Subtypes::IntelVssEntry)            return UString("Intel");
+        if (subtype == Subtypes::InvalidVssEntry)          return "Invalid";
+        if (subtype == Subtypes::StandardVssEntry)         return "Standard";
+        if (subtype == Subtypes::AppleVssEntry)            return "Apple";
+        if (subtype == Subtypes::AuthVssEntry)             return "Auth";
+        if (subtype == Subtypes::IntelVssEntry)            return "Intel";
         break;
     case Types::FsysEntry:
-        if (subtype == Subtypes::InvalidFsysEntry)         return UString("Invalid");
-        if (subtype == Subtypes::NormalFsysEntry)          return UString("Normal");
+        if (subtype == Subtypes::InvalidFsysEntry)         return "Invalid";
+        if (subtype == Subtypes::NormalFsysEntry)          return "Normal";
         break;
     case Types::EvsaEntry:
-        if (subtype == Subtypes::InvalidEvsaEntry)         return UString("Invalid");
-        if (subtype == Subtypes::UnknownEvsaEntry)         return UString("Unknown");
-        if (subtype == Subtypes::GuidEvsaEntry)            return UString("GUID");
-        if (subtype == Subtypes::NameEvsaEntry)            return UString("Name");
-        if (subtype == Subtypes::DataEvsaEntry)            return UString("Data");
+        if (subtype == Subtypes::InvalidEvsaEntry)         return "Invalid";
+        if (subtype == Subtypes::UnknownEvsaEntry)         return "Unknown";
+        if (subtype == Subtypes::GuidEvsaEntry)            return "GUID";
+        if (subtype == Subtypes::NameEvsaEntry)            return "Name";
+        if (subtype == Subtypes::DataEvsaEntry)            return "Data";
         break;
     case Types::FlashMapEntry:
-        if (subtype == Subtypes::VolumeFlashMapEntry)      return UString("Volume");
-        if (subtype == Subtypes::DataFlashMapEntry)        return UString("Data");
+        if (subtype == Subtypes::VolumeFlashMapEntry)      return "Volume";
+        if (subtype == Subtypes::DataFlashMapEntry)        return "Data";
         break;
     case Types::Microcode:
-        if (subtype == Subtypes::IntelMicrocode)           return UString("Intel");
-        if (subtype == Subtypes::AmdMicrocode)             return UString("AMD");
+        if (subtype == Subtypes::IntelMicrocode)           return "Intel";
+        if (subtype == Subtypes::AmdMicrocode)             return "AMD";
         break;
     // ME-specific
     case Types::FptEntry:
-        if (subtype == Subtypes::ValidFptEntry)            return UString("Valid");
-        if (subtype == Subtypes::InvalidFptEntry)          return UString("Invalid");
+        if (subtype == Subtypes::ValidFptEntry)            return "Valid";
+        if (subtype == Subtypes::InvalidFptEntry)          return "Invalid";
         break;
     case Types::FptPartition:
-        if (subtype == Subtypes::CodeFptPartition)         return UString("Code");
-        if (subtype == Subtypes::DataFptPartition)         return UString("Data");
-        if (subtype == Subtypes::GlutFptPartition)         return UString("GLUT");
+        if (subtype == Subtypes::CodeFptPartition)         return "Code";
+        if (subtype == Subtypes::DataFptPartition)         return "Data";
+        if (subtype == Subtypes::GlutFptPartition)         return "GLUT";
         break;
     case Types::IfwiPartition:
-        if (subtype == Subtypes::BootIfwiPartition)         return UString("Boot");
-        if (subtype == Subtypes::DataIfwiPartition)         return UString("Data");
+        if (subtype == Subtypes::BootIfwiPartition)         return "Boot";
+        if (subtype == Subtypes::DataIfwiPartition)         return "Data";
         break;
     case Types::CpdPartition:
-        if (subtype == Subtypes::ManifestCpdPartition)         return UString("Manifest");
-        if (subtype == Subtypes::MetadataCpdPartition)         return UString("Metadata");
-        if (subtype == Subtypes::KeyCpdPartition)              return UString("Key");
-        if (subtype == Subtypes::CodeCpdPartition)             return UString("Code");
+        if (subtype == Subtypes::ManifestCpdPartition)         return "Manifest";
+        if (subtype == Subtypes::MetadataCpdPartition)         return "Metadata";
+        if (subtype == Subtypes::KeyCpdPartition)              return "Key";
+        if (subtype == Subtypes::CodeCpdPartition)             return "Code";
         break;
     }
 
-    return UString();
+    return "";
+}
+
+UString itemSubtypeToUString(const UINT8 type, const UINT8 subtype)
+{
+    return UString(itemSubtypeToString(type, subtype));
 }
 
 UString compressionTypeToUString(const UINT8 algorithm)
@@ -198,4 +198,9 @@ extern UString compressionTypeToUString(const UINT8 algorithm);
 extern UString regionTypeToUString(const UINT8 type);
 extern UString fitEntryTypeToUString(const UINT8 type);
 
+// Same names as static strings, every call for the same type returns the same pointer
+extern const char* itemTypeToString(const UINT8 type);
+extern const char* itemSubtypeToString(const UINT8 type, const UINT8 subtype);
+extern const char* regionTypeToString(const UINT8 type);
+
 #endif // TYPES_H
@@ -29,6 +29,7 @@ class UByteArray
 public:
     UByteArray() : d() {}
     UByteArray(const UByteArray & ba) : d(ba.d) {}
+    UByteArray(UByteArray && ba) : d(std::move(ba.d)) {}
     UByteArray(const std::basic_string<char> & bs) : d(bs) {}
     UByteArray(const std::vector<char> & bc) : d(bc.data(), bc.size()) {}
     UByteArray(const char* bytes, int32_t size) : d(bytes, size) {}
@@ -68,6 +69,7 @@ public:
     UByteArray mid(int32_t pos, int32_t len = -1) const { return d.substr(pos, len); }
 
     UByteArray & operator=(const UByteArray & ba) { d = ba.d; return *this; }
+    UByteArray & operator=(UByteArray && ba) { d = std::move(ba.d); return *this; }
     UByteArray & operator+=(const UByteArray & ba) { d += ba.d; return *this; }
     bool operator== (const UByteArray & ba) const { return d == ba.d; }
     bool operator!= (const UByteArray & ba) const { return d != ba.d; }
@@ -0,0 +1,131 @@
+/* utf16.cpp
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "utf16.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF16_USE_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+static inline UINT32 codeUnit(const UINT8* bytes, const UINT32 index)
+{
+    return (UINT32)bytes[2 * index] | ((UINT32)bytes[2 * index + 1] << 8);
+}
+
+#ifdef UTF16_USE_SSE2
+static inline UINT32 lowestSetBit(const UINT32 mask)
+{
+#if defined(_MSC_VER)
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return (UINT32)bit;
+#else
+    return (UINT32)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+UINT32 utf16Length(const void* data, const UINT32 maxUnits)
+{
+    const UINT8* bytes = (const UINT8*)data;
+    UINT32 i = 0;
+#ifdef UTF16_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= maxUnits; i += 8) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(bytes + 2 * i));
+        UINT32 mask = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi16(block, zero));
+        if (mask) // Two mask bits per code unit
+            return i + lowestSetBit(mask) / 2;
+    }
+#endif
+    for (; i < maxUnits; i++) {
+        if (!bytes[2 * i] && !bytes[2 * i + 1])
+            break;
+    }
+    return i;
+}
+
+void utf16ToUtf8(const void* data, const UINT32 units, std::string & output)
+{
+    const UINT8* bytes = (const UINT8*)data;
+    size_t start = output.size();
+    // Every code unit takes at most 3 bytes, a surrogate pair takes 4 bytes for 2 units
+    output.resize(start + (size_t)units * 3);
+    char* out = &output[0] + start;
+
+    UINT32 i = 0;
+    while (i < units) {
+        UINT32 end = units;
+#ifdef UTF16_USE_SSE2
+        if (i + 8 <= units) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(bytes + 2 * i));
+            __m128i nonAscii = _mm_and_si128(block, _mm_set1_epi16((short)0xFF80));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) == 0xFFFF) {
+                _mm_storel_epi64((__m128i*)out, _mm_packus_epi16(block, block));
+                out += 8;
+                i += 8;
+                continue;
+            }
+            // Block with other characters is converted one code unit at a time
+            end = i + 8;
+        }
+#endif
+        while (i < end) {
+            UINT32 codePoint = codeUnit(bytes, i++);
+            if (codePoint >= 0xD800 && codePoint < 0xE000) {
+                UINT32 next = i < units ? codeUnit(bytes, i) : 0;
+                if (codePoint < 0xDC00 && next >= 0xDC00 && next < 0xE000) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (next - 0xDC00);
+                    i++;
+                }
+                else { // Unpaired surrogate
+                    codePoint = 0xFFFD;
+                }
+            }
+
+            if (codePoint < 0x80) {
+                *out++ = (char)codePoint;
+            }
+            else if (codePoint < 0x800) {
+                *out++ = (char)(0xC0 | (codePoint >> 6));
+                *out++ = (char)(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000) {
+                *out++ = (char)(0xE0 | (codePoint >> 12));
+                *out++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (codePoint & 0x3F));
+            }
+            else {
+                *out++ = (char)(0xF0 | (codePoint >> 18));
+                *out++ = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+                *out++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (codePoint & 0x3F));
+            }
+        }
+    }
+    output.resize(out - output.data());
+}
+
+UString uFromUtf16(const void* data, const UINT32 size)
+{
+    std::string text;
+    utf16ToUtf8(data, utf16Length(data, size / 2), text);
+#if defined(QT_CORE_LIB)
+    return QString::fromUtf8(text.data(), (int)text.size());
+#else
+    return UString(text.data(), (int)text.size());
+#endif
+}
@@ -0,0 +1,34 @@
+/* utf16.h
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef UTF16_H
+#define UTF16_H
+
+#include <string>
+
+#include "basetypes.h"
+#include "ustring.h"
+
+// UCS-2 strings of variable names and UI sections are little endian UTF-16 that may be unaligned
+// and is not always terminated, so every function takes the number of code units available.
+// Blocks of 8 code units are processed with SSE2 where it is available.
+
+// Number of code units before the first zero one, maxUnits if there is none
+UINT32 utf16Length(const void* data, const UINT32 maxUnits);
+
+// Appends UTF-8 form of units code units, unpaired surrogates become U+FFFD
+void utf16ToUtf8(const void* data, const UINT32 units, std::string & output);
+
+// Text of a string stored in at most size bytes, up to its terminator
+UString uFromUtf16(const void* data, const UINT32 size);
+
+#endif // UTF16_H
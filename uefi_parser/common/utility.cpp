@@ -18,6 +18,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "treemodel.h"
 #include "utility.h"
 #include "ffs.h"
+#include "parserstats.h"
+#include "allocstats.h"
+#include "parsertrace.h"
 #include "Tiano/EfiTianoCompress.h"
 #include "Tiano/EfiTianoDecompress.h"
 #include "LZMA/LzmaCompress.h"
@@ -113,6 +116,19 @@ UString uniqueItemName(const UModelIndex & index)
     return name;
 }
 
+// Returns names of tree item and all its parents separated by /
+UString itemPath(const UModelIndex & index)
+{
+    if (!index.isValid())
+        return UString();
+
+    const TreeModel* model = (const TreeModel*)index.model();
+    UString path = model->name(index);
+    for (UModelIndex parent = model->parent(index); parent.isValid(); parent = model->parent(parent))
+        path = model->name(parent) + UString("/") + path;
+    return path;
+}
+
 // Makes the name usable as a file name
 void fixFileName(UString &name, bool replaceSpaces)
 {
@@ -204,6 +220,7 @@ UString errorCodeToUString(USTATUS errorCode)
 // Compression routines
 USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionType, UINT8 & algorithm, UINT32 & dictionarySize, UByteArray & decompressedData, UByteArray & efiDecompressedData)
 {
+    TRACE_SCOPE("decompress", UString(), compressedData.size());
     const UINT8* data;
     UINT32 dataSize;
     UINT8* decompressed;
@@ -224,6 +241,7 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
         return U_SUCCESS;
         }
     case EFI_STANDARD_COMPRESSION: {
+        STATS_SCOPE(StatsTimers::DecompressEfi);
         // Set default algorithm to unknown
         algorithm = COMPRESSION_ALGORITHM_UNKNOWN;
 
@@ -241,13 +259,13 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
             return U_STANDARD_DECOMPRESSION_FAILED;
 
         // Allocate memory
-        decompressed = (UINT8*)malloc(decompressedSize);
-        efiDecompressed = (UINT8*)malloc(decompressedSize);
-        scratch = (UINT8*)malloc(scratchSize);
+        decompressed = (UINT8*)STATS_MALLOC(decompressedSize);
+        efiDecompressed = (UINT8*)STATS_MALLOC(decompressedSize);
+        scratch = (UINT8*)STATS_MALLOC(scratchSize);
         if (!decompressed || !efiDecompressed || !scratch) {
-            free(decompressed);
-            free(efiDecompressed);
-            free(scratch);
+            STATS_FREE(decompressed);
+            STATS_FREE(efiDecompressed);
+            STATS_FREE(scratch);
             return U_STANDARD_DECOMPRESSION_FAILED;
         }
 
@@ -277,13 +295,16 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
         else { // Both decompressions failed
             result = U_STANDARD_DECOMPRESSION_FAILED;
         }
+        if (result == U_SUCCESS)
+            STATS_ADD(StatsCounters::BytesDecompressedEfi, decompressedSize);
 
-        free(decompressed);
-        free(efiDecompressed);
-        free(scratch);
+        STATS_FREE(decompressed);
+        STATS_FREE(efiDecompressed);
+        STATS_FREE(scratch);
         return result;
         }
     case EFI_CUSTOMIZED_COMPRESSION: {
+        STATS_SCOPE(StatsTimers::DecompressLzma);
         // Set default algorithm to unknown
         algorithm = COMPRESSION_ALGORITHM_UNKNOWN;
 
@@ -307,28 +328,30 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
         }
 
         // Allocate memory
-        decompressed = (UINT8*)malloc(decompressedSize);
+        decompressed = (UINT8*)STATS_MALLOC(decompressedSize);
         if (!decompressed) {
             return U_OUT_OF_MEMORY;
         }
 
         // Decompress section data
         if (U_SUCCESS != LzmaDecompress(data, dataSize, decompressed)) {
-            free(decompressed);
+            STATS_FREE(decompressed);
             return U_CUSTOMIZED_DECOMPRESSION_FAILED;
         }
 
         if (decompressedSize > INT32_MAX) {
-            free(decompressed);
+            STATS_FREE(decompressed);
             return U_CUSTOMIZED_DECOMPRESSION_FAILED;
         }
 
         dictionarySize = readUnaligned((UINT32*)(data + 1)); // LZMA dictionary size is stored in bytes 1-4 of LZMA properties header
         decompressedData = UByteArray((const char*)decompressed, (int)decompressedSize);
-        free(decompressed);
+        STATS_FREE(decompressed);
+        STATS_ADD(StatsCounters::BytesDecompressedLzma, decompressedSize);
         return U_SUCCESS;
         }
     case EFI_CUSTOMIZED_COMPRESSION_LZMAF86: {
+        STATS_SCOPE(StatsTimers::DecompressLzmaF86);
         // Set default algorithm to unknown
         algorithm = COMPRESSION_ALGORITHM_UNKNOWN;
 
@@ -343,19 +366,19 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
         algorithm = COMPRESSION_ALGORITHM_LZMAF86;
 
         // Allocate memory
-        decompressed = (UINT8*)malloc(decompressedSize);
+        decompressed = (UINT8*)STATS_MALLOC(decompressedSize);
         if (!decompressed) {
             return U_OUT_OF_MEMORY;
         }
 
         // Decompress section data
         if (U_SUCCESS != LzmaDecompress(data, dataSize, decompressed)) {
-            free(decompressed);
+            STATS_FREE(decompressed);
             return U_CUSTOMIZED_DECOMPRESSION_FAILED;
         }
 
         if (decompressedSize > INT32_MAX) {
-            free(decompressed);
+            STATS_FREE(decompressed);
             return U_CUSTOMIZED_DECOMPRESSION_FAILED;
         }
 
@@ -363,13 +386,14 @@ USTATUS decompress(const UByteArray & compressedData, const UINT8 compressionTyp
         UINT32 state = 0;
         const UINT8 x86LookAhead = 4;
         if (decompressedSize != x86LookAhead + x86_Convert(decompressed, decompressedSize, 0, &state, 0)) {
-            free(decompressed);
+            STATS_FREE(decompressed);
             return U_CUSTOMIZED_DECOMPRESSION_FAILED;
         }
 
         dictionarySize = readUnaligned((UINT32*)(data + 1)); // LZMA dictionary size is stored in bytes 1-4 of LZMA properties header
         decompressedData = UByteArray((const char*)decompressed, (int)decompressedSize);
-        free(decompressed);
+        STATS_FREE(decompressed);
+        STATS_ADD(StatsCounters::BytesDecompressedLzmaF86, decompressedSize);
         return U_SUCCESS;
         }
     default: {
@@ -440,6 +464,26 @@ UINT32 calculateChecksum32(const UINT32* buffer, UINT32 bufferSize)
     return (UINT32)(0x100000000ULL - counter);
 }
 
+// 64bit fingerprint calculation routine, four independent lanes,
+// so multiplications of neighbouring words overlap
+UINT64 dataFingerprint(const UINT8* data, UINT64 size)
+{
+    UINT64 lanes[4] = { size, 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL };
+    UINT64 i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int j = 0; j < 4; j++) {
+            UINT64 word;
+            memcpy(&word, data + i + j * 8, sizeof(word));
+            lanes[j] = (lanes[j] ^ word) * 0xFF51AFD7ED558CCDULL;
+            lanes[j] ^= lanes[j] >> 32;
+        }
+    }
+    UINT64 hash = lanes[0] ^ (lanes[1] * 0xC4CEB9FE1A85EC53ULL) ^ (lanes[2] >> 7) ^ (lanes[3] * 0x9E3779B97F4A7C15ULL);
+    for (; i < size; i++)
+        hash = (hash ^ data[i]) * 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 29);
+}
+
 // Get padding type for a given padding
 UINT8 getPaddingType(const UByteArray & padding)
 {
@@ -520,6 +564,7 @@ BOOLEAN makePattern(const CHAR8 *textPattern, std::vector<UINT8> &pattern, std::
 
 USTATUS gzipDecompress(const UByteArray & input, UByteArray & output)
 {
+    STATS_SCOPE(StatsTimers::DecompressGzip);
     output.clear();
 
     if (input.size() == 0)
@@ -548,5 +593,8 @@ USTATUS gzipDecompress(const UByteArray & input, UByteArray & output)
     }
 
     inflateEnd(&stream);
-    return ret == Z_STREAM_END ? U_SUCCESS : U_GZIP_DECOMPRESSION_FAILED;
+    if (ret != Z_STREAM_END)
+        return U_GZIP_DECOMPRESSION_FAILED;
+    STATS_ADD(StatsCounters::BytesDecompressedGzip, output.size());
+    return U_SUCCESS;
 }
@@ -29,6 +29,9 @@ UString visibleAsciiOrHex(UINT8* bytes, UINT32 length);
 // Returns unique name for tree item
 UString uniqueItemName(const UModelIndex & index);
 
+// Returns names of tree item and all its parents separated by /
+UString itemPath(const UModelIndex & index);
+
 // Makes the name usable as a file name
 void fixFileName(UString &name, bool replaceSpaces);
 
@@ -53,6 +56,9 @@ UINT16 calculateChecksum16(const UINT16* buffer, UINT32 bufferSize);
 // 32bit checksum calculation routine
 UINT32 calculateChecksum32(const UINT32* buffer, UINT32 bufferSize);
 
+// 64bit fingerprint of data, not cryptographic, equal fingerprints must be confirmed by comparing the data
+UINT64 dataFingerprint(const UINT8* data, UINT64 size);
+
 // Return padding type from it's contents
 UINT8 getPaddingType(const UByteArray & padding);
 
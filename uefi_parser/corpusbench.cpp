@@ -0,0 +1,380 @@
+#include "corpusbench.h"
+#include "batchparser.h"
+#include "imageinfo.h"
+#include "utilities.h"
+#include "common/filesystem.h"
+#include "common/utility.h"
+
+#include "nlohmann/json.hpp"
+using ordered_json = nlohmann::ordered_json;
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#ifdef WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+static const char* corpusPhaseNames[CorpusPhases::Count] = { "loadMs", "parseMs", "reportWriteMs", "reportReadMs", "outputMs" };
+
+static UINT64 peakRss()
+{
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (UINT64)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (UINT64)usage.ru_maxrss;
+#else
+    return (UINT64)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Nearest-rank percentile, values are sorted in place
+static double percentile(std::vector<double>& values, double fraction)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(fraction * values.size());
+    return values[rank ? rank - 1 : 0];
+}
+
+static double median(std::vector<double> values)
+{
+    return percentile(values, 0.5);
+}
+
+static double millisecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+CorpusBenchmark::CorpusBenchmark(const std::string& reportDir, UINT16 mode, UINT32 repeat)
+    : reportStore(UString(reportDir.c_str())), outputMode(mode), repeatCount(repeat)
+{
+};
+
+USTATUS CorpusBenchmark::collectInputs(const std::string& source)
+{
+    return collectImagePaths(source, inputs);
+}
+
+// Same calls as the single image mode of the CLI, console log goes nowhere,
+// info output goes to memory so its formatting is still measured
+void CorpusBenchmark::runImage(CORPUS_IMAGE_RESULT& result, bool timed)
+{
+    double phaseMs[CorpusPhases::Count];
+    std::ostream nullStream(NULL);
+
+    // Cold run
+    auto start = std::chrono::steady_clock::now();
+    auto phaseStart = start;
+    UByteArray buffer;
+    result.status = readFileIntoBuffer(UString(result.path.c_str()), buffer);
+    if (result.status)
+        return;
+    phaseMs[CorpusPhases::Load] = millisecondsSince(phaseStart);
+    result.size = buffer.size();
+
+    phaseStart = std::chrono::steady_clock::now();
+    ImageInfo imageInfo(buffer);
+    imageInfo.setLogStream(nullStream);
+    double crcMs = millisecondsSince(phaseStart);
+    // Report of the previous run is dropped, it is not a part of the measured pipeline
+    reportStore.invalidate(imageInfo.getCrc());
+
+    phaseStart = std::chrono::steady_clock::now();
+    if (!imageInfo.readFromFile(reportStore))
+        result.status = imageInfo.explore();
+    phaseMs[CorpusPhases::Parse] = crcMs + millisecondsSince(phaseStart);
+
+    // Failed parse is not stored, as in batch mode
+    phaseStart = std::chrono::steady_clock::now();
+    if (result.status == U_SUCCESS)
+        imageInfo.writeToFile(reportStore);
+    phaseMs[CorpusPhases::ReportWrite] = millisecondsSince(phaseStart);
+
+    phaseStart = std::chrono::steady_clock::now();
+    std::ostringstream output;
+    imageInfo.infoOutput(output, outputMode);
+    phaseMs[CorpusPhases::Output] = millisecondsSince(phaseStart);
+    double coldMs = phaseMs[CorpusPhases::Load] + phaseMs[CorpusPhases::Parse] + phaseMs[CorpusPhases::ReportWrite] + phaseMs[CorpusPhases::Output];
+
+    // Cached run
+    start = std::chrono::steady_clock::now();
+    UByteArray cachedBuffer;
+    readFileIntoBuffer(UString(result.path.c_str()), cachedBuffer);
+    ImageInfo cachedInfo(cachedBuffer);
+    cachedInfo.setLogStream(nullStream);
+    phaseStart = std::chrono::steady_clock::now();
+    if (!cachedInfo.readFromFile(reportStore))
+        cachedInfo.explore();
+    phaseMs[CorpusPhases::ReportRead] = millisecondsSince(phaseStart);
+    std::ostringstream cachedOutput;
+    cachedInfo.infoOutput(cachedOutput, outputMode);
+    double cachedMs = millisecondsSince(start);
+
+    if (!timed)
+        return;
+    result.coldMs.push_back(coldMs);
+    result.cachedMs.push_back(cachedMs);
+    for (int i = 0; i < CorpusPhases::Count; i++)
+        result.phaseMs[i].push_back(phaseMs[i]);
+}
+
+USTATUS CorpusBenchmark::run()
+{
+    results.clear();
+    results.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        CORPUS_IMAGE_RESULT& result = results[i];
+        result.path = inputs[i];
+        result.size = 0;
+
+        // Warm-up, GUID database, page cache and report directory
+        runImage(result, false);
+        for (UINT32 r = 0; r < repeatCount && result.status == U_SUCCESS; r++)
+            runImage(result, true);
+        result.peakRssBytes = peakRss();
+    }
+
+    reportStore.flush();
+    return U_SUCCESS;
+}
+
+CORPUS_AGGREGATE CorpusBenchmark::aggregate() const
+{
+    CORPUS_AGGREGATE total = {};
+    std::vector<double> cold, cached;
+    double coldTotalMs = 0.0;
+    UINT64 coldBytes = 0;
+    for (const CORPUS_IMAGE_RESULT& result : results)
+    {
+        total.images++;
+        if (result.status != U_SUCCESS)
+            total.failed++;
+        total.bytes += result.size;
+        total.runs += result.coldMs.size();
+        for (double ms : result.coldMs)
+        {
+            cold.push_back(ms);
+            coldTotalMs += ms;
+            coldBytes += result.size;
+        }
+        cached.insert(cached.end(), result.cachedMs.begin(), result.cachedMs.end());
+    }
+    total.imagesPerSecond = coldTotalMs > 0 ? total.runs * 1000.0 / coldTotalMs : 0.0;
+    total.megabytesPerSecond = coldTotalMs > 0 ? coldBytes / (1024.0 * 1024.0) * 1000.0 / coldTotalMs : 0.0;
+    total.p50Ms = percentile(cold, 0.5);
+    total.p99Ms = percentile(cold, 0.99);
+    total.cachedP50Ms = percentile(cached, 0.5);
+    total.cachedP99Ms = percentile(cached, 0.99);
+    total.peakRssBytes = peakRss();
+    return total;
+}
+
+static std::string formatMs(double ms)
+{
+    std::stringstream text;
+    text << std::fixed << std::setprecision(3) << ms;
+    return text.str();
+}
+
+void CorpusBenchmark::resultsOutput(std::ostream& outputStream) const
+{
+    VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+        tableImages({ "Image", "Status", "Size", "Median ms", "p99 ms", "MB/s", "Parse ms", "Cached ms", "Peak RSS MB" });
+    for (const CORPUS_IMAGE_RESULT& result : results)
+    {
+        std::vector<double> cold = result.coldMs;
+        double medianMs = median(cold);
+        std::stringstream rate, rss;
+        rate << std::fixed << std::setprecision(1) << (medianMs > 0 ? result.size / (1024.0 * 1024.0) * 1000.0 / medianMs : 0.0);
+        rss << std::fixed << std::setprecision(1) << result.peakRssBytes / (1024.0 * 1024.0);
+        tableImages.addRow(
+            result.path,
+            std::string(errorCodeToUString(result.status).toLocal8Bit()),
+            std::to_string(result.size),
+            formatMs(medianMs),
+            formatMs(percentile(cold, 0.99)),
+            rate.str(),
+            formatMs(median(result.phaseMs[CorpusPhases::Parse])),
+            formatMs(median(result.cachedMs)),
+            rss.str()
+        );
+    }
+    tableImages.print(outputStream, "Corpus benchmark");
+
+    CORPUS_AGGREGATE total = aggregate();
+    std::ios_base::fmtflags basic_flags(outputStream.flags());
+    outputStream << "Images: " << total.images << ", failed: " << total.failed << ", runs: " << total.runs << std::endl;
+    outputStream << std::fixed << std::setprecision(1)
+        << total.imagesPerSecond << " images/s, " << total.megabytesPerSecond << " MB/s, peak RSS "
+        << total.peakRssBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    outputStream << std::setprecision(3)
+        << "Latency p50 " << total.p50Ms << " ms, p99 " << total.p99Ms << " ms, cached p50 "
+        << total.cachedP50Ms << " ms, p99 " << total.cachedP99Ms << " ms" << std::endl;
+    outputStream.flags(basic_flags);
+}
+
+bool CorpusBenchmark::writeResults(const std::string& path) const
+{
+    CORPUS_AGGREGATE total = aggregate();
+    ordered_json resultsObj;
+    resultsObj["version"] = CORPUS_RESULTS_VERSION;
+    resultsObj["benchmark"] = "corpus";
+    resultsObj["outputMode"] = outputMode;
+    resultsObj["repeat"] = repeatCount;
+
+    ordered_json totalsObj;
+    totalsObj["images"] = total.images;
+    totalsObj["failed"] = total.failed;
+    totalsObj["runs"] = total.runs;
+    totalsObj["bytes"] = total.bytes;
+    totalsObj["imagesPerSecond"] = total.imagesPerSecond;
+    totalsObj["megabytesPerSecond"] = total.megabytesPerSecond;
+    totalsObj["p50Ms"] = total.p50Ms;
+    totalsObj["p99Ms"] = total.p99Ms;
+    totalsObj["cachedP50Ms"] = total.cachedP50Ms;
+    totalsObj["cachedP99Ms"] = total.cachedP99Ms;
+    totalsObj["peakRssBytes"] = total.peakRssBytes;
+    resultsObj["totals"] = totalsObj;
+
+    ordered_json imagesArr = ordered_json::array();
+    for (const CORPUS_IMAGE_RESULT& result : results)
+    {
+        std::vector<double> cold = result.coldMs;
+        ordered_json imageObj;
+        imageObj["path"] = result.path;
+        imageObj["status"] = std::string(errorCodeToUString(result.status).toLocal8Bit());
+        imageObj["size"] = result.size;
+        imageObj["medianMs"] = median(cold);
+        imageObj["minMs"] = cold.empty() ? 0.0 : *std::min_element(cold.begin(), cold.end());
+        imageObj["p99Ms"] = percentile(cold, 0.99);
+        imageObj["cachedMedianMs"] = median(result.cachedMs);
+        ordered_json phasesObj;
+        for (int i = 0; i < CorpusPhases::Count; i++)
+            phasesObj[corpusPhaseNames[i]] = median(result.phaseMs[i]);
+        imageObj["phases"] = phasesObj;
+        imageObj["peakRssBytes"] = result.peakRssBytes;
+        imagesArr.push_back(imageObj);
+    }
+    resultsObj["images"] = imagesArr;
+
+    std::ofstream outputFile(path, std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return false;
+    outputFile << std::setw(4) << resultsObj << std::endl;
+    return (bool)outputFile;
+}
+
+bool CorpusBenchmark::compareWithBaseline(const std::string& baselinePath, double thresholdPercent, std::ostream& outputStream) const
+{
+    ordered_json baselineObj;
+    CORPUS_AGGREGATE baselineTotal = {};
+    // Images are matched by path, images missing in one of the runs are not compared
+    std::map<std::string, double> baselineMedians;
+    try
+    {
+        std::ifstream inputFile(baselinePath, std::ios::in);
+        if (!inputFile)
+        {
+            outputStream << "Error of reading baseline \"" << baselinePath << "\"." << std::endl;
+            return false;
+        }
+        inputFile >> baselineObj;
+        if (baselineObj.value("version", 0) != CORPUS_RESULTS_VERSION || baselineObj.value("benchmark", std::string()) != "corpus")
+        {
+            outputStream << "Error of reading baseline \"" << baselinePath << "\", results of another benchmark or version." << std::endl;
+            return false;
+        }
+        if (!baselineObj.contains("totals") || !baselineObj["totals"].is_object()
+            || !baselineObj.contains("images") || !baselineObj["images"].is_array())
+        {
+            outputStream << "Error of reading baseline \"" << baselinePath << "\", invalid results." << std::endl;
+            return false;
+        }
+
+        // Mistyped fields throw here and are reported as invalid baseline
+        const ordered_json& baselineTotals = baselineObj["totals"];
+        baselineTotal.megabytesPerSecond = baselineTotals.value("megabytesPerSecond", 0.0);
+        baselineTotal.p50Ms = baselineTotals.value("p50Ms", 0.0);
+        baselineTotal.p99Ms = baselineTotals.value("p99Ms", 0.0);
+        baselineTotal.cachedP50Ms = baselineTotals.value("cachedP50Ms", 0.0);
+        baselineTotal.cachedP99Ms = baselineTotals.value("cachedP99Ms", 0.0);
+        baselineTotal.peakRssBytes = baselineTotals.value("peakRssBytes", (UINT64)0);
+        for (const ordered_json& imageObj : baselineObj["images"])
+        {
+            if (!imageObj.is_object())
+            {
+                outputStream << "Error of reading baseline \"" << baselinePath << "\", invalid results." << std::endl;
+                return false;
+            }
+            baselineMedians[imageObj.value("path", std::string())] = imageObj.value("medianMs", 0.0);
+        }
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        outputStream << "Error of reading baseline \"" << baselinePath << "\", invalid results." << std::endl;
+        return false;
+    }
+
+    VariadicTable<std::string, std::string, std::string, std::string, std::string>
+        tableCompare({ "Metric", "Baseline", "Current", "Change %", "Result" });
+    bool passed = true;
+    // Change is positive when the metric got worse
+    auto addMetric = [&](const std::string& name, double baseline, double current, bool higherIsBetter)
+    {
+        if (baseline <= 0)
+            return;
+        double change = (current - baseline) / baseline * 100.0;
+        if (higherIsBetter)
+            change = -change;
+        bool regression = change > thresholdPercent;
+        if (regression)
+            passed = false;
+        std::stringstream baselineText, currentText, changeText;
+        baselineText << std::fixed << std::setprecision(3) << baseline;
+        currentText << std::fixed << std::setprecision(3) << current;
+        changeText << std::fixed << std::setprecision(1) << std::showpos << change;
+        tableCompare.addRow(name, baselineText.str(), currentText.str(), changeText.str(), regression ? "REGRESSION" : "ok");
+    };
+
+    CORPUS_AGGREGATE total = aggregate();
+    addMetric("megabytesPerSecond", baselineTotal.megabytesPerSecond, total.megabytesPerSecond, true);
+    addMetric("p50Ms", baselineTotal.p50Ms, total.p50Ms, false);
+    addMetric("p99Ms", baselineTotal.p99Ms, total.p99Ms, false);
+    addMetric("cachedP50Ms", baselineTotal.cachedP50Ms, total.cachedP50Ms, false);
+    addMetric("cachedP99Ms", baselineTotal.cachedP99Ms, total.cachedP99Ms, false);
+    addMetric("peakRssBytes", (double)baselineTotal.peakRssBytes, (double)total.peakRssBytes, false);
+
+    for (const CORPUS_IMAGE_RESULT& result : results)
+    {
+        std::map<std::string, double>::const_iterator baseline = baselineMedians.find(result.path);
+        if (baseline != baselineMedians.end())
+            addMetric(result.path + " medianMs", baseline->second, median(result.coldMs), false);
+    }
+
+    std::stringstream title;
+    title << "Comparison with baseline, threshold " << thresholdPercent << "%";
+    tableCompare.print(outputStream, title.str());
+    outputStream << (passed ? "No regressions." : "Regressions found.") << std::endl;
+    return passed;
+}
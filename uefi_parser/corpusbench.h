@@ -0,0 +1,85 @@
+#ifndef CORPUSBENCH_H
+#define CORPUSBENCH_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "common/basetypes.h"
+#include "reportstore.h"
+
+// Bumped when names or meaning of fields in JSON results change
+#define CORPUS_RESULTS_VERSION 1
+#define CORPUS_DEFAULT_REPORT_DIR "corpus_bench_reports"
+#define CORPUS_DEFAULT_THRESHOLD 10.0
+
+namespace CorpusPhases {
+    enum CorpusPhaseTypes {
+        Load = 0,       // readFileIntoBuffer
+        Parse,          // CRC, report lookup miss, explore
+        ReportWrite,    // writeToFile
+        ReportRead,     // readFromFile hit of the cached run
+        Output,         // infoOutput of the cold run
+        Count
+    };
+}
+
+struct CORPUS_IMAGE_RESULT
+{
+    std::string path;
+    USTATUS status;
+    UINT64 size;
+    std::vector<double> coldMs;     // Load, parse, explore, write report, output
+    std::vector<double> cachedMs;   // Load, read report, output
+    std::vector<double> phaseMs[CorpusPhases::Count];
+    UINT64 peakRssBytes;            // Process peak after the last run of this image
+};
+
+struct CORPUS_AGGREGATE
+{
+    UINT32 images;
+    UINT32 failed;
+    UINT64 runs;
+    UINT64 bytes;
+    double imagesPerSecond;         // Cold runs
+    double megabytesPerSecond;      //
+    double p50Ms;
+    double p99Ms;
+    double cachedP50Ms;
+    double cachedP99Ms;
+    UINT64 peakRssBytes;
+};
+
+// Whole pipeline of the command line tool over a corpus of images, single threaded.
+// Every run is the cold path of an image (explore, write report) followed by the cached path
+// of the same image (read report), both ending with infoOutput in the given mode like the CLI does.
+class CorpusBenchmark
+{
+public:
+    CorpusBenchmark(const std::string& reportDir, UINT16 mode, UINT32 repeat);
+
+    // Source is as in collectImagePaths
+    USTATUS collectInputs(const std::string& source);
+    const std::vector<std::string>& getInputs() const { return inputs; }
+
+    USTATUS run();
+
+    CORPUS_AGGREGATE aggregate() const;
+    void resultsOutput(std::ostream& outputStream) const;
+    bool writeResults(const std::string& path) const;
+
+    // Prints every metric next to baseline results. False if any of them got worse
+    // by more than thresholdPercent, or if baseline can't be read.
+    bool compareWithBaseline(const std::string& baselinePath, double thresholdPercent, std::ostream& outputStream) const;
+
+private:
+    ReportStore reportStore;
+    UINT16 outputMode;
+    UINT32 repeatCount;
+    std::vector<std::string> inputs;
+    std::vector<CORPUS_IMAGE_RESULT> results;
+
+    void runImage(CORPUS_IMAGE_RESULT& result, bool timed);
+};
+
+#endif // !CORPUSBENCH_H
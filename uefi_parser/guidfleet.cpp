@@ -0,0 +1,177 @@
+#include "guidfleet.h"
+#include "batchparser.h"
+#include "utilities.h"
+#include "common/ffs.h"
+#include "common/ffsparser.h"
+#include "common/filesystem.h"
+#include "common/threadpool.h"
+#include "common/treemodel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+
+GuidFleet::GuidFleet(UINT32 numThreads) : threads(numThreads), wallTimeMs(0)
+{
+};
+
+USTATUS GuidFleet::collectInputs(const std::string& source)
+{
+    return collectImagePaths(source, inputs);
+}
+
+static bool fleetNameLess(const GUID_FLEET_NAME& lhs, const GUID_FLEET_NAME& rhs)
+{
+    return lhs.images > rhs.images;
+}
+
+void GuidFleet::run()
+{
+    statuses.assign(inputs.size(), U_SUCCESS);
+    imageGuids.assign(inputs.size(), 0);
+    database.clear();
+
+    // Names are taken from UI sections only, built-in GUID names are not mixed in
+    std::vector<GuidDatabase> imageDatabases(inputs.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        threads = pool.size();
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            pool.submit([this, i, &imageDatabases]
+            {
+                UByteArray buffer;
+                statuses[i] = readFileIntoBuffer(UString(inputs[i].c_str()), buffer);
+                if (statuses[i])
+                    return;
+                TreeModel model;
+                FfsParser parser(&model, GuidNameDatabase::builtIn());
+                statuses[i] = parser.parse(buffer);
+                for (int row = 0; row < model.rowCount(); row++)
+                    guidDatabaseFromTree(&model, model.index(row, 0), imageDatabases[i]);
+                imageGuids[i] = imageDatabases[i].size();
+            });
+        }
+        pool.wait();
+    }
+
+    for (size_t i = 0; i < imageDatabases.size(); i++)
+    {
+        merge(imageDatabases[i]);
+        GuidDatabase().swap(imageDatabases[i]);
+    }
+    for (GuidFleetDatabase::iterator it = database.begin(); it != database.end(); ++it)
+        std::stable_sort(it->second.names.begin(), it->second.names.end(), fleetNameLess);
+    wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void GuidFleet::merge(const GuidDatabase& imageDatabase)
+{
+    for (GuidDatabase::const_iterator it = imageDatabase.begin(); it != imageDatabase.end(); ++it)
+    {
+        GUID_FLEET_ENTRY& entry = database[it->first];
+        entry.images++;
+        std::string name = it->second.toLocal8Bit();
+        std::vector<GUID_FLEET_NAME>::iterator found = entry.names.begin();
+        while (found != entry.names.end() && found->name != name)
+            ++found;
+        if (found == entry.names.end())
+            entry.names.push_back({ name, 1 });
+        else
+            found->images++;
+    }
+}
+
+size_t GuidFleet::getConflictsCount() const
+{
+    size_t conflicts = 0;
+    for (GuidFleetDatabase::const_iterator it = database.begin(); it != database.end(); ++it)
+    {
+        if (it->second.names.size() > 1)
+            conflicts++;
+    }
+    return conflicts;
+}
+
+// Line breaks in names would end the comment line early
+static std::string singleLine(std::string text)
+{
+    std::replace(text.begin(), text.end(), '\r', ' ');
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    return text;
+}
+
+USTATUS GuidFleet::exportToFile(const std::string& path) const
+{
+    std::ofstream outputFile(path, std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return U_FILE_OPEN;
+
+    outputFile << "# Merged from " << inputs.size() << " images, "
+        << database.size() << " GUIDs, " << getConflictsCount() << " conflicts" << '\n';
+    for (GuidFleetDatabase::const_iterator it = database.begin(); it != database.end(); ++it)
+    {
+        std::string guid(guidToUString(it->first, false).toLocal8Bit());
+        const std::vector<GUID_FLEET_NAME>& names = it->second.names;
+        if (names.size() > 1)
+        {
+            outputFile << "# " << guid << " conflict:";
+            for (size_t i = 0; i < names.size(); i++)
+                outputFile << (i ? ", " : " ") << singleLine(names[i].name) << " (" << names[i].images << ")";
+            outputFile << '\n';
+        }
+        // Overlay format has no quoting, names that can't be loaded back are left as comments
+        if (names.front().name.find_first_of(",\r\n") != std::string::npos)
+        {
+            outputFile << "# " << guid << " skipped, name contains separator" << '\n';
+            continue;
+        }
+        outputFile << guid << ',' << names.front().name << '\n';
+    }
+    outputFile.close();
+    return outputFile ? U_SUCCESS : U_FILE_WRITE;
+}
+
+void GuidFleet::summaryOutput(std::ostream& outputStream) const
+{
+    size_t failed = 0, extracted = 0;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        if (statuses[i])
+            failed++;
+        extracted += imageGuids[i];
+    }
+
+    if (getConflictsCount())
+    {
+        VariadicTable<std::string, std::string, std::string>
+            tableConflicts({ "GUID", "Images", "Names (images)" });
+        for (GuidFleetDatabase::const_iterator it = database.begin(); it != database.end(); ++it)
+        {
+            const std::vector<GUID_FLEET_NAME>& names = it->second.names;
+            if (names.size() < 2)
+                continue;
+            std::string list;
+            for (size_t i = 0; i < names.size(); i++)
+                list += (i ? ", " : "") + names[i].name + " (" + std::to_string(names[i].images) + ")";
+            tableConflicts.addRow(
+                std::string(guidToUString(it->first, false).toLocal8Bit()),
+                std::to_string(it->second.images),
+                list
+            );
+        }
+        tableConflicts.print(outputStream, "Name conflicts");
+    }
+
+    std::ios_base::fmtflags basic_flags(outputStream.flags());
+    outputStream << "Images: " << inputs.size() << ", failed: " << failed << ", threads: " << threads << std::endl;
+    outputStream << "GUIDs extracted: " << extracted << ", unique: " << database.size()
+        << ", conflicts: " << getConflictsCount() << std::endl;
+    outputStream << std::fixed << std::setprecision(1)
+        << "Wall time: " << wallTimeMs << " ms, "
+        << (wallTimeMs > 0 ? inputs.size() * 1000.0 / wallTimeMs : 0.0) << " images/s" << std::endl;
+    outputStream.flags(basic_flags);
+}
@@ -0,0 +1,63 @@
+#ifndef GUIDFLEET_H
+#define GUIDFLEET_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/basetypes.h"
+#include "common/guiddatabase.h"
+
+#define GUID_FLEET_DEFAULT_OUTPUT "guids_fleet.csv"
+
+// One name of a GUID and number of images naming it so
+struct GUID_FLEET_NAME
+{
+    std::string name;
+    UINT32 images;
+};
+
+// All names met for a GUID, most used first, first met first among equally used
+struct GUID_FLEET_ENTRY
+{
+    std::vector<GUID_FLEET_NAME> names;
+    UINT32 images;
+};
+
+typedef std::map<EFI_GUID, GUID_FLEET_ENTRY, OperatorLessForGuids> GuidFleetDatabase;
+
+// Extracts GUIDs and UI names of files from many images on a worker pool and merges them
+// into one deduplicated database. A GUID named differently by different images is a conflict,
+// the name used by most images is exported and the others are kept in comments.
+class GuidFleet
+{
+public:
+    explicit GuidFleet(UINT32 numThreads);
+
+    // Source is as in collectImagePaths
+    USTATUS collectInputs(const std::string& source);
+    const std::vector<std::string>& getInputs() const { return inputs; }
+
+    // Parse all inputs and merge their names in input order, so result does not depend on scheduling
+    void run();
+
+    const GuidFleetDatabase& getDatabase() const { return database; }
+    size_t getConflictsCount() const;
+
+    // CSV readable by initGuidDatabase
+    USTATUS exportToFile(const std::string& path) const;
+    void summaryOutput(std::ostream& outputStream) const;
+
+private:
+    UINT32 threads;
+    std::vector<std::string> inputs;
+    std::vector<USTATUS> statuses;
+    std::vector<size_t> imageGuids;
+    GuidFleetDatabase database;
+    double wallTimeMs;
+
+    void merge(const GuidDatabase& imageDatabase);
+};
+
+#endif // !GUIDFLEET_H
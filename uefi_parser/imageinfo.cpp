@@ -5,6 +5,11 @@
 #include "common/ffs.h"
 #include "common/utility.h"
 #include "common/descriptor.h"
+#include "common/parserstats.h"
+#include "common/chunkdiff.h"
+#include "common/ffsdiff.h"
+#include "common/ffshash.h"
+#include "common/nvramdiff.h"
 
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
@@ -15,17 +20,43 @@ using ordered_json = nlohmann::ordered_json;
 #include <iomanip>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
 
 
-ImageInfo::ImageInfo(UByteArray& inputBuffer) : openedImage(inputBuffer), model(), ffsParser(&model)
+ImageInfo::ImageInfo(UByteArray& inputBuffer) : ImageInfo(inputBuffer, currentGuidDatabase())
 {
-    crc = (UINT32)crc32(0, (const UINT8*)openedImage.constData(), (uInt)openedImage.size());
+};
+
+ImageInfo::ImageInfo(UByteArray& inputBuffer, const GuidNameDatabase& guidDatabase)
+    : ImageInfo(inputBuffer, std::shared_ptr<const GuidNameDatabase>(std::shared_ptr<const GuidNameDatabase>(), &guidDatabase))
+{
+};
+
+ImageInfo::ImageInfo(UByteArray& inputBuffer, std::shared_ptr<const GuidNameDatabase> guidDatabase)
+    : openedImage(inputBuffer), guidNames(guidDatabase), model(), ffsParser(&model, *guidNames), logStream(&std::cout)
+{
+    {
+        STATS_SCOPE(StatsTimers::Crc);
+        crc = (UINT32)crc32(0, (const UINT8*)openedImage.constData(), (uInt)openedImage.size());
+    }
     sizeFullFile = openedImage.size();
+    sizeFullImage = 0;
     isCapsule = false;
     isIntelImage = false;
     isBootGuard = false;
 };
 
+ImageInfo::ImageInfo(ordered_json& report) : model(), ffsParser(&model), logStream(&std::cout)
+{
+    crc = report["crc"].get<UINT32>();
+    sizeFullFile = report["sizeFullFile"].get<UINT32>();
+    sizeFullImage = 0;
+    isCapsule = false;
+    isIntelImage = false;
+    isBootGuard = false;
+    readFromJson(report);
+};
+
 void ImageInfo::calculateBufferCRC()
 {
     crc = (UINT32)crc32(0, (const UINT8*)openedImage.constData(), (uInt)openedImage.size());
@@ -196,8 +227,12 @@ INFO_FILE ImageInfo::parseFileType(const UModelIndex& index)
     const EFI_FFS_FILE_HEADER* fileHeader = (const EFI_FFS_FILE_HEADER*)header.constData();
 
     infoFile.type = model.subtype(index);
-    infoFile.name = std::string(guidToUString(fileHeader->Name).toLocal8Bit());
-    infoFile.guid = std::string(guidToUString(fileHeader->Name, false).toLocal8Bit());
+    // GUID is formatted once, names are shared by the GUID database
+    char guidText[GUID_STRING_LENGTH];
+    guidToChars(fileHeader->Name, guidText);
+    infoFile.guid.assign(guidText, GUID_STRING_LENGTH);
+    const char* guidName = ffsParser.getGuidDatabase().lookup(fileHeader->Name);
+    infoFile.name = guidName && *guidName ? std::string(guidName) : infoFile.guid;
     infoFile.base = model.base(index);
 
     UINT64 address = ffsParser.addressDiff + model.base(index);
@@ -207,6 +242,8 @@ INFO_FILE ImageInfo::parseFileType(const UModelIndex& index)
     infoFile.attributes = fileHeader->Attributes;
     infoFile.size = file.size();
 
+    infoFile.hash = FfsHash::hashToString(model.hash(index));
+
     std::stringstream headerChecksum, dataChecksum;
     headerChecksum << usprintf("%02Xh", fileHeader->IntegrityCheck.Checksum.Header).toLocal8Bit();
     infoFile.headerChecksum = std::string(headerChecksum.str());
@@ -216,6 +253,40 @@ INFO_FILE ImageInfo::parseFileType(const UModelIndex& index)
     return infoFile;
 }
 
+INFO_VOLUME ImageInfo::parseVolume(const UModelIndex& index)
+{
+    INFO_VOLUME infoVolume;
+    infoVolume.name = model.name(index).toLocal8Bit();
+    infoVolume.base = model.base(index);
+    infoVolume.size = model.header(index).size() + model.body(index).size() + model.tail(index).size();
+    infoVolume.hash = FfsHash::hashToString(model.hash(index));
+    return infoVolume;
+}
+
+UINT16 outputModeFromString(const std::string& outputModeStr)
+{
+    UINT16 mode = 0;
+    if (outputModeStr.find("desc") != std::string::npos)
+        mode |= OUTPUT_MODE_DESCRIPTION;
+    if (outputModeStr.find("capsule") != std::string::npos)
+        mode |= OUTPUT_MODE_CAPSULE;
+    if (outputModeStr.find("image") != std::string::npos)
+        mode |= OUTPUT_MODE_IMAGE;
+    if (outputModeStr.find("peicore") != std::string::npos)
+        mode |= OUTPUT_MODE_FILE_PEI_CORE;
+    if (outputModeStr.find("peimodules") != std::string::npos)
+        mode |= OUTPUT_MODE_FILE_PEI;
+    if (outputModeStr.find("dxecore") != std::string::npos)
+        mode |= OUTPUT_MODE_FILE_DXE_CORE;
+    if (outputModeStr.find("dxedrivers") != std::string::npos)
+        mode |= OUTPUT_MODE_FILE_DXE;
+    if (outputModeStr.find("bg") != std::string::npos)
+        mode |= OUTPUT_MODE_BG;
+    if (outputModeStr.find("all") != std::string::npos)
+        mode |= OUTPUT_MODE_FULL;
+    return mode;
+}
+
 std::string ReplaceAll(std::string str, const std::string& from, const std::string& to) {
     size_t start_pos = 0;
     while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
@@ -228,11 +299,16 @@ std::string ReplaceAll(std::string str, const std::string& from, const std::stri
 USTATUS ImageInfo::explore()
 {
     // Parse input buffer
-    std::cout << "Start explore file." << std::endl;
+    *logStream << "Start explore file." << std::endl;
     USTATUS result = ffsParser.parse(openedImage);
+    if (result)
+        return result;
+    result = FfsHash::hashTree(&model);
     if (result)
         return result;
     UModelIndex root = model.index(0, 0);
+    STATS_SCOPE(StatsTimers::Explore);
+    treeHash = FfsHash::hashToString(model.hash(root));
     if (ffsParser.bgBootPolicyFound)
     {
         isBootGuard = true;
@@ -273,6 +349,8 @@ USTATUS ImageInfo::exploreFileTypeRecursive(const UModelIndex& index)
 {
     if (!index.isValid())
         return U_INVALID_PARAMETER;
+    if (model.type(index) == Types::Volume)
+        vInfoVolume.push_back(parseVolume(index));
     if (model.type(index) == Types::File)
     {
         int type = model.subtype(index);
@@ -295,7 +373,19 @@ USTATUS ImageInfo::exploreFileTypeRecursive(const UModelIndex& index)
     return U_SUCCESS;
 }
 
-USTATUS ImageInfo::compareWithAnother(ImageInfo& anotherImage)
+static const char* diffChangeToString(UINT8 change)
+{
+    switch (change)
+    {
+    case DiffChanges::Added:    return "added";
+    case DiffChanges::Removed:  return "removed";
+    case DiffChanges::Modified: return "modified";
+    case DiffChanges::Moved:    return "moved";
+    }
+    return "unknown";
+}
+
+USTATUS ImageInfo::compareWithAnother(ImageInfo& anotherImage, const std::string& reportPath)
 {
     std::cout << std::endl << "Comparing:" << std::endl;
     bool isDifferentCrc = false, isDifferentSize = false;
@@ -308,24 +398,434 @@ USTATUS ImageInfo::compareWithAnother(ImageInfo& anotherImage)
     std::cout << " -Images crc: " << ((isDifferentCrc) ? "different." : "equal.") << std::endl;
     std::cout << " -Images size: " << ((isDifferentSize) ? "different." : "equal.") << std::endl;
 
+    FfsDiff diff(&model, &anotherImage.model);
+    std::vector<CHUNK_DIFF_RANGE> ranges;
+    std::vector<std::string> rangePaths;
     if (isDifferentCrc || isDifferentSize)
     {
-        UINT32 i;
-        UINT32 max_size = std::min(openedImage.size(), anotherImage.openedImage.size());
-        for (i = 0; i < max_size; i++)
+        // Both trees and image data are needed. Images restored from reports have neither,
+        // image that fails to parse would show all items of the other one as added or removed
+        if (openedImage.isEmpty() || anotherImage.openedImage.isEmpty())
+            return U_INVALID_PARAMETER;
+        USTATUS result;
+        if (model.rowCount() == 0)
         {
-            if (openedImage[i] != anotherImage.openedImage[i])
-                break;
-        };
-        i++;
+            result = explore();
+            if (result)
+                return result;
+        }
+        if (anotherImage.model.rowCount() == 0)
+        {
+            result = anotherImage.explore();
+            if (result)
+                return result;
+        }
+
+        result = chunkDiff((const UINT8*)openedImage.constData(), openedImage.size(),
+            (const UINT8*)anotherImage.openedImage.constData(), anotherImage.openedImage.size(), ranges);
+        if (result)
+            return result;
+        UINT64 equalBytes = 0, changedBytes = 0;
+        UINT32 equalRanges = 0, changedRanges = 0;
+        VariadicTable<std::string, std::string, std::string, std::string, std::string>
+            tableRanges({ "Old offset", "Old size", "New offset", "New size", "Path" });
+        for (const CHUNK_DIFF_RANGE& range : ranges)
+        {
+            if (range.kind == ChunkDiffRanges::Equal)
+            {
+                equalRanges++;
+                equalBytes += range.newSize;
+                rangePaths.push_back(std::string());
+                continue;
+            }
+            changedRanges++;
+            changedBytes += range.newSize;
+            // Removed data has no place in new image
+            UString path = range.newSize ? itemPathByRange(&anotherImage.model, (UINT32)range.newOffset, (UINT32)range.newSize)
+                : itemPathByRange(&model, (UINT32)range.oldOffset, (UINT32)range.oldSize);
+            rangePaths.push_back(path.toLocal8Bit());
+            std::stringstream oldOffset, oldSize, newOffset, newSize;
+            oldOffset << std::uppercase << HexView(range.oldOffset);
+            oldSize << std::uppercase << HexView(range.oldSize);
+            newOffset << std::uppercase << HexView(range.newOffset);
+            newSize << std::uppercase << HexView(range.newSize);
+            tableRanges.addRow(oldOffset.str(), oldSize.str(), newOffset.str(), newSize.str(), rangePaths.back());
+        }
         std::cout << std::uppercase;
-        std::cout << " -Differences in images start with " << HexAndDecView(i) << std::endl;
+        std::cout << " -Equal content: " << HexAndDecView(equalBytes) << " bytes in " << equalRanges << " ranges" << std::endl;
+        std::cout << " -Changed content: " << HexAndDecView(changedBytes) << " bytes of new image in " << changedRanges << " ranges" << std::endl;
+        if (changedRanges)
+            tableRanges.print(std::cout, "Changed ranges");
+
+        result = diff.compare();
+        if (result)
+            return result;
+
+        const FFS_DIFF_STATS& stats = diff.getStats();
+        std::cout << " -Changed items: " << stats.added << " added, " << stats.removed << " removed, "
+            << stats.modified << " modified, " << stats.moved << " moved; "
+            << stats.identicalSubtrees << " identical subtrees skipped." << std::endl << std::endl;
+
+        VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+            tableDiff({ "Change", "Type", "Path", "Old base", "New base", "Old size", "New size" });
+        for (const FFS_DIFF_ITEM& item : diff.getItems())
+        {
+            std::stringstream oldBase, newBase, oldSize, newSize;
+            oldBase << std::uppercase;
+            newBase << std::uppercase;
+            oldSize << std::uppercase;
+            newSize << std::uppercase;
+            if (item.change != DiffChanges::Added)
+            {
+                oldBase << HexView(item.oldBase);
+                oldSize << HexView(item.oldSize);
+            }
+            if (item.change != DiffChanges::Removed)
+            {
+                newBase << HexView(item.newBase);
+                newSize << HexView(item.newSize);
+            }
+            std::string path = item.path.toLocal8Bit();
+            if (!(item.oldPath == item.path))
+                path = std::string(item.oldPath.toLocal8Bit()) + " -> " + path;
+            if (!item.text.isEmpty())
+                path += " (" + std::string(item.text.toLocal8Bit()) + ")";
+            tableDiff.addRow(
+                diffChangeToString(item.change),
+                itemTypeToString(item.type),
+                path,
+                oldBase.str(),
+                newBase.str(),
+                oldSize.str(),
+                newSize.str()
+            );
+        }
+        if (!diff.getItems().empty())
+            tableDiff.print(std::cout, "Structural differences");
     };
+
+    if (!reportPath.empty())
+    {
+        ordered_json diffObj;
+        diffObj["version"] = DIFF_REPORT_VERSION;
+        diffObj["oldCrc"] = crc;
+        diffObj["newCrc"] = anotherImage.crc;
+        diffObj["oldSize"] = sizeFullFile;
+        diffObj["newSize"] = anotherImage.sizeFullFile;
+        diffObj["identical"] = !(isDifferentCrc || isDifferentSize);
+
+        const FFS_DIFF_STATS& stats = diff.getStats();
+        ordered_json statsObj;
+        statsObj["added"] = stats.added;
+        statsObj["removed"] = stats.removed;
+        statsObj["modified"] = stats.modified;
+        statsObj["moved"] = stats.moved;
+        statsObj["comparedItems"] = stats.comparedItems;
+        statsObj["identicalSubtrees"] = stats.identicalSubtrees;
+        diffObj["stats"] = statsObj;
+
+        ordered_json rangesArr = ordered_json::array();
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            ordered_json rangeObj;
+            rangeObj["kind"] = ranges[i].kind == ChunkDiffRanges::Equal ? "equal" : "changed";
+            rangeObj["oldOffset"] = ranges[i].oldOffset;
+            rangeObj["oldSize"] = ranges[i].oldSize;
+            rangeObj["newOffset"] = ranges[i].newOffset;
+            rangeObj["newSize"] = ranges[i].newSize;
+            if (ranges[i].kind == ChunkDiffRanges::Changed)
+                rangeObj["path"] = rangePaths[i];
+            rangesArr.push_back(rangeObj);
+        }
+        diffObj["ranges"] = rangesArr;
+
+        ordered_json changesArr = ordered_json::array();
+        for (const FFS_DIFF_ITEM& item : diff.getItems())
+        {
+            ordered_json changeObj;
+            changeObj["change"] = diffChangeToString(item.change);
+            changeObj["type"] = itemTypeToString(item.type);
+            changeObj["subtype"] = itemSubtypeToString(item.type, item.subtype);
+            changeObj["name"] = std::string(item.name.toLocal8Bit());
+            changeObj["text"] = std::string(item.text.toLocal8Bit());
+            changeObj["path"] = std::string(item.path.toLocal8Bit());
+            if (item.change == DiffChanges::Moved)
+                changeObj["oldPath"] = std::string(item.oldPath.toLocal8Bit());
+            if (item.change != DiffChanges::Added)
+            {
+                changeObj["oldBase"] = item.oldBase;
+                changeObj["oldSize"] = item.oldSize;
+            }
+            if (item.change != DiffChanges::Removed)
+            {
+                changeObj["newBase"] = item.newBase;
+                changeObj["newSize"] = item.newSize;
+            }
+            changesArr.push_back(changeObj);
+        }
+        diffObj["changes"] = changesArr;
+
+        std::ofstream outputFile(reportPath, std::ios::out | std::ios::trunc);
+        outputFile << std::setw(4) << diffObj << std::endl;
+        if (!outputFile)
+        {
+            std::cout << "Error of writing differences to \"" << reportPath << "\"." << std::endl;
+            return U_FILE_WRITE;
+        }
+        std::cout << "Differences are written to \"" << reportPath << "\"." << std::endl;
+    }
     
     return U_SUCCESS;
 }
 
-void ImageInfo::infoOutput(std::ostream& outputStream, UINT16 mode)
+USTATUS ImageInfo::nvramQueryOutput(std::ostream& outputStream, const std::string& query) const
+{
+    const NvramIndex& nvramIndex = ffsParser.getNvramIndex();
+    std::vector<size_t> positions;
+    if (query == "*")
+    {
+        for (size_t i = 0; i < nvramIndex.size(); i++)
+            positions.push_back(i);
+    }
+    else
+    {
+        EFI_GUID guid;
+        size_t separator = query.find(':');
+        if (separator == GUID_STRING_LENGTH && ustringToGuid(UString(query.substr(0, separator).c_str()), guid))
+        {
+            NVRAM_VARIABLE_KEY key;
+            key.guid = guid;
+            key.name = nvramNameFromUtf8(query.substr(separator + 1));
+            positions = nvramIndex.find(key);
+        }
+        else
+            positions = nvramIndex.findByName(nvramNameFromUtf8(query));
+    }
+
+    if (positions.empty())
+    {
+        outputStream << "NVRAM variable \"" << query << "\" is not found among " << nvramIndex.size() << " variables of the image." << std::endl;
+        return U_ITEM_NOT_FOUND;
+    }
+
+    VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+        tableVariables({ "Guid", "Name", "Store", "State", "Attributes", "Base", "Size", "Data" });
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        const NVRAM_VARIABLE& variable = nvramIndex.getVariables()[positions[i]];
+        std::string state = variable.isValid ? "valid" : "invalid";
+        if (nvramIndex.current(variable.key) == &variable)
+            state = "current";
+        std::stringstream attributes, base, size, data;
+        attributes << std::uppercase << HexView(variable.attributes);
+        base << std::uppercase << HexView(variable.offset);
+        size << std::uppercase << HexView(variable.dataSize);
+        // Beginning of data is enough to tell values apart in a table
+        data << std::uppercase << std::hex << std::setfill('0');
+        for (UINT32 j = 0; j < variable.dataSize && j < 16; j++)
+            data << std::setw(2) << (UINT32)variable.data[j];
+        if (variable.dataSize > 16)
+            data << "...";
+        tableVariables.addRow(
+            std::string(guidToUString(variable.key.guid, false).toLocal8Bit()),
+            nvramNameToUtf8(variable.key.name),
+            itemTypeToString(variable.type),
+            state,
+            attributes.str(),
+            base.str(),
+            size.str(),
+            data.str()
+        );
+    }
+    tableVariables.print(outputStream, "NVRAM variables");
+    return U_SUCCESS;
+}
+
+USTATUS ImageInfo::meHashesOutput(std::ostream& outputStream) const
+{
+    const std::vector<ME_PARTITION_HASHES>& partitions = ffsParser.getMePartitionHashes();
+    if (partitions.empty())
+    {
+        outputStream << "No ME partitions with CPD directories are found in the image." << std::endl;
+        return U_ITEM_NOT_FOUND;
+    }
+
+    VariadicTable<std::string, std::string, UINT32, UINT32, UINT32, UINT32, std::string>
+        tablePartitions({ "Partition", "Base", "Entries", "Valid", "Invalid", "Unchecked", "Result" });
+    UINT32 invalidPartitions = 0;
+    for (size_t i = 0; i < partitions.size(); i++)
+    {
+        const ME_PARTITION_HASHES& partition = partitions[i];
+        std::stringstream base;
+        base << std::uppercase << HexView(model.base(partition.Index));
+        std::string result = "valid";
+        if (partition.Invalid)
+        {
+            result = "invalid";
+            invalidPartitions++;
+        }
+        else if (partition.Valid == 0)
+            result = "unchecked";
+        tablePartitions.addRow(
+            std::string(partition.Name.toLocal8Bit()),
+            base.str(),
+            partition.Modules,
+            partition.Valid,
+            partition.Invalid,
+            partition.Unchecked,
+            result
+        );
+    }
+    tablePartitions.print(outputStream, "ME partition hashes");
+    outputStream << partitions.size() << " partitions checked, " << invalidPartitions << " with invalid hashes." << std::endl;
+    return U_SUCCESS;
+}
+
+static const char* nvramDiffChangeToString(UINT8 change)
+{
+    switch (change)
+    {
+    case NvramDiffChanges::Added:      return "added";
+    case NvramDiffChanges::Removed:    return "removed";
+    case NvramDiffChanges::Changed:    return "changed";
+    case NvramDiffChanges::Duplicated: return "duplicated";
+    }
+    return "unknown";
+}
+
+static std::string nvramInstancesToString(UINT32 instances, UINT32 invalid)
+{
+    std::string text = std::to_string(instances);
+    if (invalid)
+        text += ", " + std::to_string(invalid) + " deleted";
+    return text;
+}
+
+static void nvramDiffVariableToJson(const char* prefix, const NVRAM_VARIABLE* variable, UINT64 hash, UINT32 instances, UINT32 invalid, ordered_json& changeObj)
+{
+    std::string name(prefix);
+    if (variable)
+    {
+        std::stringstream hashText;
+        hashText << std::uppercase << std::hex << std::setfill('0') << std::setw(16) << hash;
+        changeObj[name + "Store"] = itemTypeToString(variable->type);
+        changeObj[name + "Attributes"] = variable->attributes;
+        changeObj[name + "Base"] = variable->offset;
+        changeObj[name + "Size"] = variable->dataSize;
+        changeObj[name + "Hash"] = hashText.str();
+    }
+    changeObj[name + "Instances"] = instances;
+    changeObj[name + "Deleted"] = invalid;
+}
+
+USTATUS ImageInfo::nvramDiffOutput(ImageInfo& anotherImage, std::ostream& outputStream, const std::string& reportPath)
+{
+    // Variables are indexed by parsing, images restored from reports have none.
+    // Image that fails to parse would show all variables of the other one as added or removed
+    USTATUS result;
+    if (model.rowCount() == 0)
+    {
+        result = explore();
+        if (result)
+            return result;
+    }
+    if (anotherImage.model.rowCount() == 0)
+    {
+        result = anotherImage.explore();
+        if (result)
+            return result;
+    }
+
+    NvramDiff diff(&ffsParser.getNvramIndex(), &anotherImage.ffsParser.getNvramIndex());
+    result = diff.compare();
+    if (result)
+        return result;
+
+    const NVRAM_DIFF_STATS& stats = diff.getStats();
+    outputStream << std::endl << "Comparing NVRAM:" << std::endl;
+    outputStream << " -Variables: " << stats.oldVariables << " in old image, " << stats.newVariables << " in new image" << std::endl;
+    outputStream << " -Changed variables: " << stats.added << " added, " << stats.removed << " removed, "
+        << stats.changed << " changed; " << stats.duplicated << " duplicated." << std::endl << std::endl;
+
+    VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+        tableDiff({ "Change", "Guid", "Name", "Store", "Old attributes", "New attributes", "Old size", "New size", "Old instances", "New instances" });
+    for (const NVRAM_DIFF_ENTRY& entry : diff.getEntries())
+    {
+        std::stringstream oldAttributes, newAttributes, oldSize, newSize;
+        oldAttributes << std::uppercase;
+        newAttributes << std::uppercase;
+        oldSize << std::uppercase;
+        newSize << std::uppercase;
+        if (entry.oldVariable)
+        {
+            oldAttributes << HexView(entry.oldVariable->attributes);
+            oldSize << HexView(entry.oldVariable->dataSize);
+        }
+        if (entry.newVariable)
+        {
+            newAttributes << HexView(entry.newVariable->attributes);
+            newSize << HexView(entry.newVariable->dataSize);
+        }
+        const NVRAM_VARIABLE* variable = entry.newVariable ? entry.newVariable : entry.oldVariable;
+        tableDiff.addRow(
+            nvramDiffChangeToString(entry.change),
+            std::string(guidToUString(entry.key.guid, false).toLocal8Bit()),
+            nvramNameToUtf8(entry.key.name),
+            std::string(variable ? itemTypeToString(variable->type) : ""),
+            oldAttributes.str(),
+            newAttributes.str(),
+            oldSize.str(),
+            newSize.str(),
+            nvramInstancesToString(entry.oldInstances, entry.oldInvalid),
+            nvramInstancesToString(entry.newInstances, entry.newInvalid)
+        );
+    }
+    if (!diff.getEntries().empty())
+        tableDiff.print(outputStream, "NVRAM differences");
+
+    if (!reportPath.empty())
+    {
+        ordered_json diffObj;
+        diffObj["version"] = NVRAM_DIFF_REPORT_VERSION;
+        diffObj["oldCrc"] = crc;
+        diffObj["newCrc"] = anotherImage.crc;
+
+        ordered_json statsObj;
+        statsObj["oldVariables"] = stats.oldVariables;
+        statsObj["newVariables"] = stats.newVariables;
+        statsObj["added"] = stats.added;
+        statsObj["removed"] = stats.removed;
+        statsObj["changed"] = stats.changed;
+        statsObj["duplicated"] = stats.duplicated;
+        diffObj["stats"] = statsObj;
+
+        ordered_json changesArr = ordered_json::array();
+        for (const NVRAM_DIFF_ENTRY& entry : diff.getEntries())
+        {
+            ordered_json changeObj;
+            changeObj["change"] = nvramDiffChangeToString(entry.change);
+            changeObj["guid"] = std::string(guidToUString(entry.key.guid, false).toLocal8Bit());
+            changeObj["name"] = nvramNameToUtf8(entry.key.name);
+            nvramDiffVariableToJson("old", entry.oldVariable, entry.oldHash, entry.oldInstances, entry.oldInvalid, changeObj);
+            nvramDiffVariableToJson("new", entry.newVariable, entry.newHash, entry.newInstances, entry.newInvalid, changeObj);
+            changesArr.push_back(changeObj);
+        }
+        diffObj["changes"] = changesArr;
+
+        std::ofstream outputFile(reportPath, std::ios::out | std::ios::trunc);
+        outputFile << std::setw(4) << diffObj << std::endl;
+        if (!outputFile)
+        {
+            outputStream << "Error of writing differences to \"" << reportPath << "\"." << std::endl;
+            return U_FILE_WRITE;
+        }
+        outputStream << "Differences are written to \"" << reportPath << "\"." << std::endl;
+    }
+
+    return U_SUCCESS;
+}
+
+void ImageInfo::infoOutput(std::ostream& outputStream, UINT16 mode) const
 {
     outputStream << std::uppercase;
     outputStream << std::endl;
@@ -338,7 +838,8 @@ void ImageInfo::infoOutput(std::ostream& outputStream, UINT16 mode)
         outputStream << "   -Image size: " << HexAndDecView(sizeFullImage) << std::endl;
         outputStream << "   -Capsule: " << ((isCapsule) ? "Yes" : "No") << std::endl;
         outputStream << "   -Image Type: " << ((isIntelImage) ? "Intel Image" : "UEFI image") << std::endl;
-        outputStream << "   -Boot Guard: " << ((isBootGuard) ? "Yes" : "No") << std::endl << std::endl;
+        outputStream << "   -Boot Guard: " << ((isBootGuard) ? "Yes" : "No") << std::endl;
+        outputStream << "   -Tree hash: " << treeHash << std::endl << std::endl;
     };
 
     if (mode & OUTPUT_MODE_CAPSULE)
@@ -530,6 +1031,20 @@ void ImageInfo::infoOutput(std::ostream& outputStream, UINT16 mode)
             outputStream << "   -Base: " << HexView(infoUefiImage.base) << std::endl;
             outputStream << "   -Size: " << HexAndDecView(infoUefiImage.size) << std::endl << std::endl;
         }
+
+        if (!vInfoVolume.empty())
+        {
+            VariadicTable<std::string, std::string, std::string, std::string>
+                tableVolumes({ "Name", "Base", "Size", "Hash" });
+            for (const INFO_VOLUME& iVolume : vInfoVolume)
+            {
+                std::stringstream base, size;
+                base << std::uppercase << HexView(iVolume.base);
+                size << std::uppercase << HexView(iVolume.size);
+                tableVolumes.addRow(iVolume.name, base.str(), size.str(), iVolume.hash);
+            }
+            tableVolumes.print(outputStream, "Volumes");
+        }
     }
     
     if (mode & OUTPUT_MODE_BG)
@@ -636,26 +1151,50 @@ INFO_FILE parseFileTypeStructureFromJSON(ordered_json& fileInfoObj, int type)
     tempInfoFile.size = fileInfoObj["size"].get<UINT32>();
     tempInfoFile.headerChecksum = fileInfoObj["headerChecksum"].get<std::string>();
     tempInfoFile.dataChecksum = fileInfoObj["dataChecksum"].get<std::string>();
+    tempInfoFile.hash = fileInfoObj["hash"].get<std::string>();
     return tempInfoFile;
 }
 
-bool ImageInfo::readFromFile()
+bool ImageInfo::readFromFile(ReportStore& reportStore)
 {
-    UString reportPath = usprintf("reports/report_%u.json", crc);
-    if (!isExistOnFs(reportPath))
+    STATS_SCOPE(StatsTimers::JsonRead);
+    ordered_json imageMainJsonObj;
+    if (!reportStore.load(crc, imageMainJsonObj))
         return false;
 
-    std::ifstream inputFile(reportPath.toLocal8Bit(), std::ios::in);
-    if (!inputFile)
-        return false;
+    *logStream << "Report is already exist. Reading..." << std::endl;
 
-    std::cout << "Report is already exist. Reading..." << std::endl;
+    try
+    {
+        readFromJson(imageMainJsonObj);
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        *logStream << "Report is damaged and will be recreated." << std::endl;
+        reportStore.invalidate(crc);
+        resetInfo();
+        return false;
+    }
+    return true;
+}
 
-    ordered_json imageMainJsonObj;
-    inputFile >> imageMainJsonObj;
+void ImageInfo::resetInfo()
+{
+    isCapsule = false;
+    isIntelImage = false;
+    isBootGuard = false;
+    infoIntelImage.vRegions.clear();
+    vInfoFile.clear();
+    vInfoVolume.clear();
+    infoBootGuard.clear();
+    treeHash.clear();
+}
 
+void ImageInfo::readFromJson(ordered_json& imageMainJsonObj)
+{
     //crc and full file size already in class
     sizeFullImage = imageMainJsonObj["sizeFullImage"].get<UINT32>();
+    treeHash = imageMainJsonObj["treeHash"].get<std::string>();
 
     if (imageMainJsonObj.contains("capsule"))
     {
@@ -709,6 +1248,7 @@ bool ImageInfo::readFromFile()
             REGION_INTEL_IMAGE tempRegion;
             tempRegion.type = iRegionInfoObj["type"].get<UINT8>();
             tempRegion.base = iRegionInfoObj["base"].get<UINT32>();
+            tempRegion.offset = iRegionInfoObj["offset"].get<UINT32>();
             tempRegion.size = iRegionInfoObj["size"].get<UINT32>();
             infoIntelImage.vRegions.push_back(tempRegion);
         };
@@ -727,6 +1267,16 @@ bool ImageInfo::readFromFile()
         infoBootGuard = imageMainJsonObj["boot_guard"].get<std::string>();
     };
 
+    for (ordered_json iVolumeObj : imageMainJsonObj["volumes"])
+    {
+        INFO_VOLUME tempVolume;
+        tempVolume.name = iVolumeObj["name"].get<std::string>();
+        tempVolume.base = iVolumeObj["base"].get<UINT32>();
+        tempVolume.size = iVolumeObj["size"].get<UINT32>();
+        tempVolume.hash = iVolumeObj["hash"].get<std::string>();
+        vInfoVolume.push_back(tempVolume);
+    };
+
     ordered_json peimArr = ordered_json::array();
     ordered_json dxedArr = ordered_json::array();
     ordered_json peiCoreArr = ordered_json::array();
@@ -753,33 +1303,25 @@ bool ImageInfo::readFromFile()
     {
         vInfoFile.push_back(parseFileTypeStructureFromJSON(iInfoFileJson, EFI_FV_FILETYPE_DXE_CORE));
     };
-
-    return true;
 }
 
-bool ImageInfo::writeToFile()
+bool ImageInfo::writeToFile(ReportStore& reportStore)
 {
-    UString reportPath = usprintf("reports/report_%u.json", crc);
-    if (isExistOnFs(reportPath))
-        return false;
-    UString dirPath("reports");
-    if (!isExistOnFs(dirPath))
-    {
-        if (!makeDirectory(dirPath))
-        {
-            std::cout << "Error of creating directory for reports." << std::endl;
-            return false;
-        }
-    };
-
-    std::cout << "Writing image information to file: " << reportPath.toLocal8Bit() <<std::endl;
-    std::ofstream outputFile(reportPath.toLocal8Bit(), std::ios::out);
-
+    STATS_SCOPE(StatsTimers::JsonWrite);
     ordered_json imageMainJsonObj;
+    toJson(imageMainJsonObj);
 
+    *logStream << "Writing image information to file: " << reportStore.reportPath(crc).toLocal8Bit() << std::endl;
+    return reportStore.store(crc, imageMainJsonObj);
+}
+
+void ImageInfo::toJson(ordered_json& imageMainJsonObj) const
+{
+    imageMainJsonObj["schemaVersion"] = REPORT_SCHEMA_VERSION;
     imageMainJsonObj["crc"] = crc;
     imageMainJsonObj["sizeFullFile"] = sizeFullFile;
     imageMainJsonObj["sizeFullImage"] = sizeFullImage;
+    imageMainJsonObj["treeHash"] = treeHash;
 
     if (isCapsule)
     {
@@ -821,8 +1363,8 @@ bool ImageInfo::writeToFile()
             masterSectionV2Obj["MeWrite"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.MeWrite;
             masterSectionV2Obj["GbeRead"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.GbeRead;
             masterSectionV2Obj["GbeWrite"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.GbeWrite;
-            masterSectionV2Obj["EcRead"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.GbeRead;
-            masterSectionV2Obj["EcWrite"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.GbeWrite;
+            masterSectionV2Obj["EcRead"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.EcRead;
+            masterSectionV2Obj["EcWrite"] = (UINT32)infoIntelImage.descriptor.masterSectionV2.EcWrite;
             descriptorObj["masterSectionV2"] = masterSectionV2Obj;
         }
         intelImageObj["descriptor"] = descriptorObj;
@@ -833,6 +1375,7 @@ bool ImageInfo::writeToFile()
             ordered_json tempRegionObj;
             tempRegionObj["type"] = iRegionInfo.type;
             tempRegionObj["base"] = iRegionInfo.base;
+            tempRegionObj["offset"] = iRegionInfo.offset;
             tempRegionObj["size"] = iRegionInfo.size;
             regionsArr.push_back(tempRegionObj);
         }
@@ -844,7 +1387,7 @@ bool ImageInfo::writeToFile()
     {
         ordered_json uefiImageObj;
         uefiImageObj["base"] = infoUefiImage.base;
-        uefiImageObj["sizeFullImage"] = infoUefiImage.size;
+        uefiImageObj["size"] = infoUefiImage.size;
         imageMainJsonObj["uefi_image"] = uefiImageObj;
     }
 
@@ -853,6 +1396,18 @@ bool ImageInfo::writeToFile()
         imageMainJsonObj["boot_guard"] = infoBootGuard;
     }
 
+    ordered_json volumesArr = ordered_json::array();
+    for (const INFO_VOLUME& iVolume : vInfoVolume)
+    {
+        ordered_json tempVolumeObj;
+        tempVolumeObj["name"] = iVolume.name;
+        tempVolumeObj["base"] = iVolume.base;
+        tempVolumeObj["size"] = iVolume.size;
+        tempVolumeObj["hash"] = iVolume.hash;
+        volumesArr.push_back(tempVolumeObj);
+    }
+    imageMainJsonObj["volumes"] = volumesArr;
+
     ordered_json peimArr = ordered_json::array();
     ordered_json dxedArr = ordered_json::array();
     ordered_json peiCoreArr = ordered_json::array();
@@ -869,6 +1424,7 @@ bool ImageInfo::writeToFile()
         tempObj["size"] = iInfoFile.size;
         tempObj["headerChecksum"] = iInfoFile.headerChecksum;
         tempObj["dataChecksum"] = iInfoFile.dataChecksum;
+        tempObj["hash"] = iInfoFile.hash;
         switch (iInfoFile.type)
         {
         case EFI_FV_FILETYPE_PEIM:
@@ -894,9 +1450,6 @@ bool ImageInfo::writeToFile()
         imageMainJsonObj["dxe_core"] = dxeCoreArr;
     if (!dxedArr.empty())
         imageMainJsonObj["dxe_drivers"] = dxedArr;
-
-    outputFile << std::setw(4) << imageMainJsonObj;
-    return true;
 }
 
 
@@ -4,6 +4,7 @@
 #include "common/treemodel.h"
 #include "common/ffsparser.h"
 #include "common/descriptor.h"
+#include "reportstore.h"
 
 #define OUTPUT_MODE_DESCRIPTION 1
 #define OUTPUT_MODE_CAPSULE 2
@@ -16,6 +17,13 @@
 #define OUTPUT_MODE_BG 128
 #define OUTPUT_MODE_FULL 1023
 
+// Parse "x1,x2,x3,..." list of output modes as used by --outputmode option
+UINT16 outputModeFromString(const std::string& outputModeStr);
+
+// Bumped when names or meaning of fields in compare mode JSON change
+#define DIFF_REPORT_VERSION 1
+#define NVRAM_DIFF_REPORT_VERSION 1
+
 #define HexAndDecView(value) std::hex << value << "h (" <<std::dec << value << ")"
 #define HexView(value) std::hex << value << "h"
 
@@ -48,7 +56,7 @@ struct INFO_INTEL_IMAGE_DESCRIPTOR {
     UINT32 size;
     union
     {
-        struct MASTER_SECTION {
+        struct {
             UINT8 BiosRead;
             UINT8 BiosWrite;
             UINT8 MeRead;
@@ -57,7 +65,7 @@ struct INFO_INTEL_IMAGE_DESCRIPTOR {
             UINT8 GbeWrite;
         } masterSection;
 
-        struct MASTER_SECTION_V2 {
+        struct {
             UINT32 BiosRead : 12;
             UINT32 BiosWrite : 12;
             UINT32 MeRead : 12;
@@ -90,6 +98,15 @@ struct INFO_FILE
     UINT32 size;
     std::string headerChecksum;
     std::string dataChecksum;
+    std::string hash;
+};
+
+struct INFO_VOLUME
+{
+    std::string name;
+    UINT32 base;
+    UINT32 size;
+    std::string hash;   // Equal hashes mean equal volumes, also across images
 };
 
 
@@ -97,30 +114,76 @@ class ImageInfo
 {
 public:
     ImageInfo(UByteArray& inputBuffer);
+    // GUID names are taken from guidDatabase instead of currentGuidDatabase(), it must outlive the object
+    ImageInfo(UByteArray& inputBuffer, const GuidNameDatabase& guidDatabase);
+    // Restore results from report without image data, throws nlohmann::json::exception on damaged report
+    ImageInfo(nlohmann::ordered_json& report);
     ~ImageInfo() {};
     void calculateBufferCRC();
     
     USTATUS explore();
     USTATUS exploreTopSections(const UModelIndex& index);
     USTATUS exploreFileTypeRecursive(const UModelIndex& index);
+    INFO_VOLUME parseVolume(const UModelIndex& index);
 
     USTATUS parseCapsule(const UModelIndex& index);
     USTATUS parseIntelImage(const UModelIndex& index);
     USTATUS parseUefiImage(const UModelIndex& index);
     INFO_FILE parseFileType(const UModelIndex& index);
 
-    USTATUS compareWithAnother(ImageInfo& anotherImage);
+    // Prints structural differences, old image is this one. Non-empty reportPath gets them as JSON
+    USTATUS compareWithAnother(ImageInfo& anotherImage, const std::string& reportPath = std::string());
+
+    // Prints all instances of NVRAM variables of explored image matching query,
+    // which is "GUID:Name", "Name" for any vendor or "*" for all variables
+    USTATUS nvramQueryOutput(std::ostream& outputStream, const std::string& query) const;
+
+    // Prints NVRAM variables added, removed, changed and duplicated in another image, old image is this one.
+    // Images are explored when needed, non-empty reportPath gets the differences as JSON
+    USTATUS nvramDiffOutput(ImageInfo& anotherImage, std::ostream& outputStream, const std::string& reportPath = std::string());
+
+    // Prints hash checks of modules of every ME partition of explored image,
+    // results are taken from metadata hashes listed in manifests and module hashes listed in metadata
+    USTATUS meHashesOutput(std::ostream& outputStream) const;
 
     USTATUS checkProtectedRegions();
 
     void printSecurityInfo();
 
-    void infoOutput(std::ostream& outputStream, UINT16 mode);
-    bool readFromFile();
-    bool writeToFile();
+    void infoOutput(std::ostream& outputStream, UINT16 mode) const;
+    bool readFromFile(ReportStore& reportStore);
+    bool writeToFile(ReportStore& reportStore);
+    void toJson(nlohmann::ordered_json& imageMainJsonObj) const;
+
+    // Progress messages go to std::cout by default
+    void setLogStream(std::ostream& stream) { logStream = &stream; }
+
+    UINT32 getCrc() const { return crc; }
+    UINT32 getSizeFullFile() const { return sizeFullFile; }
+    UINT32 getSizeFullImage() const { return sizeFullImage; }
+    bool hasCapsule() const { return isCapsule; }
+    bool hasIntelImage() const { return isIntelImage; }
+    bool hasBootGuard() const { return isBootGuard; }
+    size_t getFilesCount() const { return vInfoFile.size(); }
+    const INFO_CAPSULE& getCapsuleInfo() const { return infoCapsule; }
+    const INFO_UEFI_IMAGE& getUefiImageInfo() const { return infoUefiImage; }
+    const INFO_INTEL_IMAGE& getIntelImageInfo() const { return infoIntelImage; }
+    const std::vector<INFO_FILE>& getFiles() const { return vInfoFile; }
+    const std::vector<INFO_VOLUME>& getVolumes() const { return vInfoVolume; }
+    const std::string& getTreeHash() const { return treeHash; }
+    const std::string& getBootGuardInfo() const { return infoBootGuard; }
+    std::vector<std::pair<UString, UModelIndex> > getParserMessages() const { return ffsParser.getMessages(); }
+    // Views of variable data point into the parse tree of this object
+    const NvramIndex& getNvramIndex() const { return ffsParser.getNvramIndex(); }
 
 private:
+    // Non-owning guidDatabase is passed with empty owner
+    ImageInfo(UByteArray& inputBuffer, std::shared_ptr<const GuidNameDatabase> guidDatabase);
+    void resetInfo();
+    void readFromJson(nlohmann::ordered_json& imageMainJsonObj);
+
     UByteArray openedImage;
+    std::shared_ptr<const GuidNameDatabase> guidNames;
     TreeModel model;
     FfsParser ffsParser;
 
@@ -136,7 +199,11 @@ private:
     INFO_UEFI_IMAGE infoUefiImage;
     INFO_INTEL_IMAGE infoIntelImage;
     std::vector<INFO_FILE> vInfoFile;
+    std::vector<INFO_VOLUME> vInfoVolume;
     std::string infoBootGuard;
+    std::string treeHash;   // Merkle hash of the whole parse tree
+
+    std::ostream* logStream;
 };
 
 #endif // !IMAGEINFO_H
\ No newline at end of file
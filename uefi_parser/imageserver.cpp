@@ -0,0 +1,713 @@
+#include "imageserver.h"
+#include "utilities.h"
+#include "common/filesystem.h"
+#include "common/parsertrace.h"
+#include "common/utility.h"
+
+#include "nlohmann/json.hpp"
+using ordered_json = nlohmann::ordered_json;
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifndef WIN32
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+
+#ifndef WIN32
+static volatile sig_atomic_t serverSignalled = 0;
+
+static void serverSignalHandler(int)
+{
+    serverSignalled = 1;
+}
+
+static bool readAll(int fd, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t got = recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        data += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, data, size, 0);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool readFrame(int fd, std::string& payload)
+{
+    UINT8 header[4];
+    if (!readAll(fd, (char*)header, sizeof(header)))
+        return false;
+    UINT32 size = header[0] | (header[1] << 8) | (header[2] << 16) | ((UINT32)header[3] << 24);
+    if (size > SERVER_MAX_FRAME_SIZE)
+        return false;
+    payload.resize(size);
+    return size == 0 || readAll(fd, &payload[0], size);
+}
+
+bool writeFrame(int fd, const std::string& payload)
+{
+    if (payload.size() > SERVER_MAX_FRAME_SIZE)
+        return false;
+    UINT32 size = (UINT32)payload.size();
+    UINT8 header[4] = { (UINT8)size, (UINT8)(size >> 8), (UINT8)(size >> 16), (UINT8)(size >> 24) };
+    return writeAll(fd, (const char*)header, sizeof(header)) && writeAll(fd, payload.data(), payload.size());
+}
+
+static bool makeSocketAddress(const std::string& socketPath, struct sockaddr_un& address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+        return false;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    return true;
+}
+
+static int connectSocket(const std::string& socketPath)
+{
+    struct sockaddr_un address;
+    if (!makeSocketAddress(socketPath, address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#else
+bool readFrame(int fd, std::string& payload)
+{
+    U_UNUSED_PARAMETER(fd);
+    U_UNUSED_PARAMETER(payload);
+    return false;
+}
+
+bool writeFrame(int fd, const std::string& payload)
+{
+    U_UNUSED_PARAMETER(fd);
+    U_UNUSED_PARAMETER(payload);
+    return false;
+}
+#endif
+
+static std::string statusToString(USTATUS status)
+{
+    return std::string(errorCodeToUString(status).toLocal8Bit());
+}
+
+ImageServer::ImageServer(ReportStore& store, UINT32 cacheEntries) : reportStore(store), limitEntries(cacheEntries), stopping(false)
+{
+    if (limitEntries == 0)
+        limitEntries = 1;
+    stats = SERVER_STATS();
+};
+
+ImageServer::~ImageServer()
+{
+    reapConnections(true);
+};
+
+std::shared_ptr<const ImageInfo> ImageServer::cacheGet(UINT32 crc)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<UINT32, CACHE_ENTRY>::iterator found = cache.find(crc);
+    if (found == cache.end())
+        return std::shared_ptr<const ImageInfo>();
+    cacheOrder.splice(cacheOrder.begin(), cacheOrder, found->second.order);
+    return found->second.info;
+}
+
+void ImageServer::cachePut(UINT32 crc, const std::shared_ptr<const ImageInfo>& info)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<UINT32, CACHE_ENTRY>::iterator found = cache.find(crc);
+    if (found != cache.end())
+    {
+        found->second.info = info;
+        cacheOrder.splice(cacheOrder.begin(), cacheOrder, found->second.order);
+        return;
+    }
+    cacheOrder.push_front(crc);
+    CACHE_ENTRY entry;
+    entry.info = info;
+    entry.order = cacheOrder.begin();
+    cache[crc] = entry;
+    while (cache.size() > limitEntries)
+    {
+        cache.erase(cacheOrder.back());
+        cacheOrder.pop_back();
+    }
+}
+
+void ImageServer::countRequest(const std::string& source, USTATUS status)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.requests++;
+    if (status != U_SUCCESS)
+        stats.errors++;
+    if (source == "memory")
+        stats.memoryHits++;
+    else if (source == "report")
+        stats.reportHits++;
+    else if (source == "parsed")
+        stats.parsed++;
+}
+
+std::shared_ptr<const ImageInfo> ImageServer::findByCrc(UINT32 crc, std::string& source, USTATUS& status)
+{
+    std::shared_ptr<const ImageInfo> info = cacheGet(crc);
+    if (info)
+    {
+        source = "memory";
+        return info;
+    }
+
+    ordered_json report;
+    if (!reportStore.load(crc, report))
+    {
+        status = U_ITEM_NOT_FOUND;
+        return info;
+    }
+    try
+    {
+        info = std::make_shared<const ImageInfo>(report);
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        reportStore.invalidate(crc);
+        status = U_ITEM_NOT_FOUND;
+        return std::shared_ptr<const ImageInfo>();
+    }
+    source = "report";
+    cachePut(crc, info);
+    return info;
+}
+
+std::shared_ptr<const ImageInfo> ImageServer::findByPath(const std::string& path, UINT32& crc, std::string& source, USTATUS& status)
+{
+#ifndef WIN32
+    std::string absPath(getAbsPath(UString(path.c_str())).toLocal8Bit());
+    struct stat fileStat;
+    if (stat(absPath.c_str(), &fileStat) != 0)
+    {
+        status = U_FILE_OPEN;
+        return std::shared_ptr<const ImageInfo>();
+    }
+    SERVER_PATH_ENTRY pathEntry;
+    pathEntry.size = (UINT64)fileStat.st_size;
+    pathEntry.modified = (INT64)fileStat.st_mtime;
+    pathEntry.inode = (UINT64)fileStat.st_ino;
+    pathEntry.crc = 0;
+
+    // Unchanged file seen before, no need to read it
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, SERVER_PATH_ENTRY>::const_iterator found = paths.find(absPath);
+        if (found != paths.end() && found->second.size == pathEntry.size
+            && found->second.modified == pathEntry.modified && found->second.inode == pathEntry.inode)
+        {
+            known = true;
+            crc = found->second.crc;
+        }
+    }
+    if (known)
+    {
+        std::shared_ptr<const ImageInfo> info = cacheGet(crc);
+        if (info)
+        {
+            source = "memory";
+            return info;
+        }
+    }
+
+    UByteArray buffer;
+    status = readFileIntoBuffer(UString(absPath.c_str()), buffer);
+    if (status)
+        return std::shared_ptr<const ImageInfo>();
+
+    std::ostream nullStream(NULL);
+    ImageInfo imageInfo(buffer);
+    imageInfo.setLogStream(nullStream);
+    crc = imageInfo.getCrc();
+    pathEntry.crc = crc;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paths[absPath] = pathEntry;
+    }
+
+    // Same content may be already known under another path
+    std::shared_ptr<const ImageInfo> info = cacheGet(crc);
+    if (info)
+    {
+        source = "memory";
+        return info;
+    }
+
+    if (imageInfo.readFromFile(reportStore))
+        source = "report";
+    else
+    {
+        // Failed parse is neither stored nor cached, the error goes to the client
+        status = imageInfo.explore();
+        if (status)
+            return std::shared_ptr<const ImageInfo>();
+        imageInfo.writeToFile(reportStore);
+        source = "parsed";
+    }
+
+    // Keep only results, image data and parsed tree are released here
+    ordered_json report;
+    imageInfo.toJson(report);
+    info = std::make_shared<const ImageInfo>(report);
+    cachePut(crc, info);
+    return info;
+#else
+    U_UNUSED_PARAMETER(path);
+    U_UNUSED_PARAMETER(crc);
+    U_UNUSED_PARAMETER(source);
+    status = U_NOT_IMPLEMENTED;
+    return std::shared_ptr<const ImageInfo>();
+#endif
+}
+
+std::string ImageServer::handleRequest(const std::string& payload)
+{
+    ordered_json responseObj;
+    ordered_json requestObj;
+    try
+    {
+        requestObj = ordered_json::parse(payload);
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        countRequest(std::string(), U_INVALID_PARAMETER);
+        responseObj["status"] = statusToString(U_INVALID_PARAMETER);
+        responseObj["error"] = "Request is not valid JSON";
+        return responseObj.dump();
+    }
+
+    if (!requestObj.is_object()
+        || (requestObj.contains("command") && !requestObj["command"].is_string())
+        || (requestObj.contains("mode") && !requestObj["mode"].is_string()))
+    {
+        countRequest(std::string(), U_INVALID_PARAMETER);
+        responseObj["status"] = statusToString(U_INVALID_PARAMETER);
+        responseObj["error"] = "Request is not a valid command object";
+        return responseObj.dump();
+    }
+
+    std::string command = requestObj.value("command", std::string("info"));
+    if (command == "shutdown")
+    {
+        stopping = true;
+        responseObj["status"] = statusToString(U_SUCCESS);
+        return responseObj.dump();
+    }
+
+    if (command == "stats")
+    {
+        SERVER_STATS serverStats = getStats();
+        REPORT_STORE_STATS storeStats = reportStore.getStats();
+        ordered_json serverObj, storeObj;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            serverObj["cacheEntries"] = cache.size();
+            serverObj["cacheLimit"] = limitEntries;
+            serverObj["knownPaths"] = paths.size();
+        }
+        serverObj["requests"] = serverStats.requests;
+        serverObj["memoryHits"] = serverStats.memoryHits;
+        serverObj["reportHits"] = serverStats.reportHits;
+        serverObj["parsed"] = serverStats.parsed;
+        serverObj["errors"] = serverStats.errors;
+        storeObj["reports"] = reportStore.entryCount();
+        storeObj["size"] = reportStore.totalSize();
+        storeObj["hits"] = storeStats.hits;
+        storeObj["misses"] = storeStats.misses;
+        storeObj["writes"] = storeStats.writes;
+        storeObj["evictions"] = storeStats.evictions;
+        storeObj["invalidations"] = storeStats.invalidations;
+        responseObj["status"] = statusToString(U_SUCCESS);
+        responseObj["server"] = serverObj;
+        responseObj["reportStore"] = storeObj;
+        return responseObj.dump();
+    }
+
+    if (command != "info")
+    {
+        countRequest(std::string(), U_INVALID_PARAMETER);
+        responseObj["status"] = statusToString(U_INVALID_PARAMETER);
+        responseObj["error"] = "Unknown command \"" + command + "\"";
+        return responseObj.dump();
+    }
+
+    USTATUS status = U_SUCCESS;
+    std::string source;
+    UINT32 crc = 0;
+    std::shared_ptr<const ImageInfo> info;
+    std::string modeStr = requestObj.value("mode", std::string("desc"));
+    if (requestObj.contains("crc") && requestObj["crc"].is_number_unsigned())
+    {
+        if (requestObj["crc"].get<UINT64>() > 0xFFFFFFFFULL)
+        {
+            countRequest(std::string(), U_INVALID_PARAMETER);
+            responseObj["status"] = statusToString(U_INVALID_PARAMETER);
+            responseObj["error"] = "CRC is not a 32-bit value";
+            return responseObj.dump();
+        }
+        crc = requestObj["crc"].get<UINT32>();
+        info = findByCrc(crc, source, status);
+    }
+    else if (requestObj.contains("path") && requestObj["path"].is_string())
+        info = findByPath(requestObj["path"].get<std::string>(), crc, source, status);
+    else
+        status = U_INVALID_PARAMETER;
+
+    countRequest(source, status);
+    responseObj["status"] = statusToString(status);
+    if (info)
+    {
+        std::stringstream output;
+        info->infoOutput(output, outputModeFromString(modeStr));
+        responseObj["crc"] = crc;
+        responseObj["source"] = source;
+        responseObj["output"] = output.str();
+    }
+    return responseObj.dump();
+}
+
+void ImageServer::handleConnection(CONNECTION* connection)
+{
+    traceSetThreadName("Connection " + std::to_string(connection->fd));
+    std::string payload;
+    while (!stopping && readFrame(connection->fd, payload))
+    {
+        if (!writeFrame(connection->fd, handleRequest(payload)))
+            break;
+    }
+    connection->done = true;
+}
+
+void ImageServer::reapConnections(bool closeAll)
+{
+#ifndef WIN32
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    std::list<std::unique_ptr<CONNECTION> >::iterator it = connections.begin();
+    while (it != connections.end())
+    {
+        CONNECTION* connection = it->get();
+        if (!closeAll && !connection->done)
+        {
+            ++it;
+            continue;
+        }
+        // Wakes up the thread waiting for the next request
+        if (!connection->done)
+            shutdown(connection->fd, SHUT_RDWR);
+        connection->thread.join();
+        close(connection->fd);
+        it = connections.erase(it);
+    }
+#else
+    U_UNUSED_PARAMETER(closeAll);
+#endif
+}
+
+USTATUS ImageServer::serve(const std::string& socketPath)
+{
+#ifndef WIN32
+    struct sockaddr_un address;
+    if (!makeSocketAddress(socketPath, address))
+    {
+        std::cout << "Error of socket path \"" << socketPath << "\", it is empty or too long." << std::endl;
+        return U_INVALID_PARAMETER;
+    }
+
+    // Remove socket left by a stopped server, but never take over a running one
+    struct stat socketStat;
+    if (stat(socketPath.c_str(), &socketStat) == 0)
+    {
+        if (!S_ISSOCK(socketStat.st_mode))
+        {
+            std::cout << "Error of socket path \"" << socketPath << "\", file already exists." << std::endl;
+            return U_FILE_OPEN;
+        }
+        int probe = connectSocket(socketPath);
+        if (probe >= 0)
+        {
+            close(probe);
+            std::cout << "Error of starting server, another one is listening on \"" << socketPath << "\"." << std::endl;
+            return U_FILE_OPEN;
+        }
+        unlink(socketPath.c_str());
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        return U_FILE_OPEN;
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, SOMAXCONN) != 0)
+    {
+        std::cout << "Error of listening on \"" << socketPath << "\": " << strerror(errno) << std::endl;
+        close(listenFd);
+        return U_FILE_OPEN;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, serverSignalHandler);
+    signal(SIGTERM, serverSignalHandler);
+    serverSignalled = 0;
+    stopping = false;
+    std::cout << "Listening on \"" << socketPath << "\"." << std::endl;
+
+    while (!stopping && !serverSignalled)
+    {
+        // Poll with timeout to notice shutdown request and signals
+        struct pollfd pollFd;
+        pollFd.fd = listenFd;
+        pollFd.events = POLLIN;
+        pollFd.revents = 0;
+        int ready = poll(&pollFd, 1, 200);
+        reapConnections(false);
+        if (ready <= 0)
+            continue;
+
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        std::unique_ptr<CONNECTION> connection(new CONNECTION());
+        connection->fd = fd;
+        connection->done = false;
+        CONNECTION* connectionPtr = connection.get();
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.push_back(std::move(connection));
+        connectionPtr->thread = std::thread(&ImageServer::handleConnection, this, connectionPtr);
+    }
+
+    stopping = true;
+    close(listenFd);
+    unlink(socketPath.c_str());
+    reapConnections(true);
+    reportStore.flush();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    std::cout << "Server stopped." << std::endl;
+    return U_SUCCESS;
+#else
+    U_UNUSED_PARAMETER(socketPath);
+    std::cout << "Server mode is not supported on this platform." << std::endl;
+    return U_NOT_IMPLEMENTED;
+#endif
+}
+
+void ImageServer::statsOutput(std::ostream& outputStream) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    outputStream << "Server statistics:" << std::endl;
+    outputStream << "   -Requests: " << stats.requests << std::endl;
+    outputStream << "   -Memory hits: " << stats.memoryHits << std::endl;
+    outputStream << "   -Report hits: " << stats.reportHits << std::endl;
+    outputStream << "   -Parsed: " << stats.parsed << std::endl;
+    outputStream << "   -Errors: " << stats.errors << std::endl;
+    outputStream << "   -Cached results: " << cache.size() << " (limit " << limitEntries << ")" << std::endl << std::endl;
+}
+
+/******************************************BENCHMARK******************************************/
+#ifndef WIN32
+struct BENCH_PHASE_RESULT
+{
+    std::vector<double> latenciesMs;
+    UINT64 errors;
+    std::map<std::string, UINT64> sources;
+    double wallTimeMs;
+};
+
+static bool benchRequest(int fd, const ordered_json& requestObj, BENCH_PHASE_RESULT& result, UINT32* crc)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::string payload;
+    bool sent = writeFrame(fd, requestObj.dump()) && readFrame(fd, payload);
+    result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    if (!sent)
+    {
+        result.errors++;
+        return false;
+    }
+    try
+    {
+        ordered_json responseObj = ordered_json::parse(payload);
+        if (responseObj["status"].get<std::string>() != statusToString(U_SUCCESS))
+            result.errors++;
+        if (responseObj.contains("source"))
+            result.sources[responseObj["source"].get<std::string>()]++;
+        if (crc && responseObj.contains("crc"))
+        {
+            // CRC that doesn't fit is an error, not a request for another image
+            if (!responseObj["crc"].is_number_unsigned() || responseObj["crc"].get<UINT64>() > 0xFFFFFFFFULL)
+                result.errors++;
+            else
+                *crc = responseObj["crc"].get<UINT32>();
+        }
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        result.errors++;
+    }
+    return true;
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t index = (size_t)(fraction * sorted.size());
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void addPhaseRow(VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string>& table,
+    const std::string& name, BENCH_PHASE_RESULT& result)
+{
+    std::sort(result.latenciesMs.begin(), result.latenciesMs.end());
+    std::stringstream p50, p90, p99, maximum, rate, sources;
+    p50 << std::fixed << std::setprecision(3) << percentile(result.latenciesMs, 0.50);
+    p90 << std::fixed << std::setprecision(3) << percentile(result.latenciesMs, 0.90);
+    p99 << std::fixed << std::setprecision(3) << percentile(result.latenciesMs, 0.99);
+    maximum << std::fixed << std::setprecision(3) << (result.latenciesMs.empty() ? 0.0 : result.latenciesMs.back());
+    rate << std::fixed << std::setprecision(1) << (result.wallTimeMs > 0 ? result.latenciesMs.size() * 1000.0 / result.wallTimeMs : 0.0);
+    for (std::map<std::string, UINT64>::const_iterator it = result.sources.begin(); it != result.sources.end(); ++it)
+        sources << (it == result.sources.begin() ? "" : " ") << it->first << ":" << it->second;
+    table.addRow(name, std::to_string(result.latenciesMs.size()) + "/" + std::to_string(result.errors),
+        p50.str(), p90.str(), p99.str(), maximum.str(), rate.str(), sources.str());
+}
+#endif
+
+USTATUS runServerBenchmark(const std::string& socketPath, const std::vector<std::string>& inputs,
+    UINT32 clients, UINT32 requests, const std::string& outputModeStr, bool byHash, std::ostream& outputStream)
+{
+#ifndef WIN32
+    if (inputs.empty())
+        return U_INVALID_PARAMETER;
+    if (clients == 0)
+        clients = 1;
+    signal(SIGPIPE, SIG_IGN);
+
+    // Warm up, every image once from one client, also collects content hashes
+    BENCH_PHASE_RESULT warmup;
+    warmup.errors = 0;
+    std::vector<UINT32> crcs(inputs.size(), 0);
+    int fd = connectSocket(socketPath);
+    if (fd < 0)
+    {
+        outputStream << "Error of connecting to server on \"" << socketPath << "\"." << std::endl;
+        return U_FILE_OPEN;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        ordered_json requestObj;
+        requestObj["command"] = "info";
+        requestObj["path"] = std::string(getAbsPath(UString(inputs[i].c_str())).toLocal8Bit());
+        requestObj["mode"] = outputModeStr;
+        if (!benchRequest(fd, requestObj, warmup, &crcs[i]))
+            break;
+    }
+    warmup.wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    close(fd);
+
+    // Load, concurrent clients with own connections share request counter
+    std::vector<BENCH_PHASE_RESULT> clientResults(clients);
+    std::atomic<UINT32> next(0);
+    std::vector<std::thread> threads;
+    start = std::chrono::steady_clock::now();
+    for (UINT32 c = 0; c < clients; c++)
+    {
+        threads.push_back(std::thread([&, c] {
+            BENCH_PHASE_RESULT& result = clientResults[c];
+            result.errors = 0;
+            int clientFd = connectSocket(socketPath);
+            if (clientFd < 0)
+            {
+                result.errors++;
+                return;
+            }
+            for (UINT32 i = next++; i < requests; i = next++)
+            {
+                size_t image = i % inputs.size();
+                ordered_json requestObj;
+                requestObj["command"] = "info";
+                if (byHash)
+                    requestObj["crc"] = crcs[image];
+                else
+                    requestObj["path"] = std::string(getAbsPath(UString(inputs[image].c_str())).toLocal8Bit());
+                requestObj["mode"] = outputModeStr;
+                if (!benchRequest(clientFd, requestObj, result, NULL))
+                    break;
+            }
+            close(clientFd);
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    BENCH_PHASE_RESULT load;
+    load.errors = 0;
+    load.wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (size_t c = 0; c < clientResults.size(); c++)
+    {
+        load.latenciesMs.insert(load.latenciesMs.end(), clientResults[c].latenciesMs.begin(), clientResults[c].latenciesMs.end());
+        load.errors += clientResults[c].errors;
+        for (std::map<std::string, UINT64>::const_iterator it = clientResults[c].sources.begin(); it != clientResults[c].sources.end(); ++it)
+            load.sources[it->first] += it->second;
+    }
+
+    VariadicTable<std::string, std::string, std::string, std::string, std::string, std::string, std::string, std::string>
+        tableBench({ "Phase", "Requests/errors", "p50 ms", "p90 ms", "p99 ms", "Max ms", "Req/s", "Sources" });
+    addPhaseRow(tableBench, "warm-up", warmup);
+    addPhaseRow(tableBench, std::string(byHash ? "hash" : "path") + " x" + std::to_string(clients), load);
+    tableBench.print(outputStream, "Server benchmark");
+    return (warmup.errors || load.errors) ? U_INVALID_PARAMETER : U_SUCCESS;
+#else
+    U_UNUSED_PARAMETER(socketPath);
+    U_UNUSED_PARAMETER(inputs);
+    U_UNUSED_PARAMETER(clients);
+    U_UNUSED_PARAMETER(requests);
+    U_UNUSED_PARAMETER(outputModeStr);
+    U_UNUSED_PARAMETER(byHash);
+    outputStream << "Server mode is not supported on this platform." << std::endl;
+    return U_NOT_IMPLEMENTED;
+#endif
+}
@@ -0,0 +1,110 @@
+#ifndef IMAGESERVER_H
+#define IMAGESERVER_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "common/basetypes.h"
+#include "imageinfo.h"
+#include "reportstore.h"
+
+#define SERVER_DEFAULT_SOCKET "uefi_parser.sock"
+#define SERVER_DEFAULT_CACHE_ENTRIES 256
+#define SERVER_MAX_FRAME_SIZE (16 * 1024 * 1024)
+
+// Protocol: every message in both directions is a frame of 4-byte little-endian
+// payload length followed by JSON payload. Requests:
+//   {"command": "info", "path": "image.bin", "mode": "desc,bg"}
+//   {"command": "info", "crc": 305419896, "mode": "all"}
+//   {"command": "stats"}
+//   {"command": "shutdown"}
+// Responses carry "status" (errorCodeToUString text, "Success" on success),
+// info responses also "crc", "source" ("memory", "report" or "parsed") and "output".
+bool readFrame(int fd, std::string& payload);
+bool writeFrame(int fd, const std::string& payload);
+
+struct SERVER_STATS
+{
+    UINT64 requests;
+    UINT64 memoryHits;
+    UINT64 reportHits;
+    UINT64 parsed;
+    UINT64 errors;
+};
+
+// Identity of a file on disk, path lookups skip reading the image while it stays unchanged
+struct SERVER_PATH_ENTRY
+{
+    UINT64 size;
+    INT64 modified;
+    UINT64 inode;
+    UINT32 crc;
+};
+
+// Daemon answering image queries over a local Unix socket. GUID database, report store
+// and an in-memory LRU of parsed results stay warm between requests.
+// Every client connection is served by its own thread until it disconnects.
+class ImageServer
+{
+public:
+    ImageServer(ReportStore& store, UINT32 cacheEntries);
+    ~ImageServer();
+
+    // Blocks until "shutdown" request, SIGINT or SIGTERM
+    USTATUS serve(const std::string& socketPath);
+
+    SERVER_STATS getStats() const { std::lock_guard<std::mutex> lock(mutex); return stats; }
+    void statsOutput(std::ostream& outputStream) const;
+
+private:
+    struct CACHE_ENTRY
+    {
+        std::shared_ptr<const ImageInfo> info;
+        std::list<UINT32>::iterator order;
+    };
+
+    struct CONNECTION
+    {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done;
+    };
+
+    ReportStore& reportStore;
+    UINT32 limitEntries;
+
+    std::unordered_map<UINT32, CACHE_ENTRY> cache;
+    std::list<UINT32> cacheOrder;
+    std::map<std::string, SERVER_PATH_ENTRY> paths;
+    SERVER_STATS stats;
+    mutable std::mutex mutex;
+
+    std::list<std::unique_ptr<CONNECTION> > connections;
+    std::mutex connectionsMutex;
+    std::atomic<bool> stopping;
+
+    void handleConnection(CONNECTION* connection);
+    void reapConnections(bool closeAll);
+    std::string handleRequest(const std::string& payload);
+
+    std::shared_ptr<const ImageInfo> findByPath(const std::string& path, UINT32& crc, std::string& source, USTATUS& status);
+    std::shared_ptr<const ImageInfo> findByCrc(UINT32 crc, std::string& source, USTATUS& status);
+    std::shared_ptr<const ImageInfo> cacheGet(UINT32 crc);
+    void cachePut(UINT32 crc, const std::shared_ptr<const ImageInfo>& info);
+    void countRequest(const std::string& source, USTATUS status);
+};
+
+// Load generator for a running server: queries every input once to warm the server up,
+// then sends requests from concurrent clients and prints latency percentiles and throughput
+USTATUS runServerBenchmark(const std::string& socketPath, const std::vector<std::string>& inputs,
+    UINT32 clients, UINT32 requests, const std::string& outputModeStr, bool byHash, std::ostream& outputStream);
+
+#endif // !IMAGESERVER_H
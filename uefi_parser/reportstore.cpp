@@ -0,0 +1,309 @@
+#include "reportstore.h"
+#include "common/filesystem.h"
+
+using ordered_json = nlohmann::ordered_json;
+
+#include <iomanip>
+#include <vector>
+#include <cstring>
+
+#ifdef WIN32
+#include <process.h>
+#define currentProcessId _getpid
+#else
+#include <unistd.h>
+#define currentProcessId getpid
+#endif
+
+
+ReportStore::ReportStore(const UString& dirPath, UINT32 maxEntries, UINT64 maxSize)
+    : dir(dirPath), limitEntries(maxEntries), limitSize(maxSize), sizeTotal(0), clock(0), dirty(false)
+{
+    memset(&stats, 0, sizeof(stats));
+    loadIndex();
+};
+
+ReportStore::~ReportStore()
+{
+    flush();
+};
+
+UString ReportStore::reportPath(UINT32 crc) const
+{
+    return dir + usprintf("/report_%u.json", crc);
+}
+
+UString ReportStore::indexPath() const
+{
+    return dir + UString("/") + UString(REPORT_STORE_INDEX_FILE);
+}
+
+void ReportStore::loadIndex()
+{
+    if (!isExistOnFs(dir))
+        return;
+
+    std::ifstream inputFile(indexPath().toLocal8Bit(), std::ios::in);
+    if (inputFile)
+    {
+        try
+        {
+            ordered_json indexObj;
+            inputFile >> indexObj;
+            clock = indexObj["clock"].get<UINT64>();
+            ordered_json statsObj = indexObj["stats"];
+            stats.hits = statsObj["hits"].get<UINT64>();
+            stats.misses = statsObj["misses"].get<UINT64>();
+            stats.writes = statsObj["writes"].get<UINT64>();
+            stats.evictions = statsObj["evictions"].get<UINT64>();
+            stats.invalidations = statsObj["invalidations"].get<UINT64>();
+            for (ordered_json iEntryObj : indexObj["reports"])
+            {
+                REPORT_STORE_ENTRY entry;
+                entry.size = iEntryObj["size"].get<UINT64>();
+                entry.lastAccess = iEntryObj["lastAccess"].get<UINT64>();
+                entry.schemaVersion = iEntryObj["schemaVersion"].get<UINT32>();
+                entries[iEntryObj["crc"].get<UINT32>()] = entry;
+            }
+        }
+        catch (const nlohmann::json::exception&)
+        {
+            // Broken index, all reports will be treated as untracked
+            entries.clear();
+        }
+        inputFile.close();
+    }
+
+    // Drop reports of another schema and entries without report file
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        auto current = it++;
+        if (current->second.schemaVersion != REPORT_SCHEMA_VERSION)
+        {
+            stats.invalidations++;
+            removeEntry(current);
+        }
+        else if (!isExistOnFs(reportPath(current->first)))
+        {
+            entries.erase(current);
+            dirty = true;
+        }
+        else
+            sizeTotal += current->second.size;
+    }
+
+    // Reports absent in index were written by a run that ended before flush or by another process
+    // sharing the directory, they are adopted as least recently used. Schema is checked on load
+    std::vector<UString> names;
+    listDirectory(dir, names);
+    for (const UString& name : names)
+    {
+        UINT32 crc;
+        if (sscanf(name.toLocal8Bit(), "report_%u", &crc) != 1 || name != usprintf("report_%u.json", crc))
+            continue;
+        if (entries.count(crc))
+            continue;
+        REPORT_STORE_ENTRY entry;
+        entry.size = 0;
+        getFileSize(dir + UString("/") + name, entry.size);
+        entry.lastAccess = 0;
+        entry.schemaVersion = REPORT_SCHEMA_VERSION;
+        entries[crc] = entry;
+        sizeTotal += entry.size;
+        dirty = true;
+    }
+
+    evict(false);
+}
+
+bool ReportStore::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeIndex();
+}
+
+bool ReportStore::writeIndex()
+{
+    if (!dirty)
+        return true;
+    if (!isExistOnFs(dir) && !makeDirectory(dir))
+        return false;
+
+    ordered_json indexObj;
+    indexObj["schemaVersion"] = REPORT_SCHEMA_VERSION;
+    indexObj["clock"] = clock;
+
+    ordered_json statsObj;
+    statsObj["hits"] = stats.hits;
+    statsObj["misses"] = stats.misses;
+    statsObj["writes"] = stats.writes;
+    statsObj["evictions"] = stats.evictions;
+    statsObj["invalidations"] = stats.invalidations;
+    indexObj["stats"] = statsObj;
+
+    ordered_json reportsArr = ordered_json::array();
+    for (auto& iEntry : entries)
+    {
+        ordered_json tempEntryObj;
+        tempEntryObj["crc"] = iEntry.first;
+        tempEntryObj["size"] = iEntry.second.size;
+        tempEntryObj["lastAccess"] = iEntry.second.lastAccess;
+        tempEntryObj["schemaVersion"] = iEntry.second.schemaVersion;
+        reportsArr.push_back(tempEntryObj);
+    }
+    indexObj["reports"] = reportsArr;
+
+    // Readers never see partially written index, temporary name is unique per process
+    UString tempPath = indexPath() + usprintf(".%d.tmp", (int)currentProcessId());
+    std::ofstream outputFile(tempPath.toLocal8Bit(), std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return false;
+    outputFile << std::setw(4) << indexObj;
+    outputFile.close();
+    if (!outputFile || !replaceFile(tempPath, indexPath()))
+    {
+        removeFile(tempPath);
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+bool ReportStore::load(UINT32 crc, ordered_json& report)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = entries.find(crc);
+    if (entry == entries.end())
+    {
+        stats.misses++;
+        dirty = true;
+        return false;
+    }
+
+    std::ifstream inputFile(reportPath(crc).toLocal8Bit(), std::ios::in);
+    if (!inputFile)
+    {
+        stats.misses++;
+        removeEntry(entry);
+        return false;
+    }
+
+    try
+    {
+        inputFile >> report;
+        if (!report.contains("schemaVersion") || report["schemaVersion"].get<UINT32>() != REPORT_SCHEMA_VERSION)
+            report = ordered_json();
+    }
+    catch (const nlohmann::json::exception&)
+    {
+        report = ordered_json();
+    }
+    inputFile.close();
+
+    if (report.is_null())
+    {
+        stats.misses++;
+        stats.invalidations++;
+        removeEntry(entry);
+        return false;
+    }
+
+    stats.hits++;
+    entry->second.lastAccess = ++clock;
+    dirty = true;
+    return true;
+}
+
+bool ReportStore::store(UINT32 crc, const ordered_json& report)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!isExistOnFs(dir) && !makeDirectory(dir))
+        return false;
+
+    UString path = reportPath(crc);
+    std::ofstream outputFile(path.toLocal8Bit(), std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return false;
+    outputFile << std::setw(4) << report;
+    outputFile.close();
+
+    REPORT_STORE_ENTRY newEntry;
+    newEntry.size = 0;
+    getFileSize(path, newEntry.size);
+    newEntry.lastAccess = ++clock;
+    newEntry.schemaVersion = REPORT_SCHEMA_VERSION;
+
+    auto entry = entries.find(crc);
+    if (entry != entries.end())
+        sizeTotal -= entry->second.size;
+    entries[crc] = newEntry;
+    sizeTotal += newEntry.size;
+    stats.writes++;
+    dirty = true;
+
+    evict(true);
+    // Index is kept on disk after every write, reports survive runs that end without flush
+    writeIndex();
+    return true;
+}
+
+void ReportStore::invalidate(UINT32 crc)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = entries.find(crc);
+    if (entry == entries.end())
+        return;
+    stats.invalidations++;
+    removeEntry(entry);
+}
+
+void ReportStore::setLimits(UINT32 maxEntries, UINT64 maxSize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    limitEntries = maxEntries;
+    limitSize = maxSize;
+    evict(false);
+}
+
+void ReportStore::removeEntry(std::map<UINT32, REPORT_STORE_ENTRY>::iterator entry)
+{
+    removeFile(reportPath(entry->first));
+    if (entry->second.schemaVersion == REPORT_SCHEMA_VERSION)
+        sizeTotal -= entry->second.size;
+    entries.erase(entry);
+    dirty = true;
+}
+
+void ReportStore::evict(bool keepLatest)
+{
+    // Latest report has the biggest access time, so it goes last and is kept if requested
+    // even when it alone exceeds the limits
+    while ((entries.size() > limitEntries || sizeTotal > limitSize) && entries.size() > (keepLatest ? 1U : 0U))
+    {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->second.lastAccess < oldest->second.lastAccess)
+                oldest = it;
+        }
+        stats.evictions++;
+        removeEntry(oldest);
+    }
+}
+
+void ReportStore::statsOutput(std::ostream& outputStream) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    UINT64 lookups = stats.hits + stats.misses;
+    outputStream << "Report store statistics:" << std::endl;
+    outputStream << "   -Reports: " << entries.size() << " (limit " << limitEntries << ")" << std::endl;
+    outputStream << "   -Size: " << sizeTotal << " bytes (limit " << limitSize << ")" << std::endl;
+    outputStream << "   -Hits: " << stats.hits << std::endl;
+    outputStream << "   -Misses: " << stats.misses << std::endl;
+    outputStream << "   -Hit rate: " << std::fixed << std::setprecision(1)
+        << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "%" << std::endl;
+    outputStream.unsetf(std::ios_base::floatfield);
+    outputStream << "   -Writes: " << stats.writes << std::endl;
+    outputStream << "   -Evictions: " << stats.evictions << std::endl;
+    outputStream << "   -Invalidations: " << stats.invalidations << std::endl << std::endl;
+}
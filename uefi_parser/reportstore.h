@@ -0,0 +1,82 @@
+#ifndef REPORTSTORE_H
+#define REPORTSTORE_H
+
+#include <map>
+#include <mutex>
+#include <ostream>
+
+#include "common/basetypes.h"
+#include "common/ustring.h"
+
+#include "nlohmann/json.hpp"
+
+// Layout version of reports written by ImageInfo::writeToFile.
+// Increase it on every change of report fields or of parse tree contents (tree hashes depend on them),
+// stored reports of other versions are invalidated.
+#define REPORT_SCHEMA_VERSION 5
+
+#define REPORT_STORE_DEFAULT_DIR "reports"
+#define REPORT_STORE_INDEX_FILE "index.json"
+#define REPORT_STORE_DEFAULT_MAX_ENTRIES 1024
+#define REPORT_STORE_DEFAULT_MAX_SIZE (256ULL * 1024 * 1024)
+
+struct REPORT_STORE_ENTRY
+{
+    UINT64 size;
+    UINT64 lastAccess;
+    UINT32 schemaVersion;
+};
+
+struct REPORT_STORE_STATS
+{
+    UINT64 hits;
+    UINT64 misses;
+    UINT64 writes;
+    UINT64 evictions;
+    UINT64 invalidations;
+};
+
+// Manager of "reports" directory: tracks every report in index file with access log,
+// keeps directory in entries count and size limits by evicting least recently used reports
+// and drops reports written with another schema version. Safe to share between threads,
+// processes sharing the directory adopt reports of each other missing in their index.
+class ReportStore
+{
+public:
+    ReportStore(const UString& dirPath = REPORT_STORE_DEFAULT_DIR,
+        UINT32 maxEntries = REPORT_STORE_DEFAULT_MAX_ENTRIES,
+        UINT64 maxSize = REPORT_STORE_DEFAULT_MAX_SIZE);
+    ~ReportStore();
+
+    bool load(UINT32 crc, nlohmann::ordered_json& report);
+    bool store(UINT32 crc, const nlohmann::ordered_json& report);
+    void invalidate(UINT32 crc);
+    bool flush();
+
+    void setLimits(UINT32 maxEntries, UINT64 maxSize);
+    UINT32 entryCount() const { std::lock_guard<std::mutex> lock(mutex); return (UINT32)entries.size(); }
+    UINT64 totalSize() const { std::lock_guard<std::mutex> lock(mutex); return sizeTotal; }
+    REPORT_STORE_STATS getStats() const { std::lock_guard<std::mutex> lock(mutex); return stats; }
+    void statsOutput(std::ostream& outputStream) const;
+    UString reportPath(UINT32 crc) const;
+
+private:
+    UString dir;
+    UINT32 limitEntries;
+    UINT64 limitSize;
+
+    std::map<UINT32, REPORT_STORE_ENTRY> entries;
+    UINT64 sizeTotal;
+    UINT64 clock;
+    REPORT_STORE_STATS stats;
+    bool dirty;
+    mutable std::mutex mutex;
+
+    UString indexPath() const;
+    void loadIndex();
+    bool writeIndex();
+    void removeEntry(std::map<UINT32, REPORT_STORE_ENTRY>::iterator entry);
+    void evict(bool keepLatest);
+};
+
+#endif // !REPORTSTORE_H
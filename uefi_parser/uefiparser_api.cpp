@@ -0,0 +1,309 @@
+#include "uefiparser_api.h"
+#include "imageinfo.h"
+#include "common/ffs.h"
+#include "common/guiddatabase.h"
+#include "common/nvramindex.h"
+#include "common/types.h"
+#include "common/utility.h"
+
+#include "nlohmann/json.hpp"
+using ordered_json = nlohmann::ordered_json;
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+struct UEFI_PARSER_RESULT
+{
+    // Results only, image data and parsed tree are released after parsing
+    std::unique_ptr<const ImageInfo> info;
+    std::string report;
+    std::vector<std::string> regionNames;
+    std::vector<std::string> moduleTypeNames;
+    std::vector<std::string> messages;
+    // Detached from the parse tree, so data views stay valid
+    NvramIndex nvram;
+    std::vector<std::string> nvramGuids;
+    std::vector<std::string> nvramNames;
+};
+
+static void fillNvramVariable(const UEFI_PARSER_RESULT* result, size_t index, UEFI_PARSER_NVRAM_VARIABLE* variable)
+{
+    const NVRAM_VARIABLE& info = result->nvram.getVariables()[index];
+    variable->guid = result->nvramGuids[index].c_str();
+    variable->name = result->nvramNames[index].c_str();
+    variable->type = info.type;
+    variable->typeName = itemTypeToString(info.type);
+    variable->subtype = info.subtype;
+    variable->valid = info.isValid;
+    variable->current = result->nvram.current(info.key) == &info;
+    variable->attributes = info.attributes;
+    variable->base = info.offset;
+    variable->data = info.data;
+    variable->dataSize = info.dataSize;
+}
+
+uint32_t uefi_parser_api_version(void)
+{
+    return UEFI_PARSER_API_VERSION;
+}
+
+const char* uefi_parser_status_string(int status)
+{
+    // Strings are built once per code and never released, so pointers stay valid
+    static std::mutex mutex;
+    static std::map<int, std::string> strings;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<int, std::string>::iterator found = strings.find(status);
+    if (found == strings.end())
+        found = strings.insert(std::make_pair(status, std::string(errorCodeToUString((USTATUS)status).toLocal8Bit()))).first;
+    return found->second.c_str();
+}
+
+int uefi_parser_load_guid_database(const char* path, uint32_t* numEntries)
+{
+    UINT32 entries = 0;
+    try
+    {
+        initGuidDatabase(UString(path ? path : ""), &entries);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return U_OUT_OF_MEMORY;
+    }
+    if (numEntries)
+        *numEntries = entries;
+    return U_SUCCESS;
+}
+
+int uefi_parser_parse(const void* data, size_t size, UEFI_PARSER_RESULT** result)
+{
+    if (!result || (!data && size) || size > 0x7FFFFFFF)
+        return U_INVALID_PARAMETER;
+    *result = NULL;
+
+    // No exception may leave through C interface
+    try
+    {
+        UByteArray buffer((const char*)data, (int)size);
+        std::ostream nullStream(NULL);
+        ImageInfo imageInfo(buffer);
+        imageInfo.setLogStream(nullStream);
+        USTATUS status = imageInfo.explore();
+        if (status)
+            return status;
+
+        std::unique_ptr<UEFI_PARSER_RESULT> parsed(new UEFI_PARSER_RESULT());
+        std::vector<std::pair<UString, UModelIndex> > messages = imageInfo.getParserMessages();
+        for (size_t i = 0; i < messages.size(); i++)
+            parsed->messages.push_back(std::string(messages[i].first.toLocal8Bit()));
+
+        ordered_json report;
+        imageInfo.toJson(report);
+        parsed->report = report.dump();
+        parsed->info.reset(new ImageInfo(report));
+
+        const std::vector<REGION_INTEL_IMAGE>& regions = parsed->info->getIntelImageInfo().vRegions;
+        for (size_t i = 0; i < regions.size(); i++)
+            parsed->regionNames.push_back(std::string(regionTypeToUString(regions[i].type).toLocal8Bit()));
+        const std::vector<INFO_FILE>& files = parsed->info->getFiles();
+        for (size_t i = 0; i < files.size(); i++)
+            parsed->moduleTypeNames.push_back(itemSubtypeToString(Types::File, (UINT8)files[i].type));
+
+        parsed->nvram = imageInfo.getNvramIndex();
+        parsed->nvram.detach();
+        const std::vector<NVRAM_VARIABLE>& variables = parsed->nvram.getVariables();
+        for (size_t i = 0; i < variables.size(); i++)
+        {
+            parsed->nvramGuids.push_back(std::string(guidToUString(variables[i].key.guid, false).toLocal8Bit()));
+            parsed->nvramNames.push_back(nvramNameToUtf8(variables[i].key.name));
+        }
+
+        *result = parsed.release();
+        return U_SUCCESS;
+    }
+    catch (const std::bad_alloc&)
+    {
+        return U_OUT_OF_MEMORY;
+    }
+    catch (...)
+    {
+        return U_INVALID_IMAGE;
+    }
+}
+
+void uefi_parser_free(UEFI_PARSER_RESULT* result)
+{
+    delete result;
+}
+
+int uefi_parser_get_image(const UEFI_PARSER_RESULT* result, UEFI_PARSER_IMAGE* image)
+{
+    if (!result || !image)
+        return U_INVALID_PARAMETER;
+    const ImageInfo& info = *result->info;
+    image->crc = info.getCrc();
+    image->fileSize = info.getSizeFullFile();
+    image->fullImageSize = info.getSizeFullImage();
+    image->imageBase = info.hasIntelImage() ? info.getIntelImageInfo().base : info.getUefiImageInfo().base;
+    image->imageSize = info.hasIntelImage() ? info.getIntelImageInfo().size : info.getUefiImageInfo().size;
+    image->hasCapsule = info.hasCapsule();
+    image->isIntelImage = info.hasIntelImage();
+    image->hasBootGuard = info.hasBootGuard();
+    image->regionCount = (uint32_t)result->regionNames.size();
+    image->moduleCount = (uint32_t)result->moduleTypeNames.size();
+    image->messageCount = (uint32_t)result->messages.size();
+    image->nvramVariableCount = (uint32_t)result->nvram.size();
+    return U_SUCCESS;
+}
+
+int uefi_parser_get_capsule(const UEFI_PARSER_RESULT* result, UEFI_PARSER_CAPSULE* capsule)
+{
+    if (!result || !capsule)
+        return U_INVALID_PARAMETER;
+    if (!result->info->hasCapsule())
+        return U_ITEM_NOT_FOUND;
+    const INFO_CAPSULE& info = result->info->getCapsuleInfo();
+    capsule->name = info.name.c_str();
+    capsule->guid = info.guid.c_str();
+    capsule->base = info.base;
+    capsule->size = info.size;
+    return U_SUCCESS;
+}
+
+int uefi_parser_get_descriptor(const UEFI_PARSER_RESULT* result, UEFI_PARSER_DESCRIPTOR* descriptor)
+{
+    if (!result || !descriptor)
+        return U_INVALID_PARAMETER;
+    if (!result->info->hasIntelImage())
+        return U_ITEM_NOT_FOUND;
+    const INFO_INTEL_IMAGE_DESCRIPTOR& info = result->info->getIntelImageInfo().descriptor;
+    descriptor->version = info.version;
+    descriptor->base = info.base;
+    descriptor->size = info.size;
+    if (info.version == 1)
+    {
+        descriptor->biosRead = info.masterSection.BiosRead;
+        descriptor->biosWrite = info.masterSection.BiosWrite;
+        descriptor->meRead = info.masterSection.MeRead;
+        descriptor->meWrite = info.masterSection.MeWrite;
+        descriptor->gbeRead = info.masterSection.GbeRead;
+        descriptor->gbeWrite = info.masterSection.GbeWrite;
+        descriptor->ecRead = 0;
+        descriptor->ecWrite = 0;
+    }
+    else
+    {
+        descriptor->biosRead = info.masterSectionV2.BiosRead;
+        descriptor->biosWrite = info.masterSectionV2.BiosWrite;
+        descriptor->meRead = info.masterSectionV2.MeRead;
+        descriptor->meWrite = info.masterSectionV2.MeWrite;
+        descriptor->gbeRead = info.masterSectionV2.GbeRead;
+        descriptor->gbeWrite = info.masterSectionV2.GbeWrite;
+        descriptor->ecRead = info.masterSectionV2.EcRead;
+        descriptor->ecWrite = info.masterSectionV2.EcWrite;
+    }
+    return U_SUCCESS;
+}
+
+int uefi_parser_get_region(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_REGION* region)
+{
+    if (!result || !region)
+        return U_INVALID_PARAMETER;
+    if (index >= result->regionNames.size())
+        return U_ITEM_NOT_FOUND;
+    const REGION_INTEL_IMAGE& info = result->info->getIntelImageInfo().vRegions[index];
+    region->type = info.type;
+    region->name = result->regionNames[index].c_str();
+    region->base = info.base;
+    region->offset = info.offset;
+    region->size = info.size;
+    return U_SUCCESS;
+}
+
+int uefi_parser_get_module(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_MODULE* module)
+{
+    if (!result || !module)
+        return U_INVALID_PARAMETER;
+    if (index >= result->moduleTypeNames.size())
+        return U_ITEM_NOT_FOUND;
+    const INFO_FILE& info = result->info->getFiles()[index];
+    module->type = (uint8_t)info.type;
+    module->typeName = result->moduleTypeNames[index].c_str();
+    module->name = info.name.c_str();
+    module->guid = info.guid.c_str();
+    module->base = info.base;
+    module->dataAddress = info.dataAddress;
+    module->attributes = info.attributes;
+    module->size = info.size;
+    module->headerChecksum = info.headerChecksum.c_str();
+    module->dataChecksum = info.dataChecksum.c_str();
+    return U_SUCCESS;
+}
+
+int uefi_parser_get_nvram_variable(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_NVRAM_VARIABLE* variable)
+{
+    if (!result || !variable)
+        return U_INVALID_PARAMETER;
+    if (index >= result->nvram.size())
+        return U_ITEM_NOT_FOUND;
+    fillNvramVariable(result, index, variable);
+    return U_SUCCESS;
+}
+
+int uefi_parser_find_nvram_variable(const UEFI_PARSER_RESULT* result, const char* guid, const char* name,
+    uint32_t instance, UEFI_PARSER_NVRAM_VARIABLE* variable)
+{
+    if (!result || !name || !variable)
+        return U_INVALID_PARAMETER;
+    try
+    {
+        std::u16string variableName = nvramNameFromUtf8(name);
+        const std::vector<size_t>* positions;
+        if (guid)
+        {
+            NVRAM_VARIABLE_KEY key;
+            if (strlen(guid) != GUID_STRING_LENGTH || !ustringToGuid(UString(guid), key.guid))
+                return U_INVALID_PARAMETER;
+            key.name = variableName;
+            positions = &result->nvram.find(key);
+        }
+        else
+            positions = &result->nvram.findByName(variableName);
+        if (instance >= positions->size())
+            return U_ITEM_NOT_FOUND;
+        fillNvramVariable(result, (*positions)[instance], variable);
+        return U_SUCCESS;
+    }
+    catch (const std::bad_alloc&)
+    {
+        return U_OUT_OF_MEMORY;
+    }
+}
+
+const char* uefi_parser_get_boot_guard(const UEFI_PARSER_RESULT* result)
+{
+    if (!result || !result->info->hasBootGuard())
+        return NULL;
+    return result->info->getBootGuardInfo().c_str();
+}
+
+const char* uefi_parser_get_message(const UEFI_PARSER_RESULT* result, uint32_t index)
+{
+    if (!result || index >= result->messages.size())
+        return NULL;
+    return result->messages[index].c_str();
+}
+
+const char* uefi_parser_get_report(const UEFI_PARSER_RESULT* result)
+{
+    if (!result)
+        return NULL;
+    return result->report.c_str();
+}
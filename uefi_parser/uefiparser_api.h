@@ -0,0 +1,145 @@
+#ifndef UEFIPARSER_API_H
+#define UEFIPARSER_API_H
+
+/* C interface of the parser library.
+   Parses an image from memory and returns structured results, nothing is written to stdout.
+   All strings returned are owned by the result and stay valid until uefi_parser_free().
+   uefi_parser_parse() may be called from many threads at once, uefi_parser_load_guid_database()
+   must not run concurrently with parsing. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(UEFI_PARSER_SHARED) && defined(_WIN32)
+#ifdef UEFI_PARSER_EXPORTS
+#define UEFI_PARSER_API __declspec(dllexport)
+#else
+#define UEFI_PARSER_API __declspec(dllimport)
+#endif
+#elif defined(UEFI_PARSER_SHARED)
+#define UEFI_PARSER_API __attribute__((visibility("default")))
+#else
+#define UEFI_PARSER_API
+#endif
+
+/* Increased on every incompatible change of structures or functions below */
+#define UEFI_PARSER_API_VERSION 2
+
+/* Status codes are the engine USTATUS values, most common ones are */
+#define UEFI_PARSER_SUCCESS 0
+#define UEFI_PARSER_INVALID_PARAMETER 1
+#define UEFI_PARSER_OUT_OF_MEMORY 4
+#define UEFI_PARSER_FILE_OPEN 5
+#define UEFI_PARSER_ITEM_NOT_FOUND 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct UEFI_PARSER_RESULT UEFI_PARSER_RESULT;
+
+typedef struct UEFI_PARSER_IMAGE {
+    uint32_t crc;
+    uint32_t fileSize;
+    uint32_t fullImageSize;
+    uint32_t imageBase;      /* Intel image or UEFI image */
+    uint32_t imageSize;
+    uint8_t hasCapsule;
+    uint8_t isIntelImage;
+    uint8_t hasBootGuard;
+    uint32_t regionCount;
+    uint32_t moduleCount;
+    uint32_t messageCount;
+    uint32_t nvramVariableCount;
+} UEFI_PARSER_IMAGE;
+
+typedef struct UEFI_PARSER_CAPSULE {
+    const char* name;
+    const char* guid;
+    uint32_t base;
+    uint32_t size;
+} UEFI_PARSER_CAPSULE;
+
+typedef struct UEFI_PARSER_DESCRIPTOR {
+    uint8_t version;
+    uint32_t base;
+    uint32_t size;
+    uint16_t biosRead;
+    uint16_t biosWrite;
+    uint16_t meRead;
+    uint16_t meWrite;
+    uint16_t gbeRead;
+    uint16_t gbeWrite;
+    uint16_t ecRead;         /* version 2 only */
+    uint16_t ecWrite;
+} UEFI_PARSER_DESCRIPTOR;
+
+typedef struct UEFI_PARSER_REGION {
+    uint8_t type;
+    const char* name;
+    uint32_t base;
+    uint32_t offset;
+    uint32_t size;
+} UEFI_PARSER_REGION;
+
+typedef struct UEFI_PARSER_MODULE {
+    uint8_t type;            /* EFI_FV_FILETYPE_* */
+    const char* typeName;
+    const char* name;        /* Name from UI section or GUID database, GUID otherwise */
+    const char* guid;
+    uint32_t base;
+    uint64_t dataAddress;
+    uint32_t attributes;
+    uint32_t size;
+    const char* headerChecksum;
+    const char* dataChecksum;
+} UEFI_PARSER_MODULE;
+
+typedef struct UEFI_PARSER_NVRAM_VARIABLE {
+    const char* guid;        /* Vendor GUID, all zeroes for Fsys variables */
+    const char* name;        /* UTF-8 */
+    uint8_t type;            /* Item type of NVAR, VSS, Fsys or EVSA entry */
+    const char* typeName;
+    uint8_t subtype;
+    uint8_t valid;           /* 0 for deleted and damaged instances */
+    uint8_t current;         /* Last valid instance, the one firmware reads */
+    uint32_t attributes;     /* As stored, meaning depends on type */
+    uint32_t base;
+    const void* data;
+    uint32_t dataSize;
+} UEFI_PARSER_NVRAM_VARIABLE;
+
+UEFI_PARSER_API uint32_t uefi_parser_api_version(void);
+UEFI_PARSER_API const char* uefi_parser_status_string(int status);
+
+/* Load CSV file of module names over the built-in GUID database, NULL or empty path leaves built-in names only */
+UEFI_PARSER_API int uefi_parser_load_guid_database(const char* path, uint32_t* numEntries);
+
+/* Parse image in memory, the buffer is copied and may be released after the call.
+   On success *result must be released with uefi_parser_free() */
+UEFI_PARSER_API int uefi_parser_parse(const void* data, size_t size, UEFI_PARSER_RESULT** result);
+UEFI_PARSER_API void uefi_parser_free(UEFI_PARSER_RESULT* result);
+
+UEFI_PARSER_API int uefi_parser_get_image(const UEFI_PARSER_RESULT* result, UEFI_PARSER_IMAGE* image);
+/* Return UEFI_PARSER_ITEM_NOT_FOUND when image has no capsule or is not an Intel image */
+UEFI_PARSER_API int uefi_parser_get_capsule(const UEFI_PARSER_RESULT* result, UEFI_PARSER_CAPSULE* capsule);
+UEFI_PARSER_API int uefi_parser_get_descriptor(const UEFI_PARSER_RESULT* result, UEFI_PARSER_DESCRIPTOR* descriptor);
+UEFI_PARSER_API int uefi_parser_get_region(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_REGION* region);
+UEFI_PARSER_API int uefi_parser_get_module(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_MODULE* module);
+/* All instances of NVRAM variables in store order, deleted ones included */
+UEFI_PARSER_API int uefi_parser_get_nvram_variable(const UEFI_PARSER_RESULT* result, uint32_t index, UEFI_PARSER_NVRAM_VARIABLE* variable);
+/* Instance number "instance" of variable name of vendor guid, hash lookup. NULL guid matches any vendor.
+   Return UEFI_PARSER_ITEM_NOT_FOUND when there are no more instances */
+UEFI_PARSER_API int uefi_parser_find_nvram_variable(const UEFI_PARSER_RESULT* result, const char* guid, const char* name,
+    uint32_t instance, UEFI_PARSER_NVRAM_VARIABLE* variable);
+/* NULL when there is no Boot Guard or no such message */
+UEFI_PARSER_API const char* uefi_parser_get_boot_guard(const UEFI_PARSER_RESULT* result);
+UEFI_PARSER_API const char* uefi_parser_get_message(const UEFI_PARSER_RESULT* result, uint32_t index);
+/* Whole result as JSON, same layout as reports written by the command line tool */
+UEFI_PARSER_API const char* uefi_parser_get_report(const UEFI_PARSER_RESULT* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !UEFIPARSER_API_H */
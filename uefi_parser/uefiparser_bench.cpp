@@ -0,0 +1,601 @@
+#include "imageinfo.h"
+#include "corpusbench.h"
+#include "common/chunkdiff.h"
+#include "common/ffs.h"
+#include "common/ffsgenerator.h"
+#include "common/ffsparser.h"
+#include "common/guiddatabase.h"
+#include "common/sha256.h"
+#include "common/treemodel.h"
+#include "common/utf16.h"
+#include "common/utility.h"
+#include "common/LZMA/LzmaCompress.h"
+#include "common/Tiano/EfiTianoCompress.h"
+#include "utilities.h"
+
+#include "nlohmann/json.hpp"
+using ordered_json = nlohmann::ordered_json;
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Bumped when names or meaning of fields in JSON results change
+#define BENCH_RESULTS_VERSION 1
+#define BENCH_DEFAULT_REPEAT 5
+#define BENCH_GUID_DATABASE_FILE "uefiparser_bench_guids.csv"
+
+struct BENCH_CASE
+{
+    std::string name;
+    UINT32 iterations;          // Fixed, so results of different runs are comparable
+    UINT64 bytesPerIteration;   // Zero when throughput makes no sense
+    std::function<void()> body;
+};
+
+struct BENCH_RESULT
+{
+    std::string name;
+    UINT32 iterations;
+    UINT64 bytesPerIteration;
+    double medianNsPerOp;
+    double minNsPerOp;
+};
+
+// Results are accumulated here, so the compiler cannot drop the benchmarked calls
+static volatile UINT64 benchSink = 0;
+
+// Inputs are generated from a fixed seed, every run measures the same bytes
+class BenchRandom
+{
+public:
+    explicit BenchRandom(UINT64 seed) : state(seed) {}
+    UINT64 next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+private:
+    UINT64 state;
+};
+
+static UByteArray randomData(UINT32 size, UINT64 seed)
+{
+    BenchRandom random(seed);
+    std::string data(size, '\x00');
+    for (UINT32 i = 0; i < size; i++)
+        data[i] = (char)random.next();
+    return UByteArray(data);
+}
+
+// Code-like data, repeated tokens with some noise, compresses a few times like real modules
+static UByteArray compressibleData(UINT32 size, UINT64 seed)
+{
+    static const char* tokens[] = { "\x48\x89\x5C\x24\x08", "\x57\x48\x83\xEC\x20", "\xE8\x10\x20", "\x48\x8B\xC8", "\xC3", "\x33\xC0", "\xFF\x15" };
+    BenchRandom random(seed);
+    std::string data(size, '\x00');
+    UINT32 offset = 0;
+    while (offset < size)
+    {
+        UINT64 value = random.next();
+        if (value % 4 == 0)
+        {
+            data[offset++] = (char)(value >> 8);
+            continue;
+        }
+        const char* token = tokens[(value >> 8) % (sizeof(tokens) / sizeof(tokens[0]))];
+        UINT32 length = (UINT32)strlen(token);
+        for (UINT32 i = 0; i < length && offset < size; i++)
+            data[offset++] = token[i];
+    }
+    return UByteArray(data);
+}
+
+static EFI_GUID randomGuid(BenchRandom& random)
+{
+    EFI_GUID guid;
+    UINT64 low = random.next();
+    UINT64 high = random.next();
+    memcpy(&guid, &low, sizeof(low));
+    memcpy((UINT8*)&guid + sizeof(low), &high, sizeof(high));
+    return guid;
+}
+
+// Uncompressed PEIMs and drivers, enough for parser, model and report benchmarks
+static UByteArray buildImage(UINT32 numFiles, UINT64 seed)
+{
+    GENERATOR_OPTIONS options;
+    options.seed = seed;
+    options.volumes = 2;
+    options.filesPerVolume = numFiles / 2;
+    options.compressionDepth = 0;
+    options.moduleSize = 0x400;
+    options.nvramVariables = 0;
+    UByteArray image;
+    generateImage(options, image);
+    return image;
+}
+
+static UByteArray gzipCompress(const UByteArray& input)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string output(deflateBound(&stream, (uLong)input.size()), '\x00');
+    stream.next_in = (Bytef*)input.constData();
+    stream.avail_in = (uInt)input.size();
+    stream.next_out = (Bytef*)&output[0];
+    stream.avail_out = (uInt)output.size();
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return UByteArray(output);
+}
+
+static UINT64 visitTree(const TreeModel& model, const UModelIndex& index)
+{
+    UINT64 sum = model.base(index);
+    for (int i = 0; i < model.rowCount(index); i++)
+        sum += visitTree(model, model.index(i, 0, index));
+    return sum;
+}
+
+// GUIDs of all files and types of all items, as met by report and JSON writers
+static void collectNames(const TreeModel& model, const UModelIndex& index, std::vector<EFI_GUID>& guids, std::vector<std::pair<UINT8, UINT8> >& types)
+{
+    types.push_back(std::make_pair(model.type(index), model.subtype(index)));
+    if (model.type(index) == Types::File)
+        guids.push_back(readUnaligned((const EFI_GUID*)model.header(index).constData()));
+    for (int i = 0; i < model.rowCount(index); i++)
+        collectNames(model, model.index(i, 0, index), guids, types);
+}
+
+static void addDecompressCase(std::vector<BENCH_CASE>& cases, const std::string& name, UINT32 iterations,
+    const UByteArray& compressed, UINT8 compressionType, UINT32 decompressedSize)
+{
+    cases.push_back({ name, iterations, decompressedSize, [compressed, compressionType]
+        {
+            UINT8 algorithm;
+            UINT32 dictionarySize;
+            UByteArray decompressed, efiDecompressed;
+            decompress(compressed, compressionType, algorithm, dictionarySize, decompressed, efiDecompressed);
+            benchSink += decompressed.size();
+        } });
+}
+
+static std::vector<BENCH_CASE> makeCases()
+{
+    std::vector<BENCH_CASE> cases;
+    const UINT32 rawSize = 4 * 1024 * 1024;
+    const UINT32 blockSize = 1024 * 1024;
+    const UINT32 moduleSize = 256 * 1024;
+
+    UByteArray raw = randomData(rawSize, 1);
+    UByteArray block = randomData(blockSize, 2);
+    UByteArray erased(blockSize, '\xFF');
+    UByteArray module = compressibleData(moduleSize, 3);
+
+    // No volumes in random data, so parsing is the raw area scan of findNextRawAreaItem
+    cases.push_back({ "findNextRawAreaItem", 5, rawSize, [raw]
+        {
+            TreeModel model;
+            FfsParser parser(&model);
+            parser.parse(raw);
+            benchSink += model.rowCount();
+        } });
+    // Same data with a module sized insertion in the middle, every later byte is shifted
+    UByteArray shifted = raw.left(rawSize / 2) + block.left(0x5000) + raw.mid(rawSize / 2);
+    cases.push_back({ "chunkDiff shifted", 5, rawSize, [raw, shifted]
+        {
+            std::vector<CHUNK_DIFF_RANGE> ranges;
+            chunkDiff((const UINT8*)raw.constData(), raw.size(), (const UINT8*)shifted.constData(), shifted.size(), ranges);
+            benchSink += ranges.size();
+        } });
+    cases.push_back({ "getPaddingType erased", 100, blockSize, [erased] { benchSink += getPaddingType(erased); } });
+    cases.push_back({ "getPaddingType data", 100, blockSize, [block] { benchSink += getPaddingType(block); } });
+    cases.push_back({ "calculateSum8", 100, blockSize, [block] { benchSink += calculateSum8((const UINT8*)block.constData(), blockSize); } });
+    cases.push_back({ "calculateChecksum8", 100, blockSize, [block] { benchSink += calculateChecksum8((const UINT8*)block.constData(), blockSize); } });
+    cases.push_back({ "calculateChecksum16", 100, blockSize, [block] { benchSink += calculateChecksum16((const UINT16*)block.constData(), blockSize); } });
+    cases.push_back({ "calculateChecksum32", 100, blockSize, [block] { benchSink += calculateChecksum32((const UINT32*)block.constData(), blockSize); } });
+
+    UINT32 compressedSize = moduleSize * 2 + 0x1000;
+    UByteArray efi11(compressedSize, '\x00');
+    EfiCompress(module.constData(), moduleSize, efi11.data(), &compressedSize);
+    efi11 = efi11.left(compressedSize);
+    compressedSize = moduleSize * 2 + 0x1000;
+    UByteArray tiano(compressedSize, '\x00');
+    TianoCompress(module.constData(), moduleSize, tiano.data(), &compressedSize);
+    tiano = tiano.left(compressedSize);
+    compressedSize = moduleSize * 2 + 0x1000;
+    UByteArray lzma(compressedSize, '\x00');
+    LzmaCompress((const UINT8*)module.constData(), moduleSize, (UINT8*)lzma.data(), &compressedSize, DEFAULT_LZMA_DICTIONARY_SIZE);
+    lzma = lzma.left(compressedSize);
+    addDecompressCase(cases, "decompress EFI 1.1", 20, efi11, EFI_STANDARD_COMPRESSION, moduleSize);
+    addDecompressCase(cases, "decompress Tiano", 20, tiano, EFI_STANDARD_COMPRESSION, moduleSize);
+    addDecompressCase(cases, "decompress LZMA", 20, lzma, EFI_CUSTOMIZED_COMPRESSION, moduleSize);
+    addDecompressCase(cases, "decompress LZMA F86", 20, lzma, EFI_CUSTOMIZED_COMPRESSION_LZMAF86, moduleSize);
+    UByteArray gzip = gzipCompress(module);
+    cases.push_back({ "gzipDecompress", 50, moduleSize, [gzip]
+        {
+            UByteArray decompressed;
+            gzipDecompress(gzip, decompressed);
+            benchSink += decompressed.size();
+        } });
+    cases.push_back({ "sha256", 50, blockSize, [block]
+        {
+            UINT8 digest[SHA256_DIGEST_SIZE];
+            sha256(block.constData(), blockSize, digest);
+            benchSink += digest[0];
+        } });
+
+    // Parsed once, traversal walks the finished tree
+    UByteArray image = buildImage(300, 4);
+    std::shared_ptr<TreeModel> model(new TreeModel());
+    std::shared_ptr<FfsParser> parser(new FfsParser(model.get()));
+    parser->parse(image);
+    cases.push_back({ "TreeModel traversal/base", 20, 0, [model, parser] { benchSink += visitTree(*model, model->index(0, 0)); } });
+
+    // Store bodies of one NVRAM volume are parsed on the shared pool
+    GENERATOR_OPTIONS nvramOptions;
+    nvramOptions.seed = 6;
+    nvramOptions.volumes = 1;
+    nvramOptions.filesPerVolume = 1;
+    nvramOptions.compressionDepth = 0;
+    nvramOptions.moduleSize = 0x400;
+    nvramOptions.nvramVariables = 500;
+    nvramOptions.nvramStores = 16;
+    UByteArray nvramImage;
+    generateImage(nvramOptions, nvramImage);
+    cases.push_back({ "NVRAM stores parse", 5, (UINT64)nvramImage.size(), [nvramImage]
+        {
+            TreeModel model;
+            FfsParser parser(&model);
+            parser.parse(nvramImage);
+            benchSink += parser.getNvramIndex().size();
+        } });
+
+    // Microcode volume body is parsed in one forward pass
+    GENERATOR_OPTIONS microcodeOptions;
+    microcodeOptions.seed = 8;
+    microcodeOptions.volumes = 1;
+    microcodeOptions.filesPerVolume = 1;
+    microcodeOptions.compressionDepth = 0;
+    microcodeOptions.moduleSize = 0x400;
+    microcodeOptions.nvramVariables = 0;
+    microcodeOptions.microcodeUpdates = 100;
+    UByteArray microcodeImage;
+    generateImage(microcodeOptions, microcodeImage);
+    cases.push_back({ "Microcode volume parse", 10, (UINT64)microcodeImage.size(), [microcodeImage]
+        {
+            TreeModel model;
+            FfsParser parser(&model);
+            parser.parse(microcodeImage);
+            benchSink += model.rowCount(model.index(0, 0));
+        } });
+
+    // CPD directories of FPT partitions are parsed and their module hashes are checked on the shared pool
+    GENERATOR_OPTIONS meOptions;
+    meOptions.seed = 7;
+    meOptions.intelDescriptor = true;
+    meOptions.meRegionSize = 0x600000;
+    meOptions.mePartitions = 32;
+    meOptions.meModules = 8;
+    meOptions.meModuleSize = 0x4000;
+    meOptions.volumes = 1;
+    meOptions.filesPerVolume = 1;
+    meOptions.compressionDepth = 0;
+    meOptions.moduleSize = 0x400;
+    UByteArray meImage;
+    generateImage(meOptions, meImage);
+    cases.push_back({ "ME partitions parse", 5, (UINT64)meImage.size(), [meImage]
+        {
+            TreeModel model;
+            FfsParser parser(&model);
+            parser.parse(meImage);
+            benchSink += parser.getMePartitionHashes().size();
+        } });
+
+    // Same partitions in BPDT of IFWI boot partition, parsed in place in the partition item
+    meOptions.meIfwi = true;
+    UByteArray ifwiImage;
+    generateImage(meOptions, ifwiImage);
+    cases.push_back({ "IFWI BPDT partitions parse", 5, (UINT64)ifwiImage.size(), [ifwiImage]
+        {
+            TreeModel model;
+            FfsParser parser(&model);
+            parser.parse(ifwiImage);
+            benchSink += parser.getMePartitionHashes().size();
+        } });
+
+    // UCS-2 names as laid out in a name-heavy VSS store, terminated and unaligned
+    static const char* nameStems[] = { "Setup", "SetupVolatileData", "PlatformLang", "Boot", "MemoryOverwriteRequestControl",
+        "AcpiGlobalVariable", "SecureBootEnable", "PchSetup", "SaSetup", "CpuSetup", "NetworkStackVar", "Timeout" };
+    std::string ucs2Names(1, '\x00');
+    std::vector<std::pair<UINT32, UINT32> > nameRanges;
+    for (UINT32 i = 0; i < 20000; i++)
+    {
+        std::string name = std::string(nameStems[i % (sizeof(nameStems) / sizeof(nameStems[0]))]) + std::to_string(i);
+        nameRanges.push_back(std::make_pair((UINT32)ucs2Names.size(), (UINT32)(name.size() + 1) * 2));
+        for (size_t j = 0; j <= name.size(); j++)
+        {
+            ucs2Names += j < name.size() ? name[j] : '\x00';
+            ucs2Names += '\x00';
+        }
+        ucs2Names.append(i % 7, '\x5A');
+    }
+    cases.push_back({ "fromUtf16/names", 20, ucs2Names.size(), [ucs2Names, nameRanges]
+        {
+            for (size_t i = 0; i < nameRanges.size(); i++)
+                benchSink += UString::fromUtf16((const unsigned short*)(ucs2Names.data() + nameRanges[i].first)).length();
+        } });
+    cases.push_back({ "uFromUtf16/names", 20, ucs2Names.size(), [ucs2Names, nameRanges]
+        {
+            for (size_t i = 0; i < nameRanges.size(); i++)
+                benchSink += uFromUtf16(ucs2Names.data() + nameRanges[i].first, nameRanges[i].second).length();
+        } });
+    cases.push_back({ "utf16Length/names", 20, ucs2Names.size(), [ucs2Names, nameRanges]
+        {
+            for (size_t i = 0; i < nameRanges.size(); i++)
+                benchSink += utf16Length(ucs2Names.data() + nameRanges[i].first, nameRanges[i].second / 2);
+        } });
+
+    BenchRandom random(5);
+    GuidDatabase database;
+    std::vector<EFI_GUID> guids;
+    for (UINT32 i = 0; i < 4000; i++)
+    {
+        EFI_GUID guid = randomGuid(random);
+        database[guid] = usprintf("BenchModule%u", i);
+        // Every second lookup misses
+        guids.push_back(guid);
+        guids.push_back(randomGuid(random));
+    }
+    guidDatabaseExportToFile(BENCH_GUID_DATABASE_FILE, database);
+    initGuidDatabase(BENCH_GUID_DATABASE_FILE);
+    std::shared_ptr<const GuidNameDatabase> names = currentGuidDatabase();
+    std::remove(BENCH_GUID_DATABASE_FILE);
+    cases.push_back({ "guidDatabaseLookup", 50, 0, [guids]
+        {
+            for (size_t i = 0; i < guids.size(); i++)
+                benchSink += guidDatabaseLookup(guids[i]).length();
+        } });
+    cases.push_back({ "GuidNameDatabase::lookup", 50, 0, [guids, names]
+        {
+            for (size_t i = 0; i < guids.size(); i++)
+                benchSink += names->lookup(guids[i]) != NULL;
+        } });
+    cases.push_back({ "guidToUString", 50, 0, [guids]
+        {
+            for (size_t i = 0; i < guids.size(); i++)
+                benchSink += guidToUString(guids[i]).length();
+        } });
+
+    std::vector<EFI_GUID> imageGuids;
+    std::vector<std::pair<UINT8, UINT8> > imageTypes;
+    collectNames(*model, model->index(0, 0), imageGuids, imageTypes);
+    cases.push_back({ "guidToUString/image", 200, 0, [imageGuids]
+        {
+            for (size_t i = 0; i < imageGuids.size(); i++)
+                benchSink += guidToUString(imageGuids[i], false).length();
+        } });
+    cases.push_back({ "guidToChars/image", 200, 0, [imageGuids]
+        {
+            char buffer[GUID_STRING_LENGTH];
+            for (size_t i = 0; i < imageGuids.size(); i++)
+            {
+                guidToChars(imageGuids[i], buffer);
+                benchSink += buffer[i % GUID_STRING_LENGTH];
+            }
+        } });
+    cases.push_back({ "itemSubtypeToUString/image", 200, 0, [imageTypes]
+        {
+            for (size_t i = 0; i < imageTypes.size(); i++)
+                benchSink += itemSubtypeToUString(imageTypes[i].first, imageTypes[i].second).length();
+        } });
+    cases.push_back({ "itemSubtypeToString/image", 200, 0, [imageTypes]
+        {
+            for (size_t i = 0; i < imageTypes.size(); i++)
+                benchSink += *itemSubtypeToString(imageTypes[i].first, imageTypes[i].second);
+        } });
+
+    ImageInfo imageInfo(image);
+    std::ostream nullStream(NULL);
+    imageInfo.setLogStream(nullStream);
+    imageInfo.explore();
+    ordered_json report;
+    imageInfo.toJson(report);
+    std::string reportText = report.dump();
+    cases.push_back({ "JSON report round trip", 20, reportText.size(), [reportText]
+        {
+            ordered_json parsed = ordered_json::parse(reportText);
+            ImageInfo restored(parsed);
+            ordered_json written;
+            restored.toJson(written);
+            benchSink += written.dump().size();
+        } });
+    return cases;
+}
+
+static BENCH_RESULT runCase(const BENCH_CASE& benchCase, UINT32 repeat)
+{
+    // Warm-up, fills caches and lazily initialized tables
+    benchCase.body();
+
+    std::vector<double> nsPerOp;
+    for (UINT32 r = 0; r < repeat; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (UINT32 i = 0; i < benchCase.iterations; i++)
+            benchCase.body();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        nsPerOp.push_back(ns / benchCase.iterations);
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    return { benchCase.name, benchCase.iterations, benchCase.bytesPerIteration, nsPerOp[nsPerOp.size() / 2], nsPerOp.front() };
+}
+
+static double megabytesPerSecond(const BENCH_RESULT& result)
+{
+    return result.bytesPerIteration ? result.bytesPerIteration / (result.medianNsPerOp / 1000000000.0) / (1024.0 * 1024.0) : 0.0;
+}
+
+static void resultsOutput(const std::vector<BENCH_RESULT>& results, UINT32 repeat, std::ostream& outputStream)
+{
+    VariadicTable<std::string, std::string, std::string, std::string, std::string>
+        tableBench({ "Benchmark", "Iterations", "Median us/op", "Min us/op", "MB/s" });
+    for (const BENCH_RESULT& result : results)
+    {
+        std::stringstream median, minimum, rate;
+        median << std::fixed << std::setprecision(3) << result.medianNsPerOp / 1000.0;
+        minimum << std::fixed << std::setprecision(3) << result.minNsPerOp / 1000.0;
+        if (result.bytesPerIteration)
+            rate << std::fixed << std::setprecision(1) << megabytesPerSecond(result);
+        tableBench.addRow(result.name, std::to_string(result.iterations) + "x" + std::to_string(repeat), median.str(), minimum.str(), rate.str());
+    }
+    tableBench.print(outputStream, "Parser microbenchmarks");
+}
+
+static bool writeResults(const std::vector<BENCH_RESULT>& results, UINT32 repeat, const std::string& path)
+{
+    ordered_json resultsObj;
+    resultsObj["version"] = BENCH_RESULTS_VERSION;
+    resultsObj["repeat"] = repeat;
+    ordered_json benchmarksArr = ordered_json::array();
+    for (const BENCH_RESULT& result : results)
+    {
+        ordered_json benchmarkObj;
+        benchmarkObj["name"] = result.name;
+        benchmarkObj["iterations"] = result.iterations;
+        benchmarkObj["bytesPerIteration"] = result.bytesPerIteration;
+        benchmarkObj["medianNsPerOp"] = result.medianNsPerOp;
+        benchmarkObj["minNsPerOp"] = result.minNsPerOp;
+        benchmarkObj["megabytesPerSecond"] = megabytesPerSecond(result);
+        benchmarksArr.push_back(benchmarkObj);
+    }
+    resultsObj["benchmarks"] = benchmarksArr;
+
+    std::ofstream outputFile(path, std::ios::out | std::ios::trunc);
+    if (!outputFile)
+        return false;
+    outputFile << std::setw(4) << resultsObj << std::endl;
+    return (bool)outputFile;
+}
+
+static void usage()
+{
+    std::cout << "Usage: uefi_parser_bench [--filter text] [--repeat N] [--json results.json] [--list]" << std::endl
+        << "       uefi_parser_bench --corpus source [--mode mode] [--reports dir] [--repeat N] [--json results.json]" << std::endl
+        << "                         [--baseline results.json] [--threshold percent]" << std::endl
+        << "  --filter     run only benchmarks with text in the name" << std::endl
+        << "  --repeat     number of timed rounds, median and minimum are reported (default " << BENCH_DEFAULT_REPEAT << ")" << std::endl
+        << "  --json       write results in machine readable form" << std::endl
+        << "  --list       print benchmark names" << std::endl
+        << "  --corpus     parse every image of a directory, or of a list file, end to end like uefi_parser does" << std::endl
+        << "  --mode       output mode of the corpus run, as in uefi_parser (default desc)" << std::endl
+        << "  --reports    report directory of the corpus run (default " << CORPUS_DEFAULT_REPORT_DIR << ")" << std::endl
+        << "  --baseline   compare corpus results with saved ones, exit code is 1 on regression" << std::endl
+        << "  --threshold  allowed slowdown in percent (default " << CORPUS_DEFAULT_THRESHOLD << ")" << std::endl;
+}
+
+static int runCorpus(const std::string& source, const std::string& mode, const std::string& reportDir, UINT32 repeat,
+    const std::string& jsonPath, const std::string& baselinePath, double threshold)
+{
+    // GUID names are resolved the same way as in uefi_parser
+    initGuidDatabase("guids.csv");
+    CorpusBenchmark benchmark(reportDir, outputModeFromString(mode), repeat);
+    USTATUS result = benchmark.collectInputs(source);
+    if (result)
+    {
+        std::cout << "Error of reading corpus \"" << source << "\": " << errorCodeToUString(result).toLocal8Bit() << std::endl;
+        return result;
+    }
+    if (benchmark.getInputs().empty())
+    {
+        std::cout << "No images found in \"" << source << "\"." << std::endl;
+        return U_INVALID_PARAMETER;
+    }
+
+    benchmark.run();
+    benchmark.resultsOutput(std::cout);
+    if (!jsonPath.empty() && !benchmark.writeResults(jsonPath))
+    {
+        std::cout << "Error of writing results to \"" << jsonPath << "\"." << std::endl;
+        return U_FILE_WRITE;
+    }
+    if (!baselinePath.empty() && !benchmark.compareWithBaseline(baselinePath, threshold, std::cout))
+        return 1;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filter, jsonPath;
+    std::string corpusSource, corpusMode = "desc", reportDir = CORPUS_DEFAULT_REPORT_DIR, baselinePath;
+    double threshold = CORPUS_DEFAULT_THRESHOLD;
+    UINT32 repeat = BENCH_DEFAULT_REPEAT;
+    bool listOnly = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, atoi(argv[++i]));
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--list")
+            listOnly = true;
+        else if (arg == "--corpus" && i + 1 < argc)
+            corpusSource = argv[++i];
+        else if (arg == "--mode" && i + 1 < argc)
+            corpusMode = argv[++i];
+        else if (arg == "--reports" && i + 1 < argc)
+            reportDir = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else
+        {
+            usage();
+            return arg == "--help" || arg == "-h" ? 0 : U_INVALID_PARAMETER;
+        }
+    }
+
+    if (!corpusSource.empty())
+        return runCorpus(corpusSource, corpusMode, reportDir, repeat, jsonPath, baselinePath, threshold);
+
+    std::vector<BENCH_CASE> cases = makeCases();
+    std::vector<BENCH_RESULT> results;
+    for (const BENCH_CASE& benchCase : cases)
+    {
+        if (!filter.empty() && benchCase.name.find(filter) == std::string::npos)
+            continue;
+        if (listOnly)
+        {
+            std::cout << benchCase.name << std::endl;
+            continue;
+        }
+        results.push_back(runCase(benchCase, repeat));
+    }
+    if (listOnly)
+        return 0;
+
+    resultsOutput(results, repeat, std::cout);
+    if (!jsonPath.empty() && !writeResults(results, repeat, jsonPath))
+    {
+        std::cout << "Error of writing results to \"" << jsonPath << "\"." << std::endl;
+        return U_FILE_WRITE;
+    }
+    return 0;
+}
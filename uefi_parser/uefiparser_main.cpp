@@ -1,17 +1,44 @@
+#include <fstream>
 #include <iostream>
+#include "common/ffsgenerator.h"
 #include "common/guiddatabase.h"
 #include "common/filesystem.h"
+#include "common/parserstats.h"
+#include "common/parsertrace.h"
 #include "imageinfo.h"
+#include "batchparser.h"
+#include "guidfleet.h"
+#include "imageserver.h"
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
+static void printStats(const std::string& statsModeStr)
+{
+	if (statsModeStr == "json")
+		statsOutputJson(std::cout);
+	else
+		statsOutput(std::cout);
+}
+
+static void writeTrace(const std::string& tracePath)
+{
+	if (traceWrite(tracePath))
+		std::cout << "Error of writing trace to \"" << tracePath << "\"." << std::endl;
+	else
+		std::cout << "Trace written to \"" << tracePath << "\"." << std::endl;
+}
 
 int main(int argc, char* argv[])
 {
 	std::cout << "UEFI Image Parser" << std::endl;
 	if (argc > 1)
 	{
-		std::string inputFilePath, anotherInputFilePath, streamModeStr, outputModeStr;
+		std::string inputFilePath, anotherInputFilePath, streamModeStr, outputModeStr, batchSource, batchOutputDir, socketPath, benchSocketPath, statsModeStr, tracePath, compareReportPath;
+		std::string generatePath, genCompressionStr, guidFleetSource, guidFleetOutput, nvramQuery, nvramDiffPath;
+		UINT32 cacheMaxEntries, jobs, serveCacheEntries, benchClients, benchRequests;
+		UINT64 cacheMaxSizeMb, genSizeMb;
+		UINT32 genMeSizeKb, genMeModuleSizeKb, genModuleSizeKb;
+		GENERATOR_OPTIONS genOptions;
 		po::options_description desc("General options");
 		desc.add_options()
 			("help,h", "Show help message")
@@ -32,6 +59,71 @@ int main(int argc, char* argv[])
 				"\'dxedrivers\' - info about DXE Drivers\n"
 				"\'all\' - all information about image")
 			("compare,c", po::value<std::string>(&anotherInputFilePath), "Enable compare mode. Path to another image file for comparing.")
+			("compare-report", po::value<std::string>(&compareReportPath), "Write differences of compare or NVRAM diff mode to JSON file")
+			("nvram-query", po::value<std::string>(&nvramQuery),
+				"Print all instances of NVRAM variables, deleted ones included. Query is \"GUID:Name\", \"Name\" of any vendor or \"*\" for all variables")
+			("me-hashes", "Print hash checks of modules of every ME partition")
+			("nvram-diff", po::value<std::string>(&nvramDiffPath),
+				"Enable NVRAM diff mode. Path to another image file, its NVRAM variables added, removed, changed and duplicated against the first one are printed")
+			("cache-entries", po::value<UINT32>(&cacheMaxEntries)->default_value(REPORT_STORE_DEFAULT_MAX_ENTRIES),
+				"Maximum number of reports kept in \'reports\' directory")
+			("cache-size", po::value<UINT64>(&cacheMaxSizeMb)->default_value(REPORT_STORE_DEFAULT_MAX_SIZE / (1024 * 1024)),
+				"Maximum size of \'reports\' directory in MB")
+			("cache-stats", "Print report store hit/miss/eviction statistics")
+			("batch,b", po::value<std::string>(&batchSource),
+				"Enable batch mode. Images to parse: \n"
+				"\'dir\' - all files in directory\n"
+				"\'dir/*.bin\' - files matching pattern\n"
+				"\'list.txt\' - manifest with one path per line")
+			("batch-output", po::value<std::string>(&batchOutputDir)->default_value(BATCH_DEFAULT_OUTPUT_DIR),
+				"Directory for per-image results and summary in batch mode")
+			("jobs,j", po::value<UINT32>(&jobs)->default_value(0), "Number of worker threads in batch and GUID fleet modes, 0 - one per CPU")
+			("guid-fleet", po::value<std::string>(&guidFleetSource),
+				"Extract GUIDs and UI names of files from images (same sources as --batch) and merge them into one GUID database")
+			("guid-fleet-output", po::value<std::string>(&guidFleetOutput)->default_value(GUID_FLEET_DEFAULT_OUTPUT),
+				"CSV file of merged GUID database, names used by fewer images are listed in comments")
+			("serve", po::value<std::string>(&socketPath)->implicit_value(SERVER_DEFAULT_SOCKET),
+				"Run as daemon answering requests on Unix socket (default \'" SERVER_DEFAULT_SOCKET "\')")
+			("serve-cache", po::value<UINT32>(&serveCacheEntries)->default_value(SERVER_DEFAULT_CACHE_ENTRIES),
+				"Number of parsed images kept in memory by daemon")
+			("serve-bench", po::value<std::string>(&benchSocketPath)->implicit_value(SERVER_DEFAULT_SOCKET),
+				"Run load generator against daemon on Unix socket, images are taken from --batch source")
+			("bench-clients", po::value<UINT32>(&benchClients)->default_value(4), "Number of concurrent clients of load generator")
+			("bench-requests", po::value<UINT32>(&benchRequests)->default_value(1000), "Number of requests sent by load generator")
+			("bench-hash", "Load generator queries images by content hash instead of path")
+			("stats", po::value<std::string>(&statsModeStr)->implicit_value("human"),
+				"Print per-phase parser timings and counters: \n"
+				"\'human\' - tables (default)\n"
+				"\'json\' - one JSON object")
+			("stats-perf", "Add cycles, instructions, cache and branch misses of every phase to --stats output (Linux only)")
+			("trace", po::value<std::string>(&tracePath),
+				"Record parser activity timeline to file in Chrome trace format (chrome://tracing, ui.perfetto.dev)")
+			("generate", po::value<std::string>(&generatePath), "Write synthetic image built from --gen-* parameters to file and exit")
+			("gen-seed", po::value<UINT64>(&genOptions.seed)->default_value(genOptions.seed), "Seed of synthetic image, same seed gives same bytes")
+			("gen-size", po::value<UINT64>(&genSizeMb)->default_value(0), "Size of synthetic image in MB, 0 - smallest that fits all files")
+			("gen-descriptor", "Put Intel descriptor, GbE and ME regions in front of BIOS region")
+			("gen-me-size", po::value<UINT32>(&genMeSizeKb)->default_value(genOptions.meRegionSize / 1024), "Size of ME region in KB")
+			("gen-me-partitions", po::value<UINT32>(&genOptions.mePartitions)->default_value(genOptions.mePartitions),
+				"Number of FPT code partitions with hashed CPD modules in ME region, 0 - only ME version")
+			("gen-me-modules", po::value<UINT32>(&genOptions.meModules)->default_value(genOptions.meModules), "Number of modules of every ME partition")
+			("gen-me-module-size", po::value<UINT32>(&genMeModuleSizeKb)->default_value(genOptions.meModuleSize / 1024), "Size of every ME module in KB")
+			("gen-me-ifwi", "Put ME partitions into BPDT of IFWI 1.7 boot partition instead of FPT")
+			("gen-volumes", po::value<UINT32>(&genOptions.volumes)->default_value(genOptions.volumes), "Number of FFS volumes")
+			("gen-files", po::value<UINT32>(&genOptions.filesPerVolume)->default_value(genOptions.filesPerVolume),
+				"Number of files per volume, 0 - fill volumes up to --gen-size")
+			("gen-depth", po::value<UINT32>(&genOptions.compressionDepth)->default_value(genOptions.compressionDepth),
+				"Depth of nested compressed sections around every module")
+			("gen-compression", po::value<std::string>(&genCompressionStr)->default_value("lzma"),
+				"Compression of sections: 'none', 'efi11', 'tiano' or 'lzma'")
+			("gen-module-size", po::value<UINT32>(&genModuleSizeKb)->default_value(genOptions.moduleSize / 1024), "Uncompressed size of every module in KB")
+			("gen-nvram", po::value<UINT32>(&genOptions.nvramVariables)->default_value(genOptions.nvramVariables),
+				"Number of variables in VSS and NVAR stores, 0 - no NVRAM")
+			("gen-nvram-stores", po::value<UINT32>(&genOptions.nvramStores)->default_value(genOptions.nvramStores),
+				"Number of VSS stores in NVRAM volume, --gen-nvram variables each")
+			("gen-microcode", po::value<UINT32>(&genOptions.microcodeUpdates)->default_value(genOptions.microcodeUpdates),
+				"Number of Intel microcode updates in microcode volume, 0 - no microcode volume")
+			("gen-unique", po::value<UINT32>(&genOptions.uniqueModules)->default_value(genOptions.uniqueModules),
+				"Number of distinct module bodies reused by all files")
 			;
 		//("process-jpeg,e", po::value<string>()->default_value("")->implicit_value("./"), "Processes a JPEG.");
 		namespace po = boost::program_options;
@@ -45,8 +137,152 @@ int main(int argc, char* argv[])
 			std::cout << desc << std::endl;
 			return 0;
 		};
+		//Synthetic image for benchmarks, nothing is parsed
+		if (vm.count("generate"))
+		{
+			genOptions.imageSize = genSizeMb * 1024 * 1024;
+			genOptions.intelDescriptor = vm.count("gen-descriptor") > 0;
+			genOptions.meRegionSize = genMeSizeKb * 1024;
+			genOptions.meModuleSize = genMeModuleSizeKb * 1024;
+			genOptions.meIfwi = vm.count("gen-me-ifwi") > 0;
+			genOptions.moduleSize = genModuleSizeKb * 1024;
+			if (genCompressionStr == "none")
+				genOptions.compression = COMPRESSION_ALGORITHM_NONE;
+			else if (genCompressionStr == "efi11")
+				genOptions.compression = COMPRESSION_ALGORITHM_EFI11;
+			else if (genCompressionStr == "tiano")
+				genOptions.compression = COMPRESSION_ALGORITHM_TIANO;
+			else if (genCompressionStr == "lzma")
+				genOptions.compression = COMPRESSION_ALGORITHM_LZMA;
+			else
+			{
+				std::cout << "Error of compression \"" << genCompressionStr << "\", use none, efi11, tiano or lzma." << std::endl;
+				return U_INVALID_PARAMETER;
+			}
+
+			std::ofstream outputFile(generatePath, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!outputFile)
+			{
+				std::cout << "Error of opening \"" << generatePath << "\"." << std::endl;
+				return U_FILE_OPEN;
+			}
+			USTATUS result = generateImage(genOptions, outputFile);
+			outputFile.close();
+			if (result || !outputFile)
+			{
+				std::cout << "Error of generating image \"" << generatePath << "\"." << std::endl;
+				return result ? result : U_FILE_WRITE;
+			}
+			std::cout << "Image written to \"" << generatePath << "\"." << std::endl;
+			return 0;
+		};
+
+		//Load generator for daemon, does not touch reports
+		if (vm.count("serve-bench"))
+		{
+			std::vector<std::string> benchInputs;
+			if (!vm.count("batch") || collectImagePaths(batchSource, benchInputs) || benchInputs.empty())
+			{
+				std::cout << "Error of reading images for benchmark, use --batch to set them." << std::endl;
+				return U_FILE_OPEN;
+			}
+			return runServerBenchmark(benchSocketPath, benchInputs, benchClients, benchRequests,
+				outputModeStr, vm.count("bench-hash") > 0, std::cout);
+		};
+
+		if (vm.count("stats-perf"))
+		{
+			std::string reason;
+			if (!statsEnablePerfCounters(reason))
+				std::cout << "Hardware counters are not available, " << reason << "." << std::endl;
+		};
+
+		if (vm.count("trace"))
+		{
+			traceStart();
+			traceSetThreadName("Main");
+		};
+
+		ReportStore reportStore(REPORT_STORE_DEFAULT_DIR, cacheMaxEntries, cacheMaxSizeMb * 1024 * 1024);
+
+		//Daemon mode, GUID database, report store and parsed images stay in memory between requests
+		if (vm.count("serve"))
+		{
+			initGuidDatabase("guids.csv");
+			ImageServer server(reportStore, serveCacheEntries);
+			USTATUS result = server.serve(socketPath);
+			if (result)
+				return result;
+			server.statsOutput(std::cout);
+			if (vm.count("cache-stats"))
+				reportStore.statsOutput(std::cout);
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return 0;
+		};
+
+		//Batch mode, parse many images with shared GUID database and report store
+		if (vm.count("batch"))
+		{
+			initGuidDatabase("guids.csv");
+			BatchParser batchParser(reportStore, jobs);
+			if (batchParser.collectInputs(batchSource))
+			{
+				std::cout << "Error of reading batch source \"" << batchSource << "\"." << std::endl;
+				return U_FILE_OPEN;
+			}
+			std::cout << "Images to parse: " << batchParser.getInputs().size() << std::endl;
+			USTATUS result = batchParser.run(batchOutputDir, outputModeFromString(outputModeStr));
+			if (result)
+			{
+				std::cout << "Error of writing batch results to \"" << batchOutputDir << "\"." << std::endl;
+				return result;
+			}
+			batchParser.summaryOutput(std::cout);
+			if (vm.count("cache-stats"))
+				reportStore.statsOutput(std::cout);
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return 0;
+		};
+
+		//GUID fleet mode, names of all images merged into one database
+		if (vm.count("guid-fleet"))
+		{
+			GuidFleet guidFleet(jobs);
+			if (guidFleet.collectInputs(guidFleetSource))
+			{
+				std::cout << "Error of reading GUID fleet source \"" << guidFleetSource << "\"." << std::endl;
+				return U_FILE_OPEN;
+			}
+			std::cout << "Images to parse: " << guidFleet.getInputs().size() << std::endl;
+			guidFleet.run();
+			guidFleet.summaryOutput(std::cout);
+			USTATUS result = guidFleet.exportToFile(guidFleetOutput);
+			if (result)
+			{
+				std::cout << "Error of writing GUID database to \"" << guidFleetOutput << "\"." << std::endl;
+				return result;
+			}
+			std::cout << "GUID database written to \"" << guidFleetOutput << "\"." << std::endl;
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return 0;
+		};
+
 		if (!vm.count("file"))
 		{
+			if (vm.count("cache-stats"))
+			{
+				reportStore.statsOutput(std::cout);
+				return 0;
+			}
 			std::cout << "Invalid arguments! Path to image file is required. Use --help for more info." << std::endl;
 			std::cout << desc << std::endl;
 			return 0;
@@ -68,6 +304,64 @@ int main(int argc, char* argv[])
 
 		ImageInfo imageInfo(buffer);
 
+		//NVRAM query mode
+		if (vm.count("nvram-query"))
+		{
+			result = imageInfo.explore();
+			if (result)
+			{
+				std::cout << "Error of parsing file." << std::endl;
+				return result;
+			}
+			result = imageInfo.nvramQueryOutput(std::cout, nvramQuery);
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return result;
+		};
+
+		//ME partition hashes mode
+		if (vm.count("me-hashes"))
+		{
+			result = imageInfo.explore();
+			if (result)
+			{
+				std::cout << "Error of parsing file." << std::endl;
+				return result;
+			}
+			result = imageInfo.meHashesOutput(std::cout);
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return result;
+		};
+
+		//NVRAM diff mode
+		if (vm.count("nvram-diff"))
+		{
+			UByteArray anotherBuffer;
+			UString anotherPath = getAbsPath(nvramDiffPath.c_str());
+			std::cout << "Second image file: " << anotherPath << std::endl;
+			std::cout << "Reading second file..." << std::endl;
+			result = readFileIntoBuffer(anotherPath, anotherBuffer);
+			if (result)
+			{
+				std::cout << "Error of reading second file." << std::endl;
+				return result;
+			}
+			ImageInfo anotherImageInfo(anotherBuffer);
+			result = imageInfo.nvramDiffOutput(anotherImageInfo, std::cout, compareReportPath);
+			if (result)
+				std::cout << "Error of comparing NVRAM." << std::endl;
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return result;
+		};
+
 		//Compare mode
 		if (vm.count("compare"))
 		{
@@ -82,40 +376,28 @@ int main(int argc, char* argv[])
 				return result;
 			}
 			ImageInfo anotherImageInfo(anotherBuffer);
-			imageInfo.compareWithAnother(anotherImageInfo);
-			return 0;
+			result = imageInfo.compareWithAnother(anotherImageInfo, compareReportPath);
+			if (result)
+				std::cout << "Error of comparing images." << std::endl;
+			if (vm.count("stats"))
+				printStats(statsModeStr);
+			if (vm.count("trace"))
+				writeTrace(tracePath);
+			return result;
 		};
 
 		//Main mode, try to reading existing report or explore file and write report
-		if (!imageInfo.readFromFile())
+		if (!imageInfo.readFromFile(reportStore))
 		{
 		    imageInfo.explore();
-		    if (!imageInfo.writeToFile())
+		    if (!imageInfo.writeToFile(reportStore))
 		    {
 		        std::cout << "Error of writing information to report file." << std::endl;
 		    }
 		}; 
 
 		//parse outputmode arguments
-		UINT16 mode = 0;
-		if (outputModeStr.find("desc") != std::string::npos)
-			mode |= OUTPUT_MODE_DESCRIPTION;
-		if (outputModeStr.find("capsule") != std::string::npos)
-			mode |= OUTPUT_MODE_CAPSULE;
-		if (outputModeStr.find("image") != std::string::npos)
-			mode |= OUTPUT_MODE_IMAGE;
-		if (outputModeStr.find("peicore") != std::string::npos)
-			mode |= OUTPUT_MODE_FILE_PEI_CORE;
-		if (outputModeStr.find("peimodules") != std::string::npos)
-			mode |= OUTPUT_MODE_FILE_PEI;
-		if (outputModeStr.find("dxecore") != std::string::npos)
-			mode |= OUTPUT_MODE_FILE_DXE_CORE;
-		if (outputModeStr.find("dxedrivers") != std::string::npos)
-			mode |= OUTPUT_MODE_FILE_DXE;
-		if (outputModeStr.find("bg") != std::string::npos)
-			mode |= OUTPUT_MODE_BG;
-		if (outputModeStr.find("all") != std::string::npos)
-			mode |= OUTPUT_MODE_FULL;
+		UINT16 mode = outputModeFromString(outputModeStr);
 
 		if (streamModeStr == "cout")
 			imageInfo.infoOutput(std::cout, mode);
@@ -126,10 +408,17 @@ int main(int argc, char* argv[])
 			imageInfo.infoOutput(outputFile, mode);
 		};
 
+		if (vm.count("cache-stats"))
+			reportStore.statsOutput(std::cout);
+		if (vm.count("stats"))
+			printStats(statsModeStr);
+		if (vm.count("trace"))
+			writeTrace(tracePath);
 	}
 	else
 	{
 		initGuidDatabase("guids.csv");
+		ReportStore reportStore;
 		std::string inputFilePath, anotherInputFilePath;
 		USTATUS result;
 		UString path;
@@ -156,10 +445,10 @@ int main(int argc, char* argv[])
 			{
 				ImageInfo imageInfo(buffer);
 				//Main mode, try to reading existing report or explore file and write report
-				if (!imageInfo.readFromFile())
+				if (!imageInfo.readFromFile(reportStore))
 				{
 					imageInfo.explore();
-					if (!imageInfo.writeToFile())
+					if (!imageInfo.writeToFile(reportStore))
 					{
 						std::cout << "Error of writing information to report file." << std::endl;
 					}